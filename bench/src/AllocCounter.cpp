@@ -0,0 +1,63 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <openssl/crypto.h>
+
+static std::atomic<uint64_t> g_AllocCount{};
+
+static void *CountedMalloc(size_t size) {
+  g_AllocCount.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+static void *OpenSSLMalloc(size_t size, const char *, int) {
+  return CountedMalloc(size);
+}
+
+static void *OpenSSLRealloc(void *ptr, size_t size, const char *, int) {
+  g_AllocCount.fetch_add(1, std::memory_order_relaxed);
+  return std::realloc(ptr, size);
+}
+
+static void OpenSSLFree(void *ptr, const char *, int) {
+  std::free(ptr);
+}
+
+void AllocCounter::Install() {
+  // Must run before OpenSSL allocates anything
+  CRYPTO_set_mem_functions(OpenSSLMalloc, OpenSSLRealloc, OpenSSLFree);
+}
+
+uint64_t AllocCounter::GetCount() {
+  return g_AllocCount.load(std::memory_order_relaxed);
+}
+
+void *operator new(size_t size) {
+  if(auto ptr = CountedMalloc(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+  if(auto ptr = CountedMalloc(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
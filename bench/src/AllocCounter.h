@@ -0,0 +1,16 @@
+#ifndef PCBU_BENCH_ALLOCCOUNTER_H
+#define PCBU_BENCH_ALLOCCOUNTER_H
+
+#include <cstdint>
+
+// Counts heap allocations made through operator new and through OpenSSL
+class AllocCounter {
+public:
+  static void Install();
+  static uint64_t GetCount();
+
+private:
+  AllocCounter() = default;
+};
+
+#endif // PCBU_BENCH_ALLOCCOUNTER_H
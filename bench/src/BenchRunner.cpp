@@ -0,0 +1,114 @@
+#include "BenchRunner.h"
+
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+#include "AllocCounter.h"
+#include "utils/AppInfo.h"
+
+BenchRunner::BenchRunner(std::string filter, std::chrono::milliseconds minTime) : m_Filter(std::move(filter)), m_MinTime(minTime) {}
+
+#ifdef _MSC_VER
+static const volatile void *g_UsedAddress{};
+
+void BenchRunner::UseAddress(const volatile void *address) {
+  g_UsedAddress = address;
+}
+#endif
+
+bool BenchRunner::IsEnabled(const std::string &name) const {
+  return m_Filter.empty() || name.find(m_Filter) != std::string::npos;
+}
+
+void BenchRunner::Run(const std::string &name, const std::function<void()> &func, BenchMetrics metrics) {
+  if(!IsEnabled(name))
+    return;
+
+  func(); // Warm up caches and lazily created contexts
+  uint64_t iterations = 0;
+  uint64_t batchSize = 1;
+  auto allocsBefore = AllocCounter::GetCount();
+  auto startTime = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::duration::zero();
+  while(elapsed < m_MinTime) {
+    for(uint64_t i = 0; i < batchSize; i++)
+      func();
+    iterations += batchSize;
+    batchSize *= 2;
+    elapsed = std::chrono::steady_clock::now() - startTime;
+  }
+  auto allocs = AllocCounter::GetCount() - allocsBefore;
+
+  auto result = BenchResult();
+  result.name = name;
+  result.iterations = iterations;
+  result.nsPerOp = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)iterations;
+  result.allocsPerOp = (double)allocs / (double)iterations;
+  result.metrics = std::move(metrics);
+  m_Results.emplace_back(result);
+}
+
+void BenchRunner::Report(const std::string &name, BenchMetrics metrics) {
+  if(!IsEnabled(name))
+    return;
+  auto result = BenchResult();
+  result.name = name;
+  result.metrics = std::move(metrics);
+  m_Results.emplace_back(result);
+}
+
+void BenchRunner::ReportLatencies(const std::string &name, std::vector<double> latenciesUs, BenchMetrics metrics) {
+  if(latenciesUs.empty())
+    return;
+  std::sort(latenciesUs.begin(), latenciesUs.end());
+  BenchMetrics latencyMetrics = {{"median_us", latenciesUs[latenciesUs.size() / 2]},
+                                 {"p99_us", latenciesUs[latenciesUs.size() * 99 / 100]},
+                                 {"max_us", latenciesUs.back()},
+                                 {"runs", (double)latenciesUs.size()}};
+  latencyMetrics.insert(latencyMetrics.end(), metrics.begin(), metrics.end());
+  Report(name, std::move(latencyMetrics));
+}
+
+void BenchRunner::Expect(const std::string &name, bool condition, const std::string &message) {
+  if(IsEnabled(name) && !condition)
+    m_Failures.emplace_back(name + ": " + message);
+}
+
+const std::vector<std::string> &BenchRunner::GetFailures() const {
+  return m_Failures;
+}
+
+void BenchRunner::PrintJson(std::ostream &out) const {
+  auto results = nlohmann::json::array();
+  for(const auto &result : m_Results) {
+    nlohmann::json entry = {{"name", result.name}};
+    if(result.iterations > 0) {
+      entry["iterations"] = result.iterations;
+      entry["ns_per_op"] = result.nsPerOp;
+      entry["allocs_per_op"] = result.allocsPerOp;
+    }
+    auto metrics = nlohmann::json::object();
+    for(const auto &[key, value] : result.metrics)
+      metrics[key] = value;
+    entry["metrics"] = metrics;
+    results.emplace_back(entry);
+  }
+  nlohmann::json json = {{"version", AppInfo::GetVersion()},
+                         {"os", AppInfo::GetOperatingSystem()},
+                         {"arch", AppInfo::GetArchitecture()},
+                         {"results", results}};
+  out << json.dump(2) << std::endl;
+}
+
+void BenchRunner::PrintCsv(std::ostream &out) const {
+  out << "name,metric,value" << std::endl;
+  for(const auto &result : m_Results) {
+    if(result.iterations > 0) {
+      out << result.name << ",iterations," << result.iterations << std::endl;
+      out << result.name << ",ns_per_op," << result.nsPerOp << std::endl;
+      out << result.name << ",allocs_per_op," << result.allocsPerOp << std::endl;
+    }
+    for(const auto &[key, value] : result.metrics)
+      out << result.name << "," << key << "," << value << std::endl;
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef PCBU_BENCH_BENCHRUNNER_H
+#define PCBU_BENCH_BENCHRUNNER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using BenchMetrics = std::vector<std::pair<std::string, double>>;
+
+struct BenchResult {
+  std::string name{};
+  uint64_t iterations{};
+  double nsPerOp{};
+  double allocsPerOp{};
+  BenchMetrics metrics{};
+};
+
+class BenchRunner {
+public:
+  BenchRunner(std::string filter, std::chrono::milliseconds minTime);
+
+  [[nodiscard]] bool IsEnabled(const std::string &name) const;
+  // Calls func until minTime has passed and records time and heap allocations per call
+  void Run(const std::string &name, const std::function<void()> &func, BenchMetrics metrics = {});
+  // Records measurements that do not fit the per-call model, e.g. latencies or syscall counts
+  void Report(const std::string &name, BenchMetrics metrics);
+  // Reports median, p99 and maximum of per-run latencies in microseconds
+  void ReportLatencies(const std::string &name, std::vector<double> latenciesUs, BenchMetrics metrics = {});
+  // Records a failed check if the benchmark is enabled and condition is false, pcbu_bench then exits with 1
+  void Expect(const std::string &name, bool condition, const std::string &message);
+  [[nodiscard]] const std::vector<std::string> &GetFailures() const;
+
+  // Makes the compiler assume value is read and all memory changed, so neither the work that produced value
+  // nor a lookup with constant inputs after it can be optimized away
+  template <typename T>
+  static void DoNotOptimize(const T &value) {
+#ifdef _MSC_VER
+    UseAddress(&value);
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r"(&value) : "memory");
+#endif
+  }
+
+  void PrintJson(std::ostream &out) const;
+  void PrintCsv(std::ostream &out) const;
+
+private:
+#ifdef _MSC_VER
+  static void UseAddress(const volatile void *address);
+#endif
+
+  std::string m_Filter;
+  std::chrono::milliseconds m_MinTime;
+  std::vector<BenchResult> m_Results{};
+  std::vector<std::string> m_Failures{};
+};
+
+#endif // PCBU_BENCH_BENCHRUNNER_H
@@ -0,0 +1,30 @@
+#include "SyscallCounter.h"
+
+#ifndef WINDOWS
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static thread_local SyscallCounter::Counts g_Counts{};
+
+SyscallCounter::Counts SyscallCounter::Get() {
+  return g_Counts;
+}
+
+// pcbu_common is linked statically, so its calls resolve to these definitions
+extern "C" ssize_t sendmsg(int socket, const struct msghdr *message, int flags) {
+  static auto realSendMsg = reinterpret_cast<ssize_t (*)(int, const struct msghdr *, int)>(dlsym(RTLD_NEXT, "sendmsg"));
+  g_Counts.sends++;
+  return realSendMsg(socket, message, flags);
+}
+
+extern "C" ssize_t read(int fd, void *buffer, size_t count) {
+  static auto realRead = reinterpret_cast<ssize_t (*)(int, void *, size_t)>(dlsym(RTLD_NEXT, "read"));
+  g_Counts.reads++;
+  return realRead(fd, buffer, count);
+}
+#else
+SyscallCounter::Counts SyscallCounter::Get() {
+  return {};
+}
+#endif
@@ -0,0 +1,21 @@
+#ifndef PCBU_BENCH_SYSCALLCOUNTER_H
+#define PCBU_BENCH_SYSCALLCOUNTER_H
+
+#include <cstdint>
+
+// Counts sendmsg() and read() calls of the calling thread. Both are interposed in the bench executable,
+// since /proc/self/io does not count sendmsg().
+class SyscallCounter {
+public:
+  struct Counts {
+    uint64_t sends{};
+    uint64_t reads{};
+  };
+
+  static Counts Get();
+
+private:
+  SyscallCounter() = default;
+};
+
+#endif // PCBU_BENCH_SYSCALLCOUNTER_H
@@ -0,0 +1,154 @@
+#include "Benchmarks.h"
+
+#ifndef WINDOWS
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <spawn.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "connection/BaseConnection.h"
+#include "connection/SocketDefs.h"
+#include "connection/daemon/AuthDaemonClient.h"
+
+extern char **environ;
+
+constexpr auto PCBU_AUTH_PATH = "/usr/local/sbin/pcbu_auth";
+constexpr int NUM_SAMPLES = 5;
+constexpr int NUM_STARTUP_SAMPLES = 50;
+constexpr auto FIRST_MESSAGE_TIMEOUT = std::chrono::seconds(10);
+constexpr auto SETTLE_TIME = std::chrono::seconds(1); // Lets the canceled request release its listeners
+
+class BenchAuthConnection : public BaseConnection {
+public:
+  using BaseConnection::ReadPacket;
+  using BaseConnection::WritePacket;
+};
+
+static double GetElapsedMs(std::chrono::steady_clock::time_point startTime) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Time until a freshly started pcbu_auth prints its first status line
+static std::optional<double> MeasureExec(const std::string &userName) {
+  int pipeFd[2]{};
+  if(access(PCBU_AUTH_PATH, X_OK) != 0 || pipe(pipeFd) != 0)
+    return {};
+  posix_spawn_file_actions_t actions{};
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipeFd[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addclose(&actions, pipeFd[0]);
+
+  auto startTime = std::chrono::steady_clock::now();
+  pid_t pid{};
+  char *argv[] = {const_cast<char *>(PCBU_AUTH_PATH), const_cast<char *>(userName.c_str()), nullptr};
+  auto spawnResult = posix_spawn(&pid, PCBU_AUTH_PATH, &actions, nullptr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipeFd[1]);
+  if(spawnResult != 0) {
+    close(pipeFd[0]);
+    return {};
+  }
+
+  std::optional<double> result{};
+  struct pollfd pollFd{pipeFd[0], POLLIN, 0};
+  char buffer[256]{};
+  while(poll(&pollFd, 1, (int)std::chrono::milliseconds(FIRST_MESSAGE_TIMEOUT).count()) > 0) {
+    auto bytesRead = read(pipeFd[0], buffer, sizeof(buffer));
+    if(bytesRead <= 0)
+      break;
+    if(std::memchr(buffer, '\n', bytesRead) != nullptr) {
+      result = GetElapsedMs(startTime);
+      break;
+    }
+  }
+  kill(pid, SIGTERM);
+  waitpid(pid, nullptr, 0);
+  close(pipeFd[0]);
+  return result;
+}
+
+// Time until pcbu_auth exits after rejecting its arguments, i.e. process start and static initialization
+static std::optional<double> MeasureStartup() {
+  if(access(PCBU_AUTH_PATH, X_OK) != 0)
+    return {};
+  posix_spawn_file_actions_t actions{};
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+  auto startTime = std::chrono::steady_clock::now();
+  pid_t pid{};
+  char *argv[] = {const_cast<char *>(PCBU_AUTH_PATH), nullptr};
+  auto spawnResult = posix_spawn(&pid, PCBU_AUTH_PATH, &actions, nullptr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if(spawnResult != 0 || waitpid(pid, nullptr, 0) != pid)
+    return {};
+  return GetElapsedMs(startTime);
+}
+
+// Time until pcbu_authd sends its first status message
+static std::optional<double> MeasureDaemon(const std::string &userName) {
+  auto startTime = std::chrono::steady_clock::now();
+  SOCKET clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, AUTHD_SOCKET_PATH, sizeof(address.sun_path) - 1);
+  if(connect(clientSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0 || !BaseConnection::SetSocketBlocking(clientSocket, false)) {
+    SOCKET_CLOSE(clientSocket);
+    return {};
+  }
+
+  std::optional<double> result{};
+  auto request = PacketAuthRequest();
+  request.userName = userName;
+  auto requestStr = request.ToJson().dump();
+  if(BenchAuthConnection::WritePacket(clientSocket, PACKET_ID_AUTH_REQUEST, {reinterpret_cast<const uint8_t *>(requestStr.data()), requestStr.size()},
+                                      FIRST_MESSAGE_TIMEOUT) == PacketError::NONE) {
+    auto packet = BenchAuthConnection::ReadPacket(clientSocket, FIRST_MESSAGE_TIMEOUT);
+    if(packet.error == PacketError::NONE && packet.id == PACKET_ID_AUTH_MESSAGE)
+      result = GetElapsedMs(startTime);
+  }
+  SOCKET_CLOSE(clientSocket); // Cancels the request
+  return result;
+}
+
+void RunAuthBenchmarks(BenchRunner &runner, const std::string &userName) {
+  if(runner.IsEnabled("auth/startup_exec")) {
+    std::vector<double> samples{};
+    for(int i = 0; i < NUM_STARTUP_SAMPLES; i++) {
+      auto sample = MeasureStartup();
+      if(!sample.has_value())
+        break; // Not installed
+      samples.emplace_back(sample.value() * 1000.0);
+    }
+    runner.ReportLatencies("auth/startup_exec", samples);
+  }
+
+  // Contacts the paired devices of the user, so it only runs when asked for
+  if(userName.empty())
+    return;
+  for(const auto &[name, measure] : {std::pair{"auth/first_message_exec", &MeasureExec}, std::pair{"auth/first_message_daemon", &MeasureDaemon}}) {
+    if(!runner.IsEnabled(name))
+      continue;
+    std::vector<double> samples{};
+    for(int i = 0; i < NUM_SAMPLES; i++) {
+      auto sample = measure(userName);
+      if(!sample.has_value())
+        break; // Not installed or not running
+      samples.emplace_back(sample.value());
+      std::this_thread::sleep_for(SETTLE_TIME);
+    }
+    if(samples.empty())
+      continue;
+    std::sort(samples.begin(), samples.end());
+    runner.Report(name, {{"median_ms", samples[samples.size() / 2]}, {"min_ms", samples.front()}, {"samples", (double)samples.size()}});
+  }
+}
+#else
+void RunAuthBenchmarks(BenchRunner &, const std::string &) {}
+#endif
@@ -0,0 +1,28 @@
+#ifndef PCBU_BENCH_BENCHMARKS_H
+#define PCBU_BENCH_BENCHMARKS_H
+
+#include <string>
+
+#include "BenchRunner.h"
+
+void RunCryptBenchmarks(BenchRunner &runner);
+void RunStringBenchmarks(BenchRunner &runner);
+void RunPacketBenchmarks(BenchRunner &runner);
+void RunConnectionBenchmarks(BenchRunner &runner);
+void RunUnlockServerBenchmarks(BenchRunner &runner);
+// Save latency of storage files, including fsync
+void RunStorageBenchmarks(BenchRunner &runner);
+// AppSettings::Get() alone and while other threads read the settings
+void RunSettingsBenchmarks(BenchRunner &runner);
+// Cost of a log line for the calling thread, with the old synchronous and the async logger
+void RunLoggingBenchmarks(BenchRunner &runner);
+// I18n::Get() and the JSON lookups it replaced
+void RunI18nBenchmarks(BenchRunner &runner);
+// Time from a connection result or a cancel until UnlockHandler::GetResult returns
+void RunUnlockHandlerBenchmarks(BenchRunner &runner);
+// Full unlocks against a mock phone on loopback
+void RunEndToEndBenchmarks(BenchRunner &runner);
+// Startup time of pcbu_auth, and with a user name the first message of pcbu_auth compared with pcbu_authd
+void RunAuthBenchmarks(BenchRunner &runner, const std::string &userName);
+
+#endif // PCBU_BENCH_BENCHMARKS_H
@@ -0,0 +1,84 @@
+#include "Benchmarks.h"
+
+#ifndef WINDOWS
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "SyscallCounter.h"
+#include "connection/BaseConnection.h"
+#include "connection/Packets.h"
+
+class BenchConnection : public BaseConnection {
+public:
+  using BaseConnection::ReadPacket;
+  using BaseConnection::WritePacket;
+};
+
+static double GetCpuTimeMs() {
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+void RunConnectionBenchmarks(BenchRunner &runner) {
+  int sockets[2]{};
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+    return;
+  // Large enough for the biggest frame, so a single thread can write and then read it
+  int bufferSize = 256 * 1024;
+  for(int socket : sockets) {
+    BaseConnection::SetSocketBlocking(socket, false);
+    setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+  }
+  auto timeout = std::chrono::milliseconds(1000);
+  auto readBuffer = PacketReadBuffer();
+
+  for(size_t size : {64, 1024, 60000}) {
+    auto data = std::vector<uint8_t>(size, 0x42);
+    runner.Run("connection/write_read_" + std::to_string(size), [&] {
+      BenchConnection::WritePacket(sockets[0], PACKET_ID_UNLOCK_RESPONSE, data, timeout);
+      BenchConnection::ReadPacket(sockets[1], readBuffer, timeout);
+    }, {{"data_bytes", size}});
+  }
+
+  // Split into continuation frames. Too large for the socket buffers, so it is written from another thread.
+  auto largeData = std::vector<uint8_t>(1024 * 1024, 0x42);
+  runner.Run("connection/write_read_1048576", [&] {
+    std::thread writer([&] { BenchConnection::WritePacket(sockets[0], PACKET_ID_UNLOCK_RESPONSE, largeData, timeout); });
+    BenchConnection::ReadPacket(sockets[1], readBuffer, timeout);
+    writer.join();
+  }, {{"data_bytes", largeData.size()}});
+
+  // Syscalls per frame when several frames arrive at once. Header and data of a frame that fits the socket
+  // buffer have to go out in a single send.
+  constexpr int NUM_FRAMES = 100;
+  auto frame = std::vector<uint8_t>(64, 0x42);
+  auto before = SyscallCounter::Get();
+  for(int i = 0; i < NUM_FRAMES; i++)
+    BenchConnection::WritePacket(sockets[0], PACKET_ID_UNLOCK_RESPONSE, frame, timeout);
+  auto afterWrite = SyscallCounter::Get();
+  for(int i = 0; i < NUM_FRAMES; i++)
+    BenchConnection::ReadPacket(sockets[1], readBuffer, timeout);
+  auto afterRead = SyscallCounter::Get();
+  auto sends = afterWrite.sends - before.sends;
+  runner.Report("connection/syscalls_per_frame", {{"send_syscalls", (double)sends / NUM_FRAMES},
+                                                  {"read_syscalls", (double)(afterRead.reads - afterWrite.reads) / NUM_FRAMES}});
+  runner.Expect("connection/syscalls_per_frame", sends == NUM_FRAMES, fmt::format("{} sends for {} frames", sends, NUM_FRAMES));
+
+  // CPU spent while waiting for a packet that never arrives
+  auto idleTimeout = std::chrono::milliseconds(200);
+  auto cpuBefore = GetCpuTimeMs();
+  auto startTime = std::chrono::steady_clock::now();
+  BenchConnection::ReadPacket(sockets[1], readBuffer, idleTimeout);
+  auto wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+  runner.Report("connection/idle_read_timeout", {{"timeout_ms", (double)idleTimeout.count()}, {"wall_ms", wallMs}, {"cpu_ms", GetCpuTimeMs() - cpuBefore}});
+
+  close(sockets[0]);
+  close(sockets[1]);
+}
+#else
+void RunConnectionBenchmarks(BenchRunner &) {}
+#endif
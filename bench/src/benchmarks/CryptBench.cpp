@@ -0,0 +1,89 @@
+#include "Benchmarks.h"
+
+#include <spdlog/spdlog.h>
+
+#include "AllocCounter.h"
+#include "utils/CryptUtils.h"
+#include "utils/StringUtils.h"
+
+constexpr size_t PACKET_DATA_SIZE = 256;
+constexpr size_t STREAM_DATA_SIZE = 4 * 1024 * 1024;
+constexpr size_t STREAM_CHUNK_SIZE = 64 * 1024;
+constexpr uint64_t ALLOC_CHECK_MESSAGES = 100;
+
+static CryptKey GetDerivedKey() {
+  auto key = StringUtils::FromHexString(CryptUtils::DeriveDeviceKey("bench-encryption-key", "bench-device-id"));
+  return {{key.begin(), key.end()}, KeyDerivation::HKDF};
+}
+
+void RunCryptBenchmarks(BenchRunner &runner) {
+  const auto legacyKey = CryptKey{"bench-encryption-key"};
+  const auto derivedKey = GetDerivedKey();
+  const auto data = std::vector<uint8_t>(PACKET_DATA_SIZE, 0x5A);
+  auto encBuffer = std::vector<uint8_t>(PACKET_DATA_SIZE + CRYPT_PACKET_OVERHEAD_SIZE);
+  auto decBuffer = std::vector<uint8_t>(PACKET_DATA_SIZE);
+  size_t encLen{}, decLen{};
+
+  runner.Run("crypt/pbkdf2_device_key", [] { CryptUtils::DeriveDeviceKey("bench-encryption-key", "bench-device-id"); });
+
+  // Packets with a per-message PBKDF2 key (unlock protocol 3.0.0) and with HKDF (3.1.0)
+  for(const auto &[kdfName, key] : {std::pair{"pbkdf2", legacyKey}, std::pair{"hkdf", derivedKey}}) {
+    auto prefix = std::string("crypt/aes_packet_") + kdfName;
+    auto encrypted = CryptUtils::EncryptAESPacket(data, key).data;
+    runner.Run(prefix + "_encrypt", [&] { CryptUtils::EncryptAESPacket(data, encBuffer, encLen, key); }, {{"data_bytes", PACKET_DATA_SIZE}});
+    runner.Run(prefix + "_decrypt", [&] { CryptUtils::DecryptAESPacket(encrypted, decBuffer, decLen, key); }, {{"data_bytes", PACKET_DATA_SIZE}});
+    runner.Run(prefix + "_encrypt_vector", [&] { CryptUtils::EncryptAESPacket(data, key); }, {{"data_bytes", PACKET_DATA_SIZE}});
+    runner.Run(prefix + "_decrypt_vector", [&] { CryptUtils::DecryptAESPacket(encrypted, key); }, {{"data_bytes", PACKET_DATA_SIZE}});
+  }
+
+  // After warm-up the AES-GCM part of the span API must not allocate. Key derivation is the exception: OpenSSL's
+  // HKDF allocates a few dozen small blocks per message and PBKDF2 allocates on every iteration. Its count is
+  // measured on its own, the packets must not add anything to it.
+  if(runner.IsEnabled("crypt/aes_packet_allocs")) {
+    CryptUtils::EncryptAESPacket(data, encBuffer, encLen, derivedKey);
+    CryptUtils::DecryptAESPacket(std::span(encBuffer).first(encLen), decBuffer, decLen, derivedKey);
+    auto allocsBefore = AllocCounter::GetCount();
+    for(uint64_t i = 0; i < ALLOC_CHECK_MESSAGES; i++) {
+      CryptUtils::EncryptAESPacket(data, encBuffer, encLen, derivedKey);
+      CryptUtils::DecryptAESPacket(std::span(encBuffer).first(encLen), decBuffer, decLen, derivedKey);
+    }
+    auto packetAllocs = AllocCounter::GetCount() - allocsBefore;
+    uint8_t salt[16]{};
+    uint8_t aesKey[32]{};
+    allocsBefore = AllocCounter::GetCount();
+    for(uint64_t i = 0; i < 2 * ALLOC_CHECK_MESSAGES; i++)
+      CryptUtils::GenerateKey(derivedKey, salt, aesKey);
+    auto kdfAllocs = AllocCounter::GetCount() - allocsBefore;
+    runner.Report("crypt/aes_packet_allocs", {{"allocs_per_message", (double)packetAllocs / (2 * ALLOC_CHECK_MESSAGES)},
+                                              {"kdf_allocs_per_message", (double)kdfAllocs / (2 * ALLOC_CHECK_MESSAGES)}});
+    runner.Expect("crypt/aes_packet_allocs", packetAllocs == kdfAllocs,
+                  fmt::format("{} allocations for {} messages, {} of them in key derivation", packetAllocs, 2 * ALLOC_CHECK_MESSAGES, kdfAllocs));
+  }
+
+  // Large payload in one piece and in chunks through a fixed-size buffer
+  auto streamData = std::vector<uint8_t>(STREAM_DATA_SIZE, 0x5A);
+  runner.Run("crypt/aes_encrypt_4mib", [&] { CryptUtils::EncryptAESPacket(streamData, derivedKey); }, {{"data_bytes", STREAM_DATA_SIZE}});
+  auto chunkBuffer = std::vector<uint8_t>(STREAM_CHUNK_SIZE);
+  runner.Run("crypt/aes_stream_encrypt_4mib", [&] {
+    uint8_t header[CRYPT_HEADER_SIZE]{};
+    uint8_t tag[CRYPT_TAG_SIZE]{};
+    AESStreamEncryptor encryptor{};
+    encryptor.Init(derivedKey, header);
+    for(size_t offset = 0; offset < streamData.size(); offset += STREAM_CHUNK_SIZE)
+      encryptor.Update(std::span(streamData).subspan(offset, STREAM_CHUNK_SIZE), chunkBuffer);
+    encryptor.Final(tag);
+  }, {{"data_bytes", STREAM_DATA_SIZE}, {"buffer_bytes", STREAM_CHUNK_SIZE}});
+
+  // Crypto work of one unlock: request encrypt, response decrypt and password decrypt
+  auto passwordKey = StringUtils::RandomString(64);
+  for(const auto &[version, packetKey, pwKey] : {std::tuple{"3.0.0", legacyKey, CryptKey{passwordKey}},
+                                                 std::tuple{"3.1.0", derivedKey, CryptKey{passwordKey, KeyDerivation::HKDF}}}) {
+    auto response = CryptUtils::EncryptAESPacket(data, packetKey).data;
+    auto passwordEnc = CryptUtils::EncryptAES("bench-password", pwKey).value_or("");
+    runner.Run(std::string("crypt/unlock_") + version, [&] {
+      CryptUtils::EncryptAESPacket(data, encBuffer, encLen, packetKey);
+      CryptUtils::DecryptAESPacket(response, decBuffer, decLen, packetKey);
+      CryptUtils::DecryptAES(passwordEnc, pwKey);
+    });
+  }
+}
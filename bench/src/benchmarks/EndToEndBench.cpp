@@ -0,0 +1,82 @@
+#include "Benchmarks.h"
+
+#include <thread>
+
+#include "connection/unlock/clients/LinkedUnlockClient.h"
+#include "connection/unlock/clients/TCPUnlockClient.h"
+#include "connection/unlock/links/KeepAliveLinkManager.h"
+#include "handler/UnlockHandler.h"
+#include "mock/MockPhone.h"
+
+constexpr int NUM_RUNS = 50;
+constexpr auto LINK_CONNECT_TIMEOUT = std::chrono::seconds(5);
+constexpr auto BENCH_PASSWORD = "bench-password";
+
+using Clock = std::chrono::steady_clock;
+
+// Runs GetResult with a new connection per run and reports the time until it returns
+static void RunUnlocks(BenchRunner &runner, const std::string &name, const std::function<BaseUnlockConnection *()> &createConnection) {
+  std::vector<double> latencies{};
+  int failures{};
+  for(int i = 0; i < NUM_RUNS; i++) {
+    auto handler = UnlockHandler([](const std::string &) {});
+    auto connection = createConnection();
+    if(connection == nullptr) {
+      failures++;
+      continue;
+    }
+    auto startTime = Clock::now();
+    auto result = handler.GetResult(std::vector<BaseUnlockConnection *>{connection});
+    auto latency = std::chrono::duration<double, std::micro>(Clock::now() - startTime).count();
+    if(result.state != UnlockState::SUCCESS || result.password != BENCH_PASSWORD) {
+      failures++;
+      continue;
+    }
+    latencies.push_back(latency);
+  }
+  runner.ReportLatencies(name, latencies, {{"failures", failures}});
+}
+
+static KeepAliveLink *WaitForLink(KeepAliveLinkManager &links, const std::string &deviceId) {
+  auto link = links.GetLink(deviceId);
+  auto deadline = Clock::now() + LINK_CONNECT_TIMEOUT;
+  while(link != nullptr && Clock::now() < deadline) {
+    if(link->Acquire() != SOCKET_INVALID) {
+      link->Release(true);
+      return link;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return nullptr;
+}
+
+void RunEndToEndBenchmarks(BenchRunner &runner) {
+  if(!runner.IsEnabled("e2e/"))
+    return;
+
+  // Servers look devices up in the paired devices storage, so only the client side runs in-process.
+  // pcbu_mock_phone covers UDP pairings against an installed desktop.
+  auto options = MockPhoneOptions();
+  options.device = MockPhone::CreateDevice(PairingMethod::TCP, "bench", BENCH_PASSWORD, options.passwordKey);
+  auto phone = MockPhone(options);
+  if(!phone.ListenTCP())
+    return;
+  auto device = options.device;
+  device.tcpPort = phone.GetTCPPort();
+
+  if(runner.IsEnabled("e2e/tcp")) {
+    RunUnlocks(runner, "e2e/tcp", [&]() { return new TCPUnlockClient({device.ipAddress}, device.tcpPort, device); });
+  }
+  if(runner.IsEnabled("e2e/keep_alive_link")) {
+    auto links = KeepAliveLinkManager();
+    links.Sync({device});
+    if(auto link = WaitForLink(links, device.id)) {
+      RunUnlocks(runner, "e2e/keep_alive_link", [&]() -> BaseUnlockConnection * {
+        auto linkSocket = link->Acquire();
+        return linkSocket != SOCKET_INVALID ? new LinkedUnlockClient(link, linkSocket, device) : nullptr;
+      });
+    }
+    links.Stop();
+  }
+  phone.Stop();
+}
@@ -0,0 +1,53 @@
+#include "Benchmarks.h"
+
+#include <nlohmann/json.hpp>
+
+#include "utils/I18n.h"
+
+#include "generated/LANG_DE_DE.h"
+#include "generated/LANG_EN_US.h"
+#include "generated/LANG_PT_BR.h"
+#include "generated/LANG_PT_PT.h"
+#include "generated/LANG_ZH_CN.h"
+
+constexpr std::string_view LOOKUP_KEY = "wait_server_phone_connect";
+
+static nlohmann::json ToJson(const I18nTable &table) {
+  auto json = nlohmann::json::object();
+  for(const auto &entry : table.GetEntries())
+    if(!entry.key.empty())
+      json[std::string(entry.key)] = std::string(entry.value);
+  return json;
+}
+
+void RunI18nBenchmarks(BenchRunner &runner) {
+  if(!runner.IsEnabled("i18n/"))
+    return;
+
+  // Passed through DoNotOptimize, so the lookups are not computed at compile time
+  auto lookupKey = LOOKUP_KEY;
+  runner.Run("i18n/get", [&] {
+    BenchRunner::DoNotOptimize(lookupKey);
+    BenchRunner::DoNotOptimize(I18n::Get(lookupKey));
+  });
+  runner.Run("i18n/get_format", [] { BenchRunner::DoNotOptimize(I18n::Get("error_not_paired", "bench")); });
+  runner.Run("i18n/table_find", [&] {
+    BenchRunner::DoNotOptimize(lookupKey);
+    BenchRunner::DoNotOptimize(LANG_EN_US_TABLE.Find(lookupKey));
+  });
+
+  // What lookups and static initialization cost when the languages were embedded as JSON
+  auto json = ToJson(LANG_EN_US_TABLE);
+  auto key = std::string(LOOKUP_KEY);
+  runner.Run("i18n/json_find", [&] {
+    if(json.count(key))
+      BenchRunner::DoNotOptimize(json.at(key).get<std::string>());
+  });
+  std::vector<std::string> jsonTexts{};
+  for(const auto *table : {&LANG_EN_US_TABLE, &LANG_DE_DE_TABLE, &LANG_ZH_CN_TABLE, &LANG_PT_PT_TABLE, &LANG_PT_BR_TABLE})
+    jsonTexts.emplace_back(ToJson(*table).dump());
+  runner.Run("i18n/json_parse_all", [&] {
+    for(const auto &text : jsonTexts)
+      BenchRunner::DoNotOptimize(nlohmann::json::parse(text));
+  });
+}
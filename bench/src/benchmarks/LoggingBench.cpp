@@ -0,0 +1,62 @@
+#include "Benchmarks.h"
+
+#include <spdlog/sinks/basic_file_sink.h>
+#include <thread>
+
+#include "shell/Shell.h"
+#include "storage/LoggingSystem.h"
+
+constexpr int NUM_BURSTS = 200;
+constexpr int BURST_LINES = 10; // About what one unlock logs
+constexpr auto BURST_PAUSE = std::chrono::milliseconds(2);
+
+static void LogUnlockLine(spdlog::logger &logger) {
+  logger.info("Connection result: {} (Device={}, Elapsed={}ms)", "SUCCESS", "Bench Phone", 42);
+}
+
+// Latency of every call in bursts of unlock lines, with time for the writer to catch up in between
+static std::vector<double> MeasureBursts(spdlog::logger &logger) {
+  std::vector<double> latenciesUs{};
+  for(int i = 0; i < NUM_BURSTS; i++) {
+    for(int j = 0; j < BURST_LINES; j++) {
+      auto startTime = std::chrono::steady_clock::now();
+      LogUnlockLine(logger);
+      latenciesUs.emplace_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count());
+    }
+    std::this_thread::sleep_for(BURST_PAUSE);
+  }
+  return latenciesUs;
+}
+
+void RunLoggingBenchmarks(BenchRunner &runner) {
+  if(!runner.IsEnabled("logging/"))
+    return;
+  auto dirPath = std::filesystem::temp_directory_path() / "pcbu_bench_logging";
+  Shell::CreateDir(dirPath);
+
+  {
+    // How lines were written before, flushed to the file on the calling thread
+    auto logger = spdlog::logger("bench_sync", std::make_shared<spdlog::sinks::basic_file_sink_mt>((dirPath / "sync.log").string(), true));
+    logger.set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] %v");
+    logger.flush_on(spdlog::level::info);
+    runner.Run("logging/info_sync_flush", [&] { LogUnlockLine(logger); });
+    if(runner.IsEnabled("logging/burst_sync_flush"))
+      runner.ReportLatencies("logging/burst_sync_flush", MeasureBursts(logger));
+  }
+
+  auto options = LoggingOptions();
+  options.printToConsole = false;
+  for(const auto &[suffix, policy] : {std::pair{"async", spdlog::async_overflow_policy::block},
+                                      std::pair{"async_overrun", spdlog::async_overflow_policy::overrun_oldest}}) {
+    options.overflowPolicy = policy;
+    auto logger = LoggingSystem::CreateLogger(dirPath / fmt::format("{}.log", suffix), options);
+    // Sustained logging is limited by the writer thread once the queue is full
+    runner.Run(fmt::format("logging/info_{}", suffix), [&] { LogUnlockLine(*logger); }, {{"queue_size", options.queueSize}});
+    std::this_thread::sleep_for(options.flushInterval);
+    if(runner.IsEnabled(fmt::format("logging/burst_{}", suffix)))
+      runner.ReportLatencies(fmt::format("logging/burst_{}", suffix), MeasureBursts(*logger), {{"queue_size", options.queueSize}});
+  }
+
+  std::error_code ec{};
+  std::filesystem::remove_all(dirPath, ec);
+}
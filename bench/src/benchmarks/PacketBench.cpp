@@ -0,0 +1,51 @@
+#include "Benchmarks.h"
+
+#include "connection/Packets.h"
+#include "utils/CryptUtils.h"
+#include "utils/StringUtils.h"
+
+void RunPacketBenchmarks(BenchRunner &runner) {
+  auto requestData = PacketUnlockRequestData();
+  requestData.user = "bench-user";
+  requestData.program = "sudo";
+  requestData.unlockToken = StringUtils::RandomString(64);
+  auto request = PacketUnlockRequest();
+  request.protoVersion = "3.0.0";
+  request.deviceId = std::string(64, 'd');
+  request.encData = CryptUtils::EncryptAESPacket(std::vector<uint8_t>(128, 0x11), "bench-key").data;
+  runner.Run("packet/unlock_request_data_to_json", [&] { requestData.ToJson().dump(); }, {{"bytes", requestData.ToJson().dump().size()}});
+  runner.Run("packet/unlock_request_data_to_binary", [&] { requestData.ToBinary(); }, {{"bytes", requestData.ToBinary().size()}});
+  runner.Run("packet/unlock_request_to_json", [&] { request.ToJson().dump(); }, {{"bytes", request.ToJson().dump().size()}});
+  runner.Run("packet/unlock_request_to_binary", [&] { request.ToBinary(); }, {{"bytes", request.ToBinary().size()}});
+
+  // Phone side encoding
+  auto passwordKey = StringUtils::RandomString(64);
+  auto responseDataStr = nlohmann::json{{"unlockToken", requestData.unlockToken}, {"passwordKey", passwordKey}}.dump();
+  auto responseStr = nlohmann::json{{"error", ""}, {"encData", StringUtils::ToHexString(request.encData)}}.dump();
+  auto responseDataWriter = BinaryWriter();
+  responseDataWriter.WriteString(requestData.unlockToken);
+  responseDataWriter.WriteString(passwordKey);
+  auto responseDataBin = responseDataWriter.Finish();
+  auto responseWriter = BinaryWriter();
+  responseWriter.WriteString("");
+  responseWriter.WriteBytes(request.encData);
+  auto responseBin = responseWriter.Finish();
+  runner.Run("packet/unlock_response_data_from_json", [&] { BenchRunner::DoNotOptimize(PacketUnlockResponseData::FromJson(responseDataStr)); }, {{"bytes", responseDataStr.size()}});
+  runner.Run("packet/unlock_response_data_from_binary", [&] { BenchRunner::DoNotOptimize(PacketUnlockResponseData::FromBinary(responseDataBin)); }, {{"bytes", responseDataBin.size()}});
+  runner.Run("packet/unlock_response_from_json", [&] { BenchRunner::DoNotOptimize(PacketUnlockResponse::FromJson(responseStr)); }, {{"bytes", responseStr.size()}});
+  runner.Run("packet/unlock_response_from_binary", [&] { BenchRunner::DoNotOptimize(PacketUnlockResponse::FromBinary(responseBin)); }, {{"bytes", responseBin.size()}});
+
+  auto pairInitStr = nlohmann::json{{"protoVersion", "4.0.0"},  {"deviceUUID", std::string(36, 'u')}, {"deviceName", "Bench Phone"},
+                                    {"ipAddress", "192.168.1.2"}, {"tcpPort", 43296}, {"udpPort", 43297}, {"udpManualPort", 43299}, {"cloudToken", ""}}
+                         .dump();
+  runner.Run("packet/pair_init_from_json", [&] { BenchRunner::DoNotOptimize(PacketPairInit::FromJson(pairInitStr)); });
+  auto pairResponse = PacketPairResponse();
+  pairResponse.data.deviceId = std::string(64, 'd');
+  pairResponse.data.macAddresses = {"00:11:22:33:44:55"};
+  pairResponse.data.passwordKey = StringUtils::RandomString(64);
+  runner.Run("packet/pair_response_to_json", [&] { pairResponse.ToJson().dump(); });
+
+  auto broadcast = PacketUDPBroadcast{std::string(64, 'd'), "192.168.1.3", 43298, false};
+  runner.Run("packet/udp_broadcast_to_json", [&] { broadcast.ToJson().dump(); }, {{"bytes", broadcast.ToJson().dump().size()}});
+  runner.Run("packet/udp_broadcast_to_binary", [&] { broadcast.ToBinary(); }, {{"bytes", broadcast.ToBinary().size()}});
+}
@@ -0,0 +1,35 @@
+#include "Benchmarks.h"
+
+#include <atomic>
+#include <thread>
+
+#include "storage/AppSettings.h"
+
+constexpr int NUM_READER_THREADS = 3;
+
+void RunSettingsBenchmarks(BenchRunner &runner) {
+  if(!runner.IsEnabled("settings/"))
+    return;
+  AppSettings::Get();
+
+  runner.Run("settings/get", [] { BenchRunner::DoNotOptimize(AppSettings::Get()); });
+  // What every Get() cost when it returned a copy of the settings under the mutex
+  runner.Run("settings/get_copy", [] {
+    auto settings = *AppSettings::Get();
+    BenchRunner::DoNotOptimize(settings);
+  });
+
+  // Get() while other threads read the settings as fast as they can
+  std::atomic isRunning(true);
+  std::vector<std::thread> readers{};
+  for(int i = 0; i < NUM_READER_THREADS; i++) {
+    readers.emplace_back([&isRunning] {
+      while(isRunning)
+        AppSettings::Get();
+    });
+  }
+  runner.Run("settings/get_contended", [] { BenchRunner::DoNotOptimize(AppSettings::Get()); }, {{"reader_threads", NUM_READER_THREADS}});
+  isRunning = false;
+  for(auto &reader : readers)
+    reader.join();
+}
@@ -0,0 +1,29 @@
+#include "Benchmarks.h"
+
+#include <spdlog/spdlog.h>
+
+#include "shell/Shell.h"
+
+constexpr size_t STORAGE_DATA_SIZE = 4096; // About ten paired devices
+
+void RunStorageBenchmarks(BenchRunner &runner) {
+  if(!runner.IsEnabled("storage/"))
+    return;
+  auto dirPath = std::filesystem::temp_directory_path() / "pcbu_bench_storage";
+  Shell::CreateDir(dirPath);
+  auto filePath = dirPath / "paired_devices.json";
+  auto data = std::vector<uint8_t>(STORAGE_DATA_SIZE, '0');
+
+  // How paired devices were saved before, the chmod ran through a shell on every save
+  runner.Run("storage/save_in_place_shell_chmod", [&] {
+    Shell::WriteBytes(filePath, data);
+    Shell::RunCommand(fmt::format(R"(chmod 600 "{}")", filePath.string()));
+  }, {{"data_bytes", STORAGE_DATA_SIZE}});
+  runner.Run("storage/save_atomic", [&] { Shell::WriteBytesAtomic(filePath, data); }, {{"data_bytes", STORAGE_DATA_SIZE}});
+  // Private files are owned by root
+  if(Shell::IsRunningAsAdmin())
+    runner.Run("storage/save_atomic_private", [&] { Shell::WriteBytesAtomic(filePath, data, true); }, {{"data_bytes", STORAGE_DATA_SIZE}});
+
+  std::error_code ec{};
+  std::filesystem::remove_all(dirPath, ec);
+}
@@ -0,0 +1,15 @@
+#include "Benchmarks.h"
+
+#include "utils/StringUtils.h"
+
+void RunStringBenchmarks(BenchRunner &runner) {
+  for(size_t size : {32, 1024}) {
+    auto data = std::vector<uint8_t>(size, 0xA5);
+    auto hex = StringUtils::ToHexString(data);
+    auto suffix = "_" + std::to_string(size);
+    runner.Run("string/to_hex" + suffix, [&] { StringUtils::ToHexString(data); }, {{"data_bytes", size}});
+    runner.Run("string/from_hex" + suffix, [&] { BenchRunner::DoNotOptimize(StringUtils::FromHexString(hex)); }, {{"data_bytes", size}});
+  }
+  auto secret = std::string("bench-totp-secret-1234");
+  runner.Run("string/to_base32", [&] { StringUtils::ToBase32String(secret); }, {{"data_bytes", secret.size()}});
+}
@@ -0,0 +1,77 @@
+#include "Benchmarks.h"
+
+#include <thread>
+
+#include "handler/UnlockHandler.h"
+
+constexpr int NUM_RUNS = 200;
+constexpr auto RESULT_DELAY = std::chrono::milliseconds(1);
+
+using Clock = std::chrono::steady_clock;
+
+// Reports a result shortly after starting, like a phone answering over a fast link
+class DelayedResultConnection : public BaseUnlockConnection {
+public:
+  explicit DelayedResultConnection(Clock::time_point *resultTime) : m_ResultTime(resultTime) {}
+
+  bool Start() override {
+    m_IsRunning = true;
+    m_AcceptThread = std::thread([this]() {
+      std::this_thread::sleep_for(RESULT_DELAY);
+      SetHasConnection(true);
+      *m_ResultTime = Clock::now();
+      SetUnlockState(UnlockState::CANCELED);
+    });
+    return true;
+  }
+  void Stop() override {
+    m_IsRunning = false;
+    if(m_AcceptThread.joinable())
+      m_AcceptThread.join();
+  }
+
+private:
+  Clock::time_point *m_ResultTime;
+};
+
+// Never reports a result, the run ends through UnlockHandler::Cancel
+class IdleConnection : public BaseUnlockConnection {
+public:
+  bool Start() override {
+    return true;
+  }
+  void Stop() override {}
+};
+
+void RunUnlockHandlerBenchmarks(BenchRunner &runner) {
+  auto printMessage = [](const std::string &) {};
+  if(runner.IsEnabled("unlock_handler/result_latency")) {
+    std::vector<double> latencies{};
+    for(int i = 0; i < NUM_RUNS; i++) {
+      Clock::time_point resultTime{};
+      auto handler = UnlockHandler(printMessage);
+      auto result = handler.GetResult({new DelayedResultConnection(&resultTime)});
+      if(result.state != UnlockState::CANCELED)
+        continue;
+      latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - resultTime).count());
+    }
+    runner.ReportLatencies("unlock_handler/result_latency", latencies);
+  }
+  if(runner.IsEnabled("unlock_handler/cancel_latency")) {
+    std::vector<double> latencies{};
+    for(int i = 0; i < NUM_RUNS; i++) {
+      Clock::time_point cancelTime{};
+      auto handler = UnlockHandler(printMessage);
+      auto cancelThread = std::thread([&]() {
+        std::this_thread::sleep_for(RESULT_DELAY);
+        cancelTime = Clock::now();
+        handler.Cancel();
+      });
+      handler.GetResult({new IdleConnection()});
+      auto returnTime = Clock::now();
+      cancelThread.join();
+      latencies.push_back(std::chrono::duration<double, std::micro>(returnTime - cancelTime).count());
+    }
+    runner.ReportLatencies("unlock_handler/cancel_latency", latencies);
+  }
+}
@@ -0,0 +1,105 @@
+#include "Benchmarks.h"
+
+#ifndef WINDOWS
+#include <arpa/inet.h>
+#include <cstring>
+#include <fstream>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "connection/unlock/servers/TCPUnlockServer.h"
+#include "storage/AppSettings.h"
+
+constexpr size_t MAX_BENCH_CLIENTS = 500;
+constexpr int NUM_PROBES = 20;
+
+static int ConnectClient(uint16_t port) {
+  int clientSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  struct sockaddr_in address {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(clientSocket < 0 || connect(clientSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+    if(clientSocket >= 0)
+      close(clientSocket);
+    return -1;
+  }
+  return clientSocket;
+}
+
+// Connects, sends an empty frame and waits until the server drops the connection
+static bool ProbeServer(uint16_t port) {
+  int clientSocket = ConnectClient(port);
+  if(clientSocket < 0)
+    return false;
+  uint8_t frame[12]{}; // Header, ID and a zero length
+  for(size_t i = 0; i < sizeof(PACKET_HEADER); i++)
+    frame[i] = static_cast<uint8_t>(PACKET_HEADER >> (56 - 8 * i));
+  bool result = write(clientSocket, frame, sizeof(frame)) == sizeof(frame);
+  while(result && read(clientSocket, frame, sizeof(frame)) > 0) {
+  }
+  close(clientSocket);
+  return result;
+}
+
+static double GetResidentKiB() {
+  double pages{}, residentPages{};
+#ifdef LINUX
+  std::ifstream file("/proc/self/statm");
+  file >> pages >> residentPages;
+#endif
+  return residentPages * (double)sysconf(_SC_PAGESIZE) / 1024.0;
+}
+
+void RunUnlockServerBenchmarks(BenchRunner &runner) {
+  if(!runner.IsEnabled("unlock_server/"))
+    return;
+  struct rlimit limit {};
+  if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  auto port = AppSettings::Get()->unlockServerPort;
+  for(size_t numClients : {1, 10, 100, 500}) {
+    auto server = TCPUnlockServer(MAX_BENCH_CLIENTS + 1);
+    if(!server.Start())
+      return;
+    // Wait for the listening socket
+    for(int i = 0; i < 100 && !ProbeServer(port); i++)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    auto residentBefore = GetResidentKiB();
+    std::vector<int> idleClients{};
+    for(size_t i = 0; i < numClients - 1; i++)
+      if(auto clientSocket = ConnectClient(port); clientSocket >= 0)
+        idleClients.push_back(clientSocket);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto residentAfter = GetResidentKiB();
+
+    int successfulProbes = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < NUM_PROBES; i++)
+      successfulProbes += ProbeServer(port) ? 1 : 0;
+    auto probeUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count() / NUM_PROBES;
+
+    auto stopTime = std::chrono::steady_clock::now();
+    server.Stop();
+    auto stopUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - stopTime).count();
+    for(auto clientSocket : idleClients)
+      close(clientSocket);
+
+    runner.Report("unlock_server/clients_" + std::to_string(numClients),
+                  {{"connected_clients", (double)idleClients.size() + 1},
+                   {"probe_roundtrip_us", probeUs},
+                   {"successful_probes", successfulProbes},
+                   {"resident_kib_per_client", idleClients.empty() ? 0.0 : (residentAfter - residentBefore) / (double)idleClients.size()},
+                   {"stop_us", stopUs}});
+  }
+}
+#else
+void RunUnlockServerBenchmarks(BenchRunner &) {}
+#endif
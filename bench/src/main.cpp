@@ -0,0 +1,67 @@
+#include <cstring>
+#include <iostream>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "AllocCounter.h"
+#include "BenchRunner.h"
+#include "benchmarks/Benchmarks.h"
+
+static void PrintUsage() {
+  std::cerr << "Usage: pcbu_bench [--format json|csv] [--filter <name>] [--min-time <ms>] [--auth-user <name>] [--verbose]" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  AllocCounter::Install();
+
+  std::string format = "json";
+  std::string filter{};
+  int minTimeMs = 300;
+  std::string authUser{};
+  bool verbose = false;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      format = argv[++i];
+    } else if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if(strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      minTimeMs = std::atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--auth-user") == 0 && i + 1 < argc) {
+      authUser = argv[++i];
+    } else if(strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+  if(format != "json" && format != "csv") {
+    PrintUsage();
+    return 1;
+  }
+  // Keep library logging out of the results
+  spdlog::set_default_logger(spdlog::stderr_color_mt("pcbu_bench"));
+  spdlog::set_level(verbose ? spdlog::level::debug : spdlog::level::off);
+
+  auto runner = BenchRunner(filter, std::chrono::milliseconds(minTimeMs));
+  RunCryptBenchmarks(runner);
+  RunStringBenchmarks(runner);
+  RunPacketBenchmarks(runner);
+  RunConnectionBenchmarks(runner);
+  RunUnlockServerBenchmarks(runner);
+  RunStorageBenchmarks(runner);
+  RunSettingsBenchmarks(runner);
+  RunI18nBenchmarks(runner);
+  RunLoggingBenchmarks(runner);
+  RunUnlockHandlerBenchmarks(runner);
+  RunEndToEndBenchmarks(runner);
+  RunAuthBenchmarks(runner, authUser);
+
+  if(format == "csv")
+    runner.PrintCsv(std::cout);
+  else
+    runner.PrintJson(std::cout);
+  for(const auto &failure : runner.GetFailures())
+    std::cerr << "FAILED " << failure << std::endl;
+  return runner.GetFailures().empty() ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+#include "MockPhone.h"
+
+#include <spdlog/spdlog.h>
+
+#include "connection/Packets.h"
+#include "connection/SocketDefs.h"
+#include "connection/TCPConnector.h"
+#include "utils/AppInfo.h"
+#include "utils/CryptUtils.h"
+#include "utils/StringUtils.h"
+
+#ifdef WINDOWS
+#include <Ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#endif
+
+constexpr auto READ_TIMEOUT = std::chrono::seconds(60); // Longer than the heartbeat interval of keep-alive links
+constexpr auto WRITE_TIMEOUT = std::chrono::seconds(5);
+constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(5);
+constexpr size_t MAX_DATAGRAM_SIZE = 2048;
+
+MockPhone::MockPhone(MockPhoneOptions options) {
+  WSA_STARTUP
+  m_Options = std::move(options);
+  m_IsBinary = m_Options.device.SupportsUnlockProtocol(UNLOCK_PROTO_VERSION_BINARY);
+  m_IsRunning = m_StopNotifier.Open();
+}
+
+MockPhone::~MockPhone() {
+  Stop();
+}
+
+PairedDevice MockPhone::CreateDevice(PairingMethod method, const std::string &userName, const std::string &password, std::string &passwordKey) {
+  auto device = PairedDevice();
+  device.id = StringUtils::RandomString(32);
+  device.pairingMethod = method;
+  device.deviceName = "Mock phone";
+  device.userName = userName;
+  device.encryptionKey = StringUtils::RandomString(32);
+  device.unlockProtoVersion = AppInfo::GetUnlockProtocolVersion();
+  device.derivedKey = CryptUtils::DeriveDeviceKey(device.encryptionKey, device.id);
+  device.ipAddress = "127.0.0.1";
+  passwordKey = StringUtils::RandomString(64);
+  device.passwordEnc = CryptUtils::EncryptAES(password, device.GetPasswordKey(passwordKey)).value_or("");
+  return device;
+}
+
+bool MockPhone::ListenTCP(uint16_t port, bool isLoopbackOnly) {
+  if(!m_IsRunning || m_TCPSocket != SOCKET_INVALID)
+    return false;
+  if((m_TCPSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) == SOCKET_INVALID) {
+    spdlog::error("socket() failed. (Code={})", SOCKET_LAST_ERROR);
+    return false;
+  }
+  int opt = 1;
+  setsockopt(m_TCPSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&opt), sizeof(opt));
+
+  struct sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(isLoopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+  socklen_t addressLen = sizeof(address);
+  if(bind(m_TCPSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 || listen(m_TCPSocket, SOMAXCONN) < 0 ||
+     getsockname(m_TCPSocket, reinterpret_cast<struct sockaddr *>(&address), &addressLen) < 0) {
+    spdlog::error("Listening on TCP port {} failed. (Code={})", port, SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(m_TCPSocket);
+    return false;
+  }
+  m_TCPPort = ntohs(address.sin_port);
+
+  std::lock_guard lock(m_Mutex);
+  m_Threads.emplace_back(&MockPhone::TCPThread, this);
+  return true;
+}
+
+uint16_t MockPhone::GetTCPPort() const {
+  return m_TCPPort;
+}
+
+bool MockPhone::ListenUDP(uint16_t port) {
+  if(!m_IsRunning || m_UDPSocket != SOCKET_INVALID)
+    return false;
+  if((m_UDPSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == SOCKET_INVALID) {
+    spdlog::error("socket() failed. (Code={})", SOCKET_LAST_ERROR);
+    return false;
+  }
+  int opt = 1;
+  setsockopt(m_UDPSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&opt), sizeof(opt));
+
+  struct sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(m_UDPSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+    spdlog::error("Listening on UDP port {} failed. (Code={})", port, SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(m_UDPSocket);
+    return false;
+  }
+
+  std::lock_guard lock(m_Mutex);
+  m_Threads.emplace_back(&MockPhone::UDPThread, this);
+  return true;
+}
+
+bool MockPhone::ConnectToServer(const std::string &ipAddress, uint16_t port) {
+  if(!m_IsRunning)
+    return false;
+  auto serverSocket = TCPConnector::Connect({ipAddress}, port, CONNECT_TIMEOUT, &m_StopNotifier);
+  if(serverSocket == SOCKET_INVALID) {
+    spdlog::error("Connecting to unlock server {}:{} failed.", ipAddress, port);
+    return false;
+  }
+  m_IsServerConnected = true;
+  StartConnectionThread(serverSocket, true);
+  return true;
+}
+
+void MockPhone::Stop() {
+  if(!m_IsRunning.exchange(false))
+    return;
+  m_StopNotifier.Notify();
+  {
+    std::lock_guard lock(m_Mutex);
+    for(auto socket : m_OpenSockets) {
+#ifdef WINDOWS
+      shutdown(socket, SD_BOTH);
+#else
+      shutdown(socket, SHUT_RDWR);
+#endif
+    }
+  }
+  // Connection threads may still be added by the listening threads until those have ended
+  while(true) {
+    std::vector<std::thread> threads{};
+    {
+      std::lock_guard lock(m_Mutex);
+      threads.swap(m_Threads);
+    }
+    if(threads.empty())
+      break;
+    for(auto &thread : threads)
+      thread.join();
+  }
+  SOCKET_CLOSE(m_TCPSocket);
+  SOCKET_CLOSE(m_UDPSocket);
+  m_StopNotifier.Close();
+}
+
+uint32_t MockPhone::GetNumResponses() const {
+  return m_NumResponses;
+}
+
+void MockPhone::TCPThread() {
+  while(m_IsRunning) {
+    struct pollfd pollFds[2]{};
+    pollFds[0] = {m_TCPSocket, POLLIN, 0};
+    pollFds[1] = {m_StopNotifier.GetSocket(), POLLIN, 0};
+    if(SOCKET_POLL(pollFds, 2, -1) < 0 || pollFds[1].revents != 0)
+      break;
+    auto clientSocket = accept(m_TCPSocket, nullptr, nullptr);
+    if(clientSocket == SOCKET_INVALID)
+      continue;
+    StartConnectionThread(clientSocket, false);
+  }
+}
+
+void MockPhone::UDPThread() {
+  std::vector<uint8_t> buffer(MAX_DATAGRAM_SIZE);
+  while(m_IsRunning) {
+    struct pollfd pollFds[2]{};
+    pollFds[0] = {m_UDPSocket, POLLIN, 0};
+    pollFds[1] = {m_StopNotifier.GetSocket(), POLLIN, 0};
+    if(SOCKET_POLL(pollFds, 2, -1) < 0 || pollFds[1].revents != 0)
+      break;
+    auto numBytes = recvfrom(m_UDPSocket, reinterpret_cast<char *>(buffer.data()), (int)buffer.size(), 0, nullptr, nullptr);
+    if(numBytes <= 0)
+      continue;
+
+    auto data = std::span<const uint8_t>(buffer.data(), numBytes);
+    auto broadcast = m_IsBinary ? PacketUDPBroadcast::FromBinary(data) : PacketUDPBroadcast::FromJson(std::string(data.begin(), data.end()));
+    if(!broadcast.has_value() || broadcast->deviceId != m_Options.device.id)
+      continue;
+    // The desktop repeats its broadcast until a phone has connected
+    if(m_IsServerConnected)
+      continue;
+    spdlog::info("Unlock broadcast received. (Server={}:{})", broadcast->pcbuIP, broadcast->pcbuPort);
+    ConnectToServer(broadcast->pcbuIP, broadcast->pcbuPort);
+  }
+}
+
+void MockPhone::StartConnectionThread(SOCKET socket, bool sendDeviceId) {
+  std::lock_guard lock(m_Mutex);
+  if(!m_IsRunning) {
+    SOCKET_CLOSE(socket);
+    if(sendDeviceId)
+      m_IsServerConnected = false;
+    return;
+  }
+  m_OpenSockets.insert(socket);
+  m_Threads.emplace_back(&MockPhone::ServeConnection, this, socket, sendDeviceId);
+}
+
+void MockPhone::ServeConnection(SOCKET socket, bool sendDeviceId) {
+  auto isLink = false;
+  if(sendDeviceId) {
+    auto &deviceId = m_Options.device.id;
+    if(WritePacket(socket, PACKET_ID_DEVICE_ID, {reinterpret_cast<const uint8_t *>(deviceId.data()), deviceId.size()}, WRITE_TIMEOUT) != PacketError::NONE)
+      goto connectionEnd;
+  }
+
+  {
+    PacketReadBuffer readBuffer{};
+    while(m_IsRunning) {
+      auto packet = ReadPacket(socket, readBuffer, READ_TIMEOUT);
+      if(packet.error != PacketError::NONE)
+        break;
+      if(packet.id == PACKET_ID_HEARTBEAT) {
+        // Like the app, a connection that starts with a heartbeat is kept open after unlocks
+        isLink = true;
+        if(!SendHeartbeatResponse(socket, packet))
+          break;
+      } else if(packet.id == PACKET_ID_UNLOCK_REQUEST) {
+        if(!SendUnlockResponse(socket, packet) || !isLink)
+          break;
+      } else {
+        spdlog::warn("Unexpected packet. (ID={0:X})", packet.id);
+        break;
+      }
+    }
+  }
+
+connectionEnd:
+  {
+    std::lock_guard lock(m_Mutex);
+    m_OpenSockets.erase(socket);
+  }
+  SOCKET_CLOSE(socket);
+  if(sendDeviceId)
+    m_IsServerConnected = false;
+}
+
+bool MockPhone::SendUnlockResponse(SOCKET socket, const Packet &packet) {
+  auto key = m_Options.device.GetPacketKey();
+  auto request = m_IsBinary ? PacketUnlockRequest::FromBinary(packet.data) : PacketUnlockRequest::FromJson({packet.data.begin(), packet.data.end()});
+  if(!request.has_value() || request->deviceId != m_Options.device.id) {
+    spdlog::error("Invalid unlock request.");
+    return false;
+  }
+  auto requestData = CryptUtils::DecryptAESPacket(request->encData, key);
+  if(requestData.result != PacketCryptResult::OK) {
+    spdlog::error("Decrypting unlock request failed. (Result={})", static_cast<int>(requestData.result));
+    return false;
+  }
+  auto unlockData = m_IsBinary ? PacketUnlockRequestData::FromBinary(requestData.data)
+                               : PacketUnlockRequestData::FromJson({requestData.data.begin(), requestData.data.end()});
+  if(!unlockData.has_value()) {
+    spdlog::error("Invalid unlock request data.");
+    return false;
+  }
+
+  if(m_Options.responseDelay.count() > 0) {
+    struct pollfd pollFd{};
+    pollFd.fd = m_StopNotifier.GetSocket();
+    pollFd.events = POLLIN;
+    if(SOCKET_POLL(&pollFd, 1, static_cast<int>(m_Options.responseDelay.count())) != 0)
+      return false;
+  }
+
+  auto response = PacketUnlockResponse();
+  response.error = m_Options.error;
+  if(response.error.empty()) {
+    auto responseData = PacketUnlockResponseData();
+    responseData.unlockToken = unlockData->unlockToken;
+    responseData.passwordKey = m_Options.passwordKey;
+    std::vector<uint8_t> responseDataBytes{};
+    if(m_IsBinary) {
+      responseDataBytes = responseData.ToBinary();
+    } else {
+      auto responseDataStr = responseData.ToJson().dump();
+      responseDataBytes = {responseDataStr.begin(), responseDataStr.end()};
+    }
+    auto cryptResult = CryptUtils::EncryptAESPacket(responseDataBytes, key);
+    if(cryptResult.result != PacketCryptResult::OK)
+      return false;
+    response.encData = std::move(cryptResult.data);
+  }
+  std::vector<uint8_t> responseBytes{};
+  if(m_IsBinary) {
+    responseBytes = response.ToBinary();
+  } else {
+    auto responseStr = response.ToJson().dump();
+    responseBytes = {responseStr.begin(), responseStr.end()};
+  }
+  if(WritePacket(socket, PACKET_ID_UNLOCK_RESPONSE, responseBytes, WRITE_TIMEOUT) != PacketError::NONE)
+    return false;
+  m_NumResponses++;
+  return true;
+}
+
+bool MockPhone::SendHeartbeatResponse(SOCKET socket, const Packet &packet) {
+  auto key = m_Options.device.GetPacketKey();
+  auto heartbeat = CryptUtils::DecryptAESPacket(packet.data, key);
+  if(heartbeat.result != PacketCryptResult::OK || heartbeat.data.empty() || heartbeat.data[0] != PACKET_HEARTBEAT_REQUEST) {
+    spdlog::error("Invalid heartbeat.");
+    return false;
+  }
+  heartbeat.data[0] = PACKET_HEARTBEAT_RESPONSE;
+  auto cryptResult = CryptUtils::EncryptAESPacket(heartbeat.data, key);
+  if(cryptResult.result != PacketCryptResult::OK)
+    return false;
+  return WritePacket(socket, PACKET_ID_HEARTBEAT, cryptResult.data, WRITE_TIMEOUT) == PacketError::NONE;
+}
@@ -0,0 +1,69 @@
+#ifndef PCBU_BENCH_MOCKPHONE_H
+#define PCBU_BENCH_MOCKPHONE_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "connection/BaseConnection.h"
+#include "connection/SocketNotifier.h"
+#include "storage/PairedDevicesStorage.h"
+
+struct MockPhoneOptions {
+  PairedDevice device{};
+  std::string passwordKey{};                 // Returned in every successful response
+  std::chrono::milliseconds responseDelay{}; // Time the "user" takes to confirm
+  std::string error{};                       // e.g. CANCEL or APP_ERROR, sent instead of a successful response
+};
+
+// Plays the phone side of the unlock protocol over the network, for tests and benchmarks without a real phone.
+// It answers unlock requests and heartbeats like the app does for devices paired over TCP, and answers unlock
+// broadcasts by connecting to the desktop's unlock server like it does for devices paired over UDP.
+class MockPhone : public BaseConnection {
+public:
+  explicit MockPhone(MockPhoneOptions options);
+  ~MockPhone();
+  MockPhone(const MockPhone &) = delete;
+  MockPhone &operator=(const MockPhone &) = delete;
+
+  // Creates a paired device with its password encrypted the way pairing does, passwordKey receives the phone's key
+  static PairedDevice CreateDevice(PairingMethod method, const std::string &userName, const std::string &password, std::string &passwordKey);
+
+  // Waits for connections from TCPUnlockClient on loopback or all interfaces, port 0 picks a free port
+  bool ListenTCP(uint16_t port = 0, bool isLoopbackOnly = true);
+  [[nodiscard]] uint16_t GetTCPPort() const;
+  // Waits for unlock broadcasts addressed to the device and connects to the announced unlock server
+  bool ListenUDP(uint16_t port);
+  // Connects to an unlock server and answers its request, like after receiving a broadcast
+  bool ConnectToServer(const std::string &ipAddress, uint16_t port);
+  void Stop();
+
+  [[nodiscard]] uint32_t GetNumResponses() const;
+
+private:
+  void TCPThread();
+  void UDPThread();
+  void ServeConnection(SOCKET socket, bool sendDeviceId);
+  bool SendUnlockResponse(SOCKET socket, const Packet &packet);
+  bool SendHeartbeatResponse(SOCKET socket, const Packet &packet);
+  void StartConnectionThread(SOCKET socket, bool sendDeviceId);
+
+  MockPhoneOptions m_Options{};
+  bool m_IsBinary{};
+  std::atomic<bool> m_IsRunning{};
+  std::atomic<uint32_t> m_NumResponses{};
+  std::atomic<bool> m_IsServerConnected{};
+  SOCKET m_TCPSocket = SOCKET_INVALID;
+  SOCKET m_UDPSocket = SOCKET_INVALID;
+  uint16_t m_TCPPort{};
+  SocketNotifier m_StopNotifier{};
+  std::vector<std::thread> m_Threads{};
+  std::set<SOCKET> m_OpenSockets{};
+  std::mutex m_Mutex{};
+};
+
+#endif // PCBU_BENCH_MOCKPHONE_H
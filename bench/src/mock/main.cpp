@@ -0,0 +1,124 @@
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <spdlog/spdlog.h>
+#include <thread>
+
+#include "MockPhone.h"
+
+static std::atomic<bool> g_IsStopped{};
+
+static void PrintUsage() {
+  std::cerr << "Usage: pcbu_mock_phone pair --user <name> --password <password> [--method tcp|udp] [--port <port>]" << std::endl;
+  std::cerr << "       pcbu_mock_phone serve --device-id <id> --password-key <key> [--delay <ms>] [--error <code>]" << std::endl;
+  std::cerr << "       pcbu_mock_phone unpair --device-id <id>" << std::endl;
+}
+
+static int Pair(const std::string &userName, const std::string &password, const std::string &method, uint16_t port) {
+  if(method != "tcp" && method != "udp") {
+    PrintUsage();
+    return 1;
+  }
+  std::string passwordKey{};
+  auto device = MockPhone::CreateDevice(method == "tcp" ? PairingMethod::TCP : PairingMethod::UDP, userName, password, passwordKey);
+  if(device.passwordEnc.empty()) {
+    std::cerr << "Encrypting the password failed." << std::endl;
+    return 1;
+  }
+  device.tcpPort = port;
+  device.udpPort = port;
+  PairedDevicesStorage::AddDevice(device);
+  std::cout << "Paired mock phone for " << userName << ". Start it with:" << std::endl;
+  std::cout << "pcbu_mock_phone serve --device-id " << device.id << " --password-key " << passwordKey << std::endl;
+  return 0;
+}
+
+static int Serve(const std::string &deviceId, const std::string &passwordKey, int delayMs, const std::string &error) {
+  auto device = PairedDevicesStorage::GetDeviceByID(deviceId);
+  if(device == nullptr) {
+    std::cerr << "Device " << deviceId << " is not paired." << std::endl;
+    return 1;
+  }
+  auto options = MockPhoneOptions();
+  options.device = *device;
+  options.passwordKey = passwordKey;
+  options.responseDelay = std::chrono::milliseconds(delayMs);
+  options.error = error;
+
+  auto phone = MockPhone(options);
+  auto isListening = false;
+  switch(device->pairingMethod) {
+    case PairingMethod::TCP:
+      isListening = phone.ListenTCP(device->tcpPort);
+      break;
+    case PairingMethod::UDP:
+      isListening = phone.ListenUDP(device->udpPort);
+      break;
+    case PairingMethod::MANUAL_UDP:
+      isListening = phone.ListenUDP(device->udpManualPort);
+      break;
+    default:
+      std::cerr << "Only devices paired over TCP or UDP can be mocked." << std::endl;
+      return 1;
+  }
+  if(!isListening)
+    return 1;
+
+  std::cout << "Waiting for unlock requests, press Ctrl+C to stop." << std::endl;
+  std::signal(SIGINT, [](int) { g_IsStopped = true; });
+  std::signal(SIGTERM, [](int) { g_IsStopped = true; });
+  uint32_t numResponses{};
+  while(!g_IsStopped) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if(phone.GetNumResponses() != numResponses) {
+      numResponses = phone.GetNumResponses();
+      std::cout << "Answered unlock request " << numResponses << "." << std::endl;
+    }
+  }
+  phone.Stop();
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if(argc < 2) {
+    PrintUsage();
+    return 1;
+  }
+  std::string command = argv[1];
+  std::string userName{}, password{}, method = "tcp", deviceId{}, passwordKey{}, error{};
+  uint16_t port = 43298;
+  int delayMs = 0;
+  for(int i = 2; i < argc; i++) {
+    if(strcmp(argv[i], "--user") == 0 && i + 1 < argc) {
+      userName = argv[++i];
+    } else if(strcmp(argv[i], "--password") == 0 && i + 1 < argc) {
+      password = argv[++i];
+    } else if(strcmp(argv[i], "--method") == 0 && i + 1 < argc) {
+      method = argv[++i];
+    } else if(strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = static_cast<uint16_t>(std::atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--device-id") == 0 && i + 1 < argc) {
+      deviceId = argv[++i];
+    } else if(strcmp(argv[i], "--password-key") == 0 && i + 1 < argc) {
+      passwordKey = argv[++i];
+    } else if(strcmp(argv[i], "--delay") == 0 && i + 1 < argc) {
+      delayMs = std::atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--error") == 0 && i + 1 < argc) {
+      error = argv[++i];
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  if(command == "pair" && !userName.empty() && !password.empty())
+    return Pair(userName, password, method, port);
+  if(command == "serve" && !deviceId.empty() && !passwordKey.empty())
+    return Serve(deviceId, passwordKey, delayMs, error);
+  if(command == "unpair" && !deviceId.empty()) {
+    PairedDevicesStorage::RemoveDevice(deviceId);
+    return 0;
+  }
+  PrintUsage();
+  return 1;
+}
@@ -0,0 +1,129 @@
+# Generates a header with a constexpr I18nTable (common/src/utils/I18nTable.h) from a language JSON file.
+# Usage: cmake -DJSON_FILE=<json> -DOUTPUT_FILE=<header> -DVARIABLE_PREFIX=<prefix> -P GenerateLanguageTable.cmake
+#
+# Keys are placed with hash and displace: every key falls into a bucket by its hash, and each bucket,
+# largest first, gets the first seed that moves all of its keys to free slots. Hash() and Mix() have
+# to match I18nTable.
+cmake_minimum_required(VERSION 3.22)
+
+set(HASH_MASK 4294967295)
+set(MAX_SEED 65536)
+
+function(fnv1a_hash STR OUT_VAR)
+    string(HEX "${STR}" hex)
+    string(LENGTH "${hex}" hexLength)
+    set(hash 2166136261)
+    set(i 0)
+    while(i LESS hexLength)
+        string(SUBSTRING "${hex}" ${i} 2 byte)
+        math(EXPR hash "((${hash} ^ 0x${byte}) * 16777619) & ${HASH_MASK}")
+        math(EXPR i "${i} + 2")
+    endwhile()
+    set(${OUT_VAR} ${hash} PARENT_SCOPE)
+endfunction()
+
+function(mix_hash VALUE OUT_VAR)
+    math(EXPR value "(((${VALUE} >> 16) ^ ${VALUE}) * 73244475) & ${HASH_MASK}")
+    math(EXPR value "(((${value} >> 16) ^ ${value}) * 73244475) & ${HASH_MASK}")
+    math(EXPR value "(${value} >> 16) ^ ${value}")
+    set(${OUT_VAR} ${value} PARENT_SCOPE)
+endfunction()
+
+function(next_power_of_two VALUE OUT_VAR)
+    set(result 1)
+    while(result LESS VALUE)
+        math(EXPR result "${result} * 2")
+    endwhile()
+    set(${OUT_VAR} ${result} PARENT_SCOPE)
+endfunction()
+
+file(READ "${JSON_FILE}" json)
+string(JSON numKeys LENGTH "${json}")
+if(numKeys EQUAL 0)
+    message(FATAL_ERROR "${JSON_FILE} has no strings.")
+endif()
+math(EXPR lastKey "${numKeys} - 1")
+math(EXPR minSlots "${numKeys} + ${numKeys} / 4")
+math(EXPR minBuckets "(${numKeys} + 1) / 2")
+next_power_of_two(${minSlots} numSlots)
+next_power_of_two(${minBuckets} numBuckets)
+math(EXPR slotMask "${numSlots} - 1")
+math(EXPR bucketMask "${numBuckets} - 1")
+
+set(maxBucketSize 0)
+foreach(keyIdx RANGE ${lastKey})
+    string(JSON key MEMBER "${json}" ${keyIdx})
+    string(JSON value GET "${json}" "${key}")
+    set(KEY_${keyIdx} "${key}")
+    set(VALUE_${keyIdx} "${value}")
+    fnv1a_hash("${key}" hash)
+    set(HASH_${keyIdx} ${hash})
+    math(EXPR bucket "${hash} & ${bucketMask}")
+    list(APPEND BUCKET_${bucket} ${keyIdx})
+    list(LENGTH BUCKET_${bucket} bucketSize)
+    if(bucketSize GREATER maxBucketSize)
+        set(maxBucketSize ${bucketSize})
+    endif()
+endforeach()
+
+math(EXPR lastBucket "${numBuckets} - 1")
+set(bucketSize ${maxBucketSize})
+while(bucketSize GREATER 0)
+    foreach(bucket RANGE ${lastBucket})
+        list(LENGTH BUCKET_${bucket} size)
+        if(NOT size EQUAL bucketSize)
+            continue()
+        endif()
+        set(seed -1)
+        set(isFree FALSE)
+        while(NOT isFree)
+            math(EXPR seed "${seed} + 1")
+            if(seed GREATER_EQUAL MAX_SEED)
+                message(FATAL_ERROR "No seed found for bucket ${bucket} of ${JSON_FILE}.")
+            endif()
+            set(slots "")
+            set(isFree TRUE)
+            foreach(keyIdx IN LISTS BUCKET_${bucket})
+                math(EXPR seeded "${HASH_${keyIdx}} ^ ${seed}")
+                mix_hash(${seeded} mixed)
+                math(EXPR slot "${mixed} & ${slotMask}")
+                if(DEFINED SLOT_${slot} OR slot IN_LIST slots)
+                    set(isFree FALSE)
+                    break()
+                endif()
+                list(APPEND slots ${slot})
+            endforeach()
+        endwhile()
+        set(SEED_${bucket} ${seed})
+        foreach(keyIdx slot IN ZIP_LISTS BUCKET_${bucket} slots)
+            set(SLOT_${slot} ${keyIdx})
+        endforeach()
+    endforeach()
+    math(EXPR bucketSize "${bucketSize} - 1")
+endwhile()
+
+get_filename_component(jsonName "${JSON_FILE}" NAME)
+set(header "// Generated from ${jsonName}, do not edit.\n")
+string(APPEND header "#ifndef PCBU_${VARIABLE_PREFIX}_H\n#define PCBU_${VARIABLE_PREFIX}_H\n\n")
+string(APPEND header "#include \"utils/I18nTable.h\"\n\n")
+string(APPEND header "inline constexpr I18nTable::Entry ${VARIABLE_PREFIX}_ENTRIES[] = {\n")
+foreach(slot RANGE ${slotMask})
+    if(DEFINED SLOT_${slot})
+        set(keyIdx ${SLOT_${slot}})
+        string(APPEND header "    {R\"i18n(${KEY_${keyIdx}})i18n\", R\"i18n(${VALUE_${keyIdx}})i18n\"},\n")
+    else()
+        string(APPEND header "    {},\n")
+    endif()
+endforeach()
+string(APPEND header "};\n")
+string(APPEND header "inline constexpr uint32_t ${VARIABLE_PREFIX}_SEEDS[] = {")
+foreach(bucket RANGE ${lastBucket})
+    if(NOT DEFINED SEED_${bucket})
+        set(SEED_${bucket} 0)
+    endif()
+    string(APPEND header "${SEED_${bucket}},")
+endforeach()
+string(APPEND header "};\n")
+string(APPEND header "inline constexpr I18nTable ${VARIABLE_PREFIX}_TABLE{${VARIABLE_PREFIX}_ENTRIES, ${VARIABLE_PREFIX}_SEEDS};\n\n")
+string(APPEND header "#endif\n")
+file(WRITE "${OUTPUT_FILE}" "${header}")
@@ -1,17 +1,27 @@
 #include "BaseConnection.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <spdlog/spdlog.h>
-#include <thread>
 
 #include "Packets.h"
 #include "SocketDefs.h"
 
+#ifndef WINDOWS
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 #ifdef LINUX
 #define htonll(x) ((1 == htonl(1)) ? (x) : (((uint64_t)htonl((x) & 0xFFFFFFFFUL)) << 32) | htonl((uint32_t)((x) >> 32)))
 #define ntohll(x) ((1 == ntohl(1)) ? (x) : (((uint64_t)ntohl((x) & 0xFFFFFFFFUL)) << 32) | ntohl((uint32_t)((x) >> 32)))
 #endif
 
+constexpr size_t PACKET_PREFIX_SIZE = sizeof(PACKET_HEADER) + sizeof(uint16_t) + sizeof(uint16_t);
+constexpr size_t PACKET_READ_BUFFER_SIZE = 4096;
+constexpr size_t MAX_WRITE_BUFFERS = 8;
+
 bool BaseConnection::IsServer() {
   return false;
 }
@@ -45,132 +55,252 @@ bool BaseConnection::SetSocketRWTimeout(SOCKET socket, uint32_t secs) {
   return true;
 }
 
-Packet BaseConnection::ReadPacket(SOCKET socket) {
-  uint8_t correctHeaderBytes{};
-  auto headerBE = htonll(PACKET_HEADER);
-  spdlog::debug("Reading packet header...");
-  while(correctHeaderBytes < sizeof(PACKET_HEADER)) {
-    uint8_t headerByte{};
-    int result = (int)read(socket, &headerByte, 1);
-    if(result <= 0) {
-      auto error = GetPacketError(result, SOCKET_LAST_ERROR);
-      if(error != PacketError::NONE) {
-        spdlog::error("Reading packet header failed.");
-        return {error};
-      }
-    } else {
-      if(headerByte == reinterpret_cast<uint8_t *>(&headerBE)[correctHeaderBytes])
-        correctHeaderBytes++;
-      else
-        correctHeaderBytes = 0;
+Packet BaseConnection::ReadPacket(SOCKET socket, std::chrono::milliseconds timeout) {
+  PacketReadBuffer buffer{};
+  return ReadPacket(socket, buffer, timeout);
+}
+
+Packet BaseConnection::ReadPacket(SOCKET socket, PacketReadBuffer &buffer, std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  Packet packet{};
+  size_t minSize{};
+  spdlog::debug("Reading packet...");
+  while(!ParsePacket(buffer, packet, minSize)) {
+    auto error = FillBuffer(socket, buffer, minSize, deadline);
+    if(error != PacketError::NONE) {
+      spdlog::error("Reading packet failed. (Buffered={}, Required={})", buffer.end - buffer.start, minSize);
+      return {error};
     }
   }
+  spdlog::debug("Done reading packet.");
+  return packet;
+}
 
-  spdlog::debug("Reading packet ID...");
-  uint16_t packetId{};
-  auto result = ReadData(socket, sizeof(packetId));
-  if(result.first != PacketError::NONE || result.second.size() != sizeof(packetId)) {
-    spdlog::error("Reading packet ID failed.");
-    return {result.first};
-  }
-  std::memcpy(&packetId, result.second.data(), sizeof(packetId));
-  packetId = ntohs(packetId);
-
-  spdlog::debug("Reading packet length... (ID={0:X})", packetId);
-  uint16_t packetLength{};
-  result = ReadData(socket, sizeof(packetLength));
-  if(result.first != PacketError::NONE || result.second.size() != sizeof(packetLength)) {
-    spdlog::error("Reading packet length failed.");
-    return {result.first};
-  }
-  std::memcpy(&packetLength, result.second.data(), sizeof(packetLength));
-  packetLength = ntohs(packetLength);
+bool BaseConnection::ParsePacket(PacketReadBuffer &buffer, Packet &packet, size_t &minSize) {
+  auto headerBE = htonll(PACKET_HEADER);
+  auto headerBytes = reinterpret_cast<const uint8_t *>(&headerBE);
+  while(true) {
+    auto bufferBegin = buffer.data.begin() + static_cast<ptrdiff_t>(buffer.start);
+    auto bufferEnd = buffer.data.begin() + static_cast<ptrdiff_t>(buffer.end);
+    auto headerPos = std::search(bufferBegin, bufferEnd, headerBytes, headerBytes + sizeof(PACKET_HEADER));
+    if(headerPos == bufferEnd) {
+      // Drop garbage, but keep the bytes that may still be the beginning of a header
+      if(buffer.end - buffer.start >= sizeof(PACKET_HEADER))
+        buffer.start = buffer.end - (sizeof(PACKET_HEADER) - 1);
+      minSize = buffer.end - buffer.start + 1;
+      return false;
+    }
+    buffer.start = static_cast<size_t>(headerPos - buffer.data.begin());
+    if(buffer.end - buffer.start < PACKET_PREFIX_SIZE) {
+      minSize = PACKET_PREFIX_SIZE;
+      return false;
+    }
 
-  if(packetLength == 0) {
-    spdlog::error("Empty packet received.");
-    return {PacketError::UNKNOWN};
-  }
+    uint16_t packetId{};
+    uint16_t packetLength{};
+    auto prefix = buffer.data.data() + buffer.start + sizeof(PACKET_HEADER);
+    std::memcpy(&packetId, prefix, sizeof(packetId));
+    std::memcpy(&packetLength, prefix + sizeof(packetId), sizeof(packetLength));
+    packetId = ntohs(packetId);
+    packetLength = ntohs(packetLength);
+    bool isContinued = (packetId & PACKET_FLAG_CONTINUED) != 0;
+    packetId &= ~PACKET_FLAG_CONTINUED;
+    if(packetLength == 0) {
+      buffer.start += PACKET_PREFIX_SIZE;
+      buffer.chunkData = {};
+      spdlog::error("Empty packet received.");
+      packet = {PacketError::UNKNOWN};
+      return true;
+    }
+    if(buffer.end - buffer.start < PACKET_PREFIX_SIZE + packetLength) {
+      minSize = PACKET_PREFIX_SIZE + packetLength;
+      return false;
+    }
 
-  spdlog::debug("Reading packet data... (Len={})", packetLength);
-  result = ReadData(socket, packetLength);
-  if(result.first != PacketError::NONE || result.second.size() != packetLength) {
-    spdlog::error("Reading packet data failed. (Len={})", packetLength);
-    return {result.first};
+    spdlog::debug("Parsing packet data... (ID={0:X}, Len={1}, Continued={2})", packetId, packetLength, isContinued);
+    auto payload = buffer.data.data() + buffer.start + PACKET_PREFIX_SIZE;
+    if(!isContinued && buffer.chunkData.empty()) {
+      packet = Packet{PacketError::NONE, packetId, {payload, payload + packetLength}};
+    } else {
+      // Join the frames of a packet that did not fit into a single frame
+      if((!buffer.chunkData.empty() && buffer.chunkId != packetId) || buffer.chunkData.size() + packetLength > PACKET_MAX_DATA_SIZE) {
+        spdlog::error("Invalid packet frame received. (ID={0:X}, Received={1})", packetId, buffer.chunkData.size());
+        buffer.chunkData = {};
+        packet = {PacketError::UNKNOWN};
+      } else {
+        buffer.chunkId = packetId;
+        buffer.chunkData.insert(buffer.chunkData.end(), payload, payload + packetLength);
+        if(isContinued) {
+          buffer.start += PACKET_PREFIX_SIZE + packetLength;
+          continue;
+        }
+        packet = Packet{PacketError::NONE, packetId, std::move(buffer.chunkData)};
+        buffer.chunkData = {};
+      }
+    }
+    buffer.start += PACKET_PREFIX_SIZE + packetLength;
+    if(buffer.start == buffer.end)
+      buffer.start = buffer.end = 0;
+    return true;
   }
-  spdlog::debug("Done reading packet.");
-  return {PacketError::NONE, packetId, result.second};
 }
 
-PacketError BaseConnection::WritePacket(SOCKET socket, uint16_t packetId, const std::vector<uint8_t> &data) {
-  PacketError error{};
-  spdlog::debug("Writing packet header...");
+static void WriteFramePrefix(uint8_t *dst, uint16_t packetId, uint16_t length) {
   uint64_t packetHeader = htonll(PACKET_HEADER);
-  error = WriteData(socket, reinterpret_cast<const char *>(&packetHeader), sizeof(packetHeader));
-  if(error != PacketError::NONE) {
-    spdlog::error("Writing packet header failed.");
-    return error;
-  }
-
-  spdlog::debug("Writing packet ID... (ID={0:X})", packetId);
   uint16_t packetIdNet = htons(packetId);
-  error = WriteData(socket, reinterpret_cast<const char *>(&packetIdNet), sizeof(packetIdNet));
-  if(error != PacketError::NONE) {
-    spdlog::error("Writing packet ID failed.");
-    return error;
-  }
+  uint16_t packetSize = htons(length);
+  std::memcpy(dst, &packetHeader, sizeof(packetHeader));
+  std::memcpy(dst + sizeof(packetHeader), &packetIdNet, sizeof(packetIdNet));
+  std::memcpy(dst + sizeof(packetHeader) + sizeof(packetIdNet), &packetSize, sizeof(packetSize));
+}
 
-  spdlog::debug("Writing packet length... (Len={})", data.size());
-  uint16_t packetSize = htons(static_cast<uint16_t>(data.size()));
-  error = WriteData(socket, reinterpret_cast<const char *>(&packetSize), sizeof(packetSize));
-  if(error != PacketError::NONE) {
-    spdlog::error("Writing packet length failed.");
-    return error;
+PacketError BaseConnection::WritePacket(SOCKET socket, uint16_t packetId, std::span<const uint8_t> data, std::chrono::milliseconds timeout) {
+  if(data.size() > PACKET_MAX_DATA_SIZE || (packetId & PACKET_FLAG_CONTINUED) != 0) {
+    spdlog::error("Invalid packet. (ID={0:X}, Len={1})", packetId, data.size());
+    return PacketError::UNKNOWN;
   }
 
-  spdlog::debug("Writing packet data...");
-  error = WriteData(socket, reinterpret_cast<const char *>(data.data()), data.size());
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  spdlog::debug("Writing packet... (ID={0:X}, Len={1})", packetId, data.size());
+  PacketError error{};
+  if(data.size() <= UINT16_MAX) {
+    uint8_t prefix[PACKET_PREFIX_SIZE]{};
+    WriteFramePrefix(prefix, packetId, static_cast<uint16_t>(data.size()));
+    SocketBuffer buffers[] = {{prefix, sizeof(prefix)}, {data.data(), data.size()}};
+    error = WriteData(socket, buffers, deadline);
+  } else {
+    // Larger payloads are split into frames that point into data
+    auto numFrames = (data.size() + UINT16_MAX - 1) / UINT16_MAX;
+    std::vector<uint8_t> prefixes(numFrames * PACKET_PREFIX_SIZE);
+    std::vector<SocketBuffer> buffers{};
+    buffers.reserve(numFrames * 2);
+    for(size_t i = 0; i < numFrames; i++) {
+      auto offset = i * UINT16_MAX;
+      auto length = std::min<size_t>(UINT16_MAX, data.size() - offset);
+      auto framePrefix = prefixes.data() + i * PACKET_PREFIX_SIZE;
+      WriteFramePrefix(framePrefix, i + 1 < numFrames ? packetId | PACKET_FLAG_CONTINUED : packetId, static_cast<uint16_t>(length));
+      buffers.push_back({framePrefix, PACKET_PREFIX_SIZE});
+      buffers.push_back({data.data() + offset, length});
+    }
+    error = WriteData(socket, buffers, deadline);
+  }
   if(error != PacketError::NONE) {
-    spdlog::error("Writing packet data failed. (Len={})", packetSize);
+    spdlog::error("Writing packet failed. (ID={0:X}, Len={1})", packetId, data.size());
     return error;
   }
   spdlog::debug("Done writing packet.");
   return PacketError::NONE;
 }
 
-std::pair<PacketError, std::vector<uint8_t>> BaseConnection::ReadData(SOCKET socket, uint32_t size) {
-  uint32_t bytesRead = 0;
-  std::vector<uint8_t> buffer{};
-  buffer.resize(size);
-  while(bytesRead < size) {
-    int result = (int)read(socket, buffer.data() + bytesRead, size - bytesRead);
-    if(result <= 0) {
-      auto error = GetPacketError(result, SOCKET_LAST_ERROR);
-      if(error != PacketError::NONE)
-        return {error, {}};
-    } else {
-      bytesRead += result;
-    }
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+PacketError BaseConnection::FillBuffer(SOCKET socket, PacketReadBuffer &buffer, size_t minSize, Deadline deadline) {
+  while(buffer.end - buffer.start < minSize) {
+    size_t bytesRead{};
+    auto error = ReceiveData(socket, buffer, minSize, bytesRead);
+    if(error == PacketError::NONE && bytesRead == 0)
+      error = WaitForSocket(socket, false, deadline);
+    if(error != PacketError::NONE)
+      return error;
   }
-  return {PacketError::NONE, buffer};
+  return PacketError::NONE;
 }
 
-PacketError BaseConnection::WriteData(SOCKET socket, const char *data, uint32_t size) {
-  uint32_t bytesWritten = 0;
-  while(bytesWritten < size) {
-    int result = (int)write(socket, data + bytesWritten, size - bytesWritten);
-    if(result <= 0) {
-      auto error = GetPacketError(result, SOCKET_LAST_ERROR);
-      if(error != PacketError::NONE)
-        return error;
-    } else {
-      bytesWritten += result;
+PacketError BaseConnection::ReceiveData(SOCKET socket, PacketReadBuffer &buffer, size_t minSize, size_t &bytesRead) {
+  bytesRead = 0;
+  if(buffer.start > 0) {
+    std::memmove(buffer.data.data(), buffer.data.data() + buffer.start, buffer.end - buffer.start);
+    buffer.end -= buffer.start;
+    buffer.start = 0;
+  }
+  if(buffer.data.size() < std::max(minSize, PACKET_READ_BUFFER_SIZE))
+    buffer.data.resize(std::max(minSize, PACKET_READ_BUFFER_SIZE));
+
+  int result = (int)read(socket, buffer.data.data() + buffer.end, buffer.data.size() - buffer.end);
+  if(result > 0) {
+    buffer.end += result;
+    bytesRead = static_cast<size_t>(result);
+    return PacketError::NONE;
+  }
+  return GetPacketError(result, SOCKET_LAST_ERROR);
+}
+
+PacketError BaseConnection::WriteData(SOCKET socket, std::span<SocketBuffer> buffers, Deadline deadline) {
+  size_t index = 0;
+  while(index < buffers.size()) {
+    if(buffers[index].size == 0) {
+      index++;
+      continue;
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // Gather all remaining buffers into a single write
+    auto count = std::min(buffers.size() - index, MAX_WRITE_BUFFERS);
+#ifdef WINDOWS
+    WSABUF ioBuffers[MAX_WRITE_BUFFERS]{};
+    for(size_t i = 0; i < count; i++) {
+      ioBuffers[i].buf = reinterpret_cast<CHAR *>(const_cast<uint8_t *>(buffers[index + i].data));
+      ioBuffers[i].len = static_cast<ULONG>(buffers[index + i].size);
+    }
+    DWORD bytesSent{};
+    int result = WSASend(socket, ioBuffers, static_cast<DWORD>(count), &bytesSent, 0, nullptr, nullptr) == 0 ? (int)bytesSent : -1;
+#else
+    struct iovec ioBuffers[MAX_WRITE_BUFFERS]{};
+    for(size_t i = 0; i < count; i++) {
+      ioBuffers[i].iov_base = const_cast<uint8_t *>(buffers[index + i].data);
+      ioBuffers[i].iov_len = buffers[index + i].size;
+    }
+    // Closed sockets fail with EPIPE instead of raising SIGPIPE, which would kill the process using the PAM module
+    struct msghdr message{};
+    message.msg_iov = ioBuffers;
+    message.msg_iovlen = count;
+#ifdef MSG_NOSIGNAL
+    int result = (int)sendmsg(socket, &message, MSG_NOSIGNAL);
+#else
+    int result = (int)sendmsg(socket, &message, 0);
+#endif
+#endif
+    if(result > 0) {
+      // Skip what was written, a partial write may end in the middle of any buffer
+      auto bytesWritten = static_cast<size_t>(result);
+      while(bytesWritten > 0 && index < buffers.size()) {
+        auto consumed = std::min(bytesWritten, buffers[index].size);
+        buffers[index].data += consumed;
+        buffers[index].size -= consumed;
+        bytesWritten -= consumed;
+        if(buffers[index].size == 0)
+          index++;
+      }
+      continue;
+    }
+    auto error = GetPacketError(result, SOCKET_LAST_ERROR);
+    if(error == PacketError::NONE)
+      error = WaitForSocket(socket, true, deadline);
+    if(error != PacketError::NONE)
+      return error;
   }
   return PacketError::NONE;
 }
 
+PacketError BaseConnection::WaitForSocket(SOCKET socket, bool forWrite, Deadline deadline) {
+  while(true) {
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    if(remaining <= 0)
+      return PacketError::TIMEOUT;
+
+    struct pollfd pollFd{};
+    pollFd.fd = socket;
+    pollFd.events = forWrite ? POLLOUT : POLLIN;
+    int result = SOCKET_POLL(&pollFd, 1, (int)std::min<int64_t>(remaining, INT32_MAX));
+    if(result > 0)
+      return PacketError::NONE; // Errors and hangups are reported by the following read/write
+    if(result < 0) {
+      auto error = SOCKET_LAST_ERROR;
+      if(error == SOCKET_ERROR_INTERRUPTED)
+        continue;
+      spdlog::error("poll() failed. (Code={})", error);
+      return PacketError::UNKNOWN;
+    }
+  }
+}
+
 PacketError BaseConnection::GetPacketError(int result, int error) {
   if(result == 0)
     return PacketError::CLOSED_CONNECTION;
@@ -1,7 +1,10 @@
 #ifndef PCBU_DESKTOP_BASECONNECTION_H
 #define PCBU_DESKTOP_BASECONNECTION_H
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #ifdef WINDOWS
@@ -18,23 +21,46 @@ struct Packet {
   std::vector<uint8_t> data{};
 };
 
+struct PacketReadBuffer { // Per-socket receive buffer, reused across packets
+  std::vector<uint8_t> data{};
+  size_t start{};
+  size_t end{};
+
+  uint16_t chunkId{};
+  std::vector<uint8_t> chunkData{}; // Frames received so far of a packet split into several frames
+};
+
 class BaseConnection {
 public:
   virtual ~BaseConnection() = default;
   virtual bool IsServer();
 
+  static bool SetSocketBlocking(SOCKET socket, bool isBlocking);
+
 protected:
   BaseConnection() = default;
 
-  static bool SetSocketBlocking(SOCKET socket, bool isBlocking);
   static bool SetSocketRWTimeout(SOCKET socket, uint32_t secs);
 
-  static Packet ReadPacket(SOCKET socket);
-  static PacketError WritePacket(SOCKET socket, uint16_t packetId, const std::vector<uint8_t> &data);
+  static Packet ReadPacket(SOCKET socket, std::chrono::milliseconds timeout);
+  static Packet ReadPacket(SOCKET socket, PacketReadBuffer &buffer, std::chrono::milliseconds timeout);
+  static PacketError WritePacket(SOCKET socket, uint16_t packetId, std::span<const uint8_t> data, std::chrono::milliseconds timeout);
+
+  // Non-blocking building blocks for event loops. ParsePacket returns false and sets minSize to the
+  // number of buffered bytes it needs if no complete packet is buffered yet.
+  static bool ParsePacket(PacketReadBuffer &buffer, Packet &packet, size_t &minSize);
+  static PacketError ReceiveData(SOCKET socket, PacketReadBuffer &buffer, size_t minSize, size_t &bytesRead);
 
 private:
-  static std::pair<PacketError, std::vector<uint8_t>> ReadData(SOCKET socket, uint32_t size);
-  static PacketError WriteData(SOCKET socket, const char *data, uint32_t size);
+  using Deadline = std::chrono::steady_clock::time_point;
+  struct SocketBuffer {
+    const uint8_t *data;
+    size_t size;
+  };
+
+  static PacketError FillBuffer(SOCKET socket, PacketReadBuffer &buffer, size_t minSize, Deadline deadline);
+  static PacketError WriteData(SOCKET socket, std::span<SocketBuffer> buffers, Deadline deadline);
+  static PacketError WaitForSocket(SOCKET socket, bool forWrite, Deadline deadline);
 
   static PacketError GetPacketError(int result, int error);
 };
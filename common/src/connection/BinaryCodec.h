@@ -0,0 +1,102 @@
+#ifndef PCBU_DESKTOP_BINARYCODEC_H
+#define PCBU_DESKTOP_BINARYCODEC_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Binary packet encoding: big-endian integers, byte strings with a 16-bit length prefix.
+// Every packet starts with BINARY_CODEC_VERSION.
+constexpr uint8_t BINARY_CODEC_VERSION = 1;
+
+class BinaryWriter {
+public:
+  explicit BinaryWriter(size_t capacity = 0) {
+    m_Data.reserve(capacity + 1);
+    WriteUInt8(BINARY_CODEC_VERSION);
+  }
+
+  void WriteUInt8(uint8_t value) {
+    m_Data.push_back(value);
+  }
+  void WriteUInt16(uint16_t value) {
+    m_Data.push_back(static_cast<uint8_t>(value >> 8));
+    m_Data.push_back(static_cast<uint8_t>(value));
+  }
+  void WriteBytes(std::span<const uint8_t> bytes) {
+    if(bytes.size() > UINT16_MAX) {
+      m_HasError = true;
+      return;
+    }
+    WriteUInt16(static_cast<uint16_t>(bytes.size()));
+    m_Data.insert(m_Data.end(), bytes.begin(), bytes.end());
+  }
+  void WriteString(const std::string &str) {
+    WriteBytes({reinterpret_cast<const uint8_t *>(str.data()), str.size()});
+  }
+
+  // Empty if a field did not fit
+  [[nodiscard]] std::vector<uint8_t> Finish() {
+    if(m_HasError)
+      return {};
+    return std::move(m_Data);
+  }
+
+private:
+  std::vector<uint8_t> m_Data{};
+  bool m_HasError{};
+};
+
+class BinaryReader {
+public:
+  explicit BinaryReader(std::span<const uint8_t> data) : m_Data(data) {
+    if(ReadUInt8() != BINARY_CODEC_VERSION)
+      m_HasError = true;
+  }
+
+  uint8_t ReadUInt8() {
+    if(!CanRead(1))
+      return 0;
+    return m_Data[m_Offset++];
+  }
+  uint16_t ReadUInt16() {
+    if(!CanRead(2))
+      return 0;
+    auto value = static_cast<uint16_t>((m_Data[m_Offset] << 8) | m_Data[m_Offset + 1]);
+    m_Offset += 2;
+    return value;
+  }
+  std::span<const uint8_t> ReadBytes() {
+    auto size = ReadUInt16();
+    if(!CanRead(size))
+      return {};
+    auto bytes = m_Data.subspan(m_Offset, size);
+    m_Offset += size;
+    return bytes;
+  }
+  std::string ReadString() {
+    auto bytes = ReadBytes();
+    return {bytes.begin(), bytes.end()};
+  }
+
+  // True if every read succeeded and all data was consumed
+  [[nodiscard]] bool IsValid() const {
+    return !m_HasError && m_Offset == m_Data.size();
+  }
+
+private:
+  bool CanRead(size_t size) {
+    if(m_HasError || m_Data.size() - m_Offset < size) {
+      m_HasError = true;
+      return false;
+    }
+    return true;
+  }
+
+  std::span<const uint8_t> m_Data;
+  size_t m_Offset{};
+  bool m_HasError{};
+};
+
+#endif // PCBU_DESKTOP_BINARYCODEC_H
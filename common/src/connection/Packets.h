@@ -2,14 +2,19 @@
 #define PCBU_DESKTOP_PACKETS_H
 
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "connection/BinaryCodec.h"
 #include "storage/PairingMethod.h"
+#include "utils/StringUtils.h"
 
 constexpr uint64_t PACKET_HEADER = 0xDB065AC7AFDFA4CC;
+constexpr uint16_t PACKET_FLAG_CONTINUED = 0x8000;        // Set on every frame of a packet except the last
+constexpr size_t PACKET_MAX_DATA_SIZE = 16 * 1024 * 1024; // Limit for packets split into several frames
 
 constexpr uint16_t PACKET_ID_PAIR_INIT = 0x50;
 constexpr uint16_t PACKET_ID_PAIR_RESPONSE = 0x51;
@@ -17,6 +22,15 @@ constexpr uint16_t PACKET_ID_PAIR_RESPONSE = 0x51;
 constexpr uint16_t PACKET_ID_DEVICE_ID = 0xB0;
 constexpr uint16_t PACKET_ID_UNLOCK_REQUEST = 0xB1;
 constexpr uint16_t PACKET_ID_UNLOCK_RESPONSE = 0xB2;
+// Keep-alive links (UNLOCK_PROTO_VERSION_KEEP_ALIVE). A connection that starts with a heartbeat stays open after
+// an unlock response. Data is an AES packet of a direction byte and a random token the phone sends back.
+constexpr uint16_t PACKET_ID_HEARTBEAT = 0xB3;
+constexpr uint8_t PACKET_HEARTBEAT_REQUEST = 0x00;
+constexpr uint8_t PACKET_HEARTBEAT_RESPONSE = 0x01;
+
+constexpr uint16_t PACKET_ID_AUTH_REQUEST = 0xC0;
+constexpr uint16_t PACKET_ID_AUTH_MESSAGE = 0xC1;
+constexpr uint16_t PACKET_ID_AUTH_RESULT = 0xC2;
 
 struct PacketPairInit { // From phone
   std::string protoVersion{};
@@ -27,6 +41,7 @@ struct PacketPairInit { // From phone
   uint16_t udpPort{};
   uint16_t udpManualPort{};
   std::string cloudToken{};
+  std::string unlockProtoVersion{};
 
   static std::optional<PacketPairInit> FromJson(const std::string &jsonStr) {
     try {
@@ -41,6 +56,7 @@ struct PacketPairInit { // From phone
         packet.udpPort = json["udpPort"];
         packet.udpManualPort = json["udpManualPort"];
         packet.cloudToken = json["cloudToken"];
+        packet.unlockProtoVersion = json.value("unlockProtoVersion", "");
       } catch(...) {
       }
       return packet;
@@ -59,6 +75,7 @@ struct PacketPairResponseData { // From PC
   std::vector<std::string> macAddresses{};
   std::string userName{};
   std::string passwordKey{};
+  std::string unlockProtoVersion{};
 
   nlohmann::json ToJson() {
     return {{"pairingMethod", PairingMethodUtils::ToString(pairingMethod)},
@@ -68,7 +85,8 @@ struct PacketPairResponseData { // From PC
             {"unlockServerPort", unlockServerPort},
             {"macAddresses", macAddresses},
             {"userName", userName},
-            {"passwordKey", passwordKey}};
+            {"passwordKey", passwordKey},
+            {"unlockProtoVersion", unlockProtoVersion}};
   }
 };
 
@@ -84,10 +102,43 @@ struct PacketPairResponse { // From PC
 struct PacketUnlockRequest {
   std::string protoVersion;
   std::string deviceId;
-  std::string encData;
+  std::vector<uint8_t> encData;
 
   nlohmann::json ToJson() {
-    return {{"protoVersion", protoVersion}, {"deviceId", deviceId}, {"encData", encData}};
+    return {{"protoVersion", protoVersion}, {"deviceId", deviceId}, {"encData", StringUtils::ToHexString(encData)}};
+  }
+
+  std::vector<uint8_t> ToBinary() {
+    auto writer = BinaryWriter(protoVersion.size() + deviceId.size() + encData.size() + 6);
+    writer.WriteString(protoVersion);
+    writer.WriteString(deviceId);
+    writer.WriteBytes(encData);
+    return writer.Finish();
+  }
+
+  static std::optional<PacketUnlockRequest> FromJson(const std::string &jsonStr) {
+    try {
+      auto json = nlohmann::json::parse(jsonStr);
+      auto packet = PacketUnlockRequest();
+      packet.protoVersion = json["protoVersion"];
+      packet.deviceId = json["deviceId"];
+      packet.encData = StringUtils::FromHexString(json["encData"]);
+      return packet;
+    } catch(...) {
+    }
+    return {};
+  }
+
+  static std::optional<PacketUnlockRequest> FromBinary(std::span<const uint8_t> data) {
+    auto reader = BinaryReader(data);
+    auto packet = PacketUnlockRequest();
+    packet.protoVersion = reader.ReadString();
+    packet.deviceId = reader.ReadString();
+    auto encData = reader.ReadBytes();
+    packet.encData = {encData.begin(), encData.end()};
+    if(!reader.IsValid())
+      return {};
+    return packet;
   }
 };
 
@@ -99,29 +150,94 @@ struct PacketUnlockRequestData {
   nlohmann::json ToJson() {
     return {{"user", user}, {"program", program}, {"unlockToken", unlockToken}};
   }
+
+  std::vector<uint8_t> ToBinary() {
+    auto writer = BinaryWriter(user.size() + program.size() + unlockToken.size() + 6);
+    writer.WriteString(user);
+    writer.WriteString(program);
+    writer.WriteString(unlockToken);
+    return writer.Finish();
+  }
+
+  static std::optional<PacketUnlockRequestData> FromJson(const std::string &jsonStr) {
+    try {
+      auto json = nlohmann::json::parse(jsonStr);
+      auto packet = PacketUnlockRequestData();
+      packet.user = json["user"];
+      packet.program = json["program"];
+      packet.unlockToken = json["unlockToken"];
+      return packet;
+    } catch(...) {
+    }
+    return {};
+  }
+
+  static std::optional<PacketUnlockRequestData> FromBinary(std::span<const uint8_t> data) {
+    auto reader = BinaryReader(data);
+    auto packet = PacketUnlockRequestData();
+    packet.user = reader.ReadString();
+    packet.program = reader.ReadString();
+    packet.unlockToken = reader.ReadString();
+    if(!reader.IsValid())
+      return {};
+    return packet;
+  }
 };
 
 struct PacketUnlockResponse {
   std::string error;
-  std::string encData;
+  std::vector<uint8_t> encData;
+
+  nlohmann::json ToJson() {
+    return {{"error", error}, {"encData", StringUtils::ToHexString(encData)}};
+  }
+
+  std::vector<uint8_t> ToBinary() {
+    auto writer = BinaryWriter(error.size() + encData.size() + 4);
+    writer.WriteString(error);
+    writer.WriteBytes(encData);
+    return writer.Finish();
+  }
 
   static std::optional<PacketUnlockResponse> FromJson(const std::string &jsonStr) {
     try {
       auto json = nlohmann::json::parse(jsonStr);
       auto packet = PacketUnlockResponse();
       packet.error = json["error"];
-      packet.encData = json["encData"];
+      packet.encData = StringUtils::FromHexString(json["encData"]);
       return packet;
     } catch(...) {
     }
     return {};
   }
+
+  static std::optional<PacketUnlockResponse> FromBinary(std::span<const uint8_t> data) {
+    auto reader = BinaryReader(data);
+    auto packet = PacketUnlockResponse();
+    packet.error = reader.ReadString();
+    auto encData = reader.ReadBytes();
+    packet.encData = {encData.begin(), encData.end()};
+    if(!reader.IsValid())
+      return {};
+    return packet;
+  }
 };
 
 struct PacketUnlockResponseData {
   std::string unlockToken;
   std::string passwordKey;
 
+  nlohmann::json ToJson() {
+    return {{"unlockToken", unlockToken}, {"passwordKey", passwordKey}};
+  }
+
+  std::vector<uint8_t> ToBinary() {
+    auto writer = BinaryWriter(unlockToken.size() + passwordKey.size() + 4);
+    writer.WriteString(unlockToken);
+    writer.WriteString(passwordKey);
+    return writer.Finish();
+  }
+
   static std::optional<PacketUnlockResponseData> FromJson(const std::string &jsonStr) {
     try {
       auto json = nlohmann::json::parse(jsonStr);
@@ -133,6 +249,16 @@ struct PacketUnlockResponseData {
     }
     return {};
   }
+
+  static std::optional<PacketUnlockResponseData> FromBinary(std::span<const uint8_t> data) {
+    auto reader = BinaryReader(data);
+    auto packet = PacketUnlockResponseData();
+    packet.unlockToken = reader.ReadString();
+    packet.passwordKey = reader.ReadString();
+    if(!reader.IsValid())
+      return {};
+    return packet;
+  }
 };
 
 struct PacketUDPBroadcast {
@@ -144,6 +270,81 @@ struct PacketUDPBroadcast {
   nlohmann::json ToJson() {
     return {{"deviceId", deviceId}, {"pcbuIP", pcbuIP}, {"pcbuPort", pcbuPort}, {"isManual", isManual}};
   }
+
+  std::vector<uint8_t> ToBinary() {
+    auto writer = BinaryWriter(deviceId.size() + pcbuIP.size() + 7);
+    writer.WriteString(deviceId);
+    writer.WriteString(pcbuIP);
+    writer.WriteUInt16(pcbuPort);
+    writer.WriteUInt8(isManual ? 1 : 0);
+    return writer.Finish();
+  }
+
+  static std::optional<PacketUDPBroadcast> FromJson(const std::string &jsonStr) {
+    try {
+      auto json = nlohmann::json::parse(jsonStr);
+      auto packet = PacketUDPBroadcast();
+      packet.deviceId = json["deviceId"];
+      packet.pcbuIP = json["pcbuIP"];
+      packet.pcbuPort = json["pcbuPort"];
+      packet.isManual = json["isManual"];
+      return packet;
+    } catch(...) {
+    }
+    return {};
+  }
+
+  static std::optional<PacketUDPBroadcast> FromBinary(std::span<const uint8_t> data) {
+    auto reader = BinaryReader(data);
+    auto packet = PacketUDPBroadcast();
+    packet.deviceId = reader.ReadString();
+    packet.pcbuIP = reader.ReadString();
+    packet.pcbuPort = reader.ReadUInt16();
+    packet.isManual = reader.ReadUInt8() != 0;
+    if(!reader.IsValid())
+      return {};
+    return packet;
+  }
+};
+
+struct PacketAuthRequest { // From PAM module to pcbu_authd
+  std::string userName{};
+
+  nlohmann::json ToJson() {
+    return {{"userName", userName}};
+  }
+
+  static std::optional<PacketAuthRequest> FromJson(const std::string &jsonStr) {
+    try {
+      auto json = nlohmann::json::parse(jsonStr);
+      auto packet = PacketAuthRequest();
+      packet.userName = json["userName"];
+      return packet;
+    } catch(...) {
+    }
+    return {};
+  }
+};
+
+struct PacketAuthResult { // From pcbu_authd to PAM module
+  int exitCode{}; // Same meaning as the exit code of pcbu_auth
+  std::string password{};
+
+  nlohmann::json ToJson() {
+    return {{"exitCode", exitCode}, {"password", password}};
+  }
+
+  static std::optional<PacketAuthResult> FromJson(const std::string &jsonStr) {
+    try {
+      auto json = nlohmann::json::parse(jsonStr);
+      auto packet = PacketAuthResult();
+      packet.exitCode = json["exitCode"];
+      packet.password = json["password"];
+      return packet;
+    } catch(...) {
+    }
+    return {};
+  }
 };
 
 struct PacketUDPPairBeacon {
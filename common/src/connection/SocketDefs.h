@@ -24,14 +24,18 @@
 #define SOCKET_ERROR_CONNECT_RESET WSAECONNRESET
 #define SOCKET_ERROR_HOST_UNREACHABLE WSAEHOSTUNREACH
 #define SOCKET_ERROR_NET_UNREACHABLE WSAENETUNREACH
+#define SOCKET_ERROR_INTERRUPTED WSAEINTR
 #define SOCKET_LAST_ERROR WSAGetLastError()
+#define SOCKET_POLL(fds, count, timeoutMs) WSAPoll(fds, count, timeoutMs)
 #define SOCKET_CLOSE(x)                                                                                                                              \
   if(x != SOCKET_INVALID) {                                                                                                                          \
+    shutdown(x, SD_BOTH);                                                                                                                            \
     closesocket(x);                                                                                                                                  \
     x = SOCKET_INVALID;                                                                                                                              \
   }
 #else
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/fcntl.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -48,9 +52,12 @@
 #define SOCKET_ERROR_CONNECT_RESET ECONNRESET
 #define SOCKET_ERROR_HOST_UNREACHABLE EHOSTUNREACH
 #define SOCKET_ERROR_NET_UNREACHABLE ENETUNREACH
+#define SOCKET_ERROR_INTERRUPTED EINTR
 #define SOCKET_LAST_ERROR errno
+#define SOCKET_POLL(fds, count, timeoutMs) poll(fds, count, timeoutMs)
 #define SOCKET_CLOSE(x)                                                                                                                              \
   if(x != SOCKET_INVALID) {                                                                                                                          \
+    shutdown(x, SHUT_RDWR);                                                                                                                          \
     close(x);                                                                                                                                        \
     x = SOCKET_INVALID;                                                                                                                              \
   }
@@ -0,0 +1,62 @@
+#include "SocketNotifier.h"
+
+#include <spdlog/spdlog.h>
+
+#ifdef WINDOWS
+#include <Ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+SocketNotifier::~SocketNotifier() {
+  Close();
+}
+
+bool SocketNotifier::Open() {
+  Close();
+  if((m_Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == SOCKET_INVALID) {
+    spdlog::error("socket() failed. (Code={})", SOCKET_LAST_ERROR);
+    return false;
+  }
+
+  struct sockaddr_in address {};
+  socklen_t addrLen = sizeof(address);
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  if(bind(m_Socket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 ||
+     getsockname(m_Socket, reinterpret_cast<struct sockaddr *>(&address), &addrLen) < 0 ||
+     connect(m_Socket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+    spdlog::error("Failed to set up notifier socket. (Code={})", SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(m_Socket);
+    return false;
+  }
+  if(!BaseConnection::SetSocketBlocking(m_Socket, false)) {
+    spdlog::error("Failed setting notifier socket to non-blocking mode. (Code={})", SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(m_Socket);
+    return false;
+  }
+  return true;
+}
+
+void SocketNotifier::Close() {
+  SOCKET_CLOSE(m_Socket);
+}
+
+void SocketNotifier::Notify() {
+  if(m_Socket == SOCKET_INVALID)
+    return;
+  // A full socket buffer means a wakeup is already pending
+  char data = 1;
+  send(m_Socket, &data, sizeof(data), 0);
+}
+
+void SocketNotifier::Drain() {
+  char data[64];
+  while(recv(m_Socket, data, sizeof(data), 0) > 0) {
+  }
+}
+
+SOCKET SocketNotifier::GetSocket() const {
+  return m_Socket;
+}
@@ -0,0 +1,27 @@
+#ifndef PCBU_DESKTOP_SOCKETNOTIFIER_H
+#define PCBU_DESKTOP_SOCKETNOTIFIER_H
+
+#include "connection/BaseConnection.h"
+#include "connection/SocketDefs.h"
+
+// Wakes up a thread blocked in poll() from another thread.
+// Uses a loopback UDP socket connected to itself, which works with WSAPoll() as well as poll().
+class SocketNotifier {
+public:
+  SocketNotifier() = default;
+  ~SocketNotifier();
+  SocketNotifier(const SocketNotifier &) = delete;
+  SocketNotifier &operator=(const SocketNotifier &) = delete;
+
+  bool Open();
+  void Close();
+
+  void Notify();
+  void Drain();
+  [[nodiscard]] SOCKET GetSocket() const;
+
+private:
+  SOCKET m_Socket = SOCKET_INVALID;
+};
+
+#endif // PCBU_DESKTOP_SOCKETNOTIFIER_H
@@ -0,0 +1,163 @@
+#include "TCPConnector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+#include "connection/SocketDefs.h"
+
+#ifdef WINDOWS
+#include <Ws2tcpip.h>
+#else
+#include <netdb.h>
+#endif
+
+struct ConnectCandidate {
+  struct sockaddr_storage address{};
+  socklen_t addressLen{};
+  std::string name{};
+};
+
+struct ConnectAttempt {
+  SOCKET socket{};
+  size_t candidate{};
+};
+
+static std::vector<ConnectCandidate> ResolveCandidates(const std::vector<std::string> &addresses, uint16_t port) {
+  std::vector<ConnectCandidate> candidates{};
+  auto portStr = std::to_string(port);
+  for(const auto &address : addresses) {
+    if(address.empty())
+      continue;
+    struct addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_NUMERICSERV;
+    struct addrinfo *result{};
+    if(auto error = getaddrinfo(address.c_str(), portStr.c_str(), &hints, &result); error != 0) {
+      spdlog::warn("getaddrinfo() failed. (Address={}, Code={})", address, error);
+      continue;
+    }
+    for(auto info = result; info != nullptr; info = info->ai_next) {
+      if(info->ai_addrlen > sizeof(sockaddr_storage))
+        continue;
+      ConnectCandidate candidate{};
+      memcpy(&candidate.address, info->ai_addr, info->ai_addrlen);
+      candidate.addressLen = static_cast<socklen_t>(info->ai_addrlen);
+      candidate.name = address;
+      auto isDuplicate = std::any_of(candidates.begin(), candidates.end(), [&](const ConnectCandidate &other) {
+        return other.addressLen == candidate.addressLen && memcmp(&other.address, &candidate.address, candidate.addressLen) == 0;
+      });
+      if(!isDuplicate)
+        candidates.push_back(candidate);
+    }
+    freeaddrinfo(result);
+  }
+  return candidates;
+}
+
+// Returns SOCKET_INVALID if the attempt failed right away
+static SOCKET StartAttempt(const ConnectCandidate &candidate) {
+  SOCKET clientSocket = socket(candidate.address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+  if(clientSocket == SOCKET_INVALID) {
+    spdlog::error("socket() failed. (Code={})", SOCKET_LAST_ERROR);
+    return SOCKET_INVALID;
+  }
+  if(!BaseConnection::SetSocketBlocking(clientSocket, false)) {
+    spdlog::error("Failed setting socket to non-blocking mode. (Code={})", SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
+  }
+  if(connect(clientSocket, reinterpret_cast<const struct sockaddr *>(&candidate.address), candidate.addressLen) < 0) {
+    auto error = SOCKET_LAST_ERROR;
+    if(error != SOCKET_ERROR_IN_PROGRESS && error != SOCKET_ERROR_WOULD_BLOCK) {
+      spdlog::warn("connect() failed. (Address={}, Code={})", candidate.name, error);
+      SOCKET_CLOSE(clientSocket);
+      return SOCKET_INVALID;
+    }
+  }
+  return clientSocket;
+}
+
+SOCKET TCPConnector::Connect(const std::vector<std::string> &addresses, uint16_t port, std::chrono::milliseconds timeout,
+                             const SocketNotifier *stopNotifier) {
+  auto candidates = ResolveCandidates(addresses, port);
+  if(candidates.empty()) {
+    spdlog::error("No address to connect to.");
+    return SOCKET_INVALID;
+  }
+
+  auto startTime = std::chrono::steady_clock::now();
+  auto deadline = startTime + timeout;
+  auto nextAttemptTime = startTime;
+  size_t nextCandidate = 0;
+  std::vector<ConnectAttempt> attempts{};
+  SOCKET connectedSocket = SOCKET_INVALID;
+  while(connectedSocket == SOCKET_INVALID) {
+    auto now = std::chrono::steady_clock::now();
+    if(now >= deadline) {
+      spdlog::warn("Connecting timed out. (Candidates={})", candidates.size());
+      break;
+    }
+    if(nextCandidate < candidates.size() && now >= nextAttemptTime) {
+      auto attemptSocket = StartAttempt(candidates[nextCandidate]);
+      if(attemptSocket != SOCKET_INVALID)
+        attempts.push_back({attemptSocket, nextCandidate});
+      nextCandidate++;
+      // A failed attempt does not hold up the next one
+      nextAttemptTime = attemptSocket != SOCKET_INVALID ? now + STAGGER_DELAY : now;
+      continue;
+    }
+    if(attempts.empty()) {
+      if(nextCandidate < candidates.size())
+        continue;
+      spdlog::warn("All connection attempts failed. (Candidates={})", candidates.size());
+      break;
+    }
+
+    std::vector<struct pollfd> pollFds{};
+    pollFds.reserve(attempts.size() + 1);
+    for(const auto &attempt : attempts)
+      pollFds.push_back({attempt.socket, POLLOUT, 0});
+    if(stopNotifier != nullptr && stopNotifier->GetSocket() != SOCKET_INVALID)
+      pollFds.push_back({stopNotifier->GetSocket(), POLLIN, 0});
+    auto waitUntil = nextCandidate < candidates.size() ? std::min(deadline, nextAttemptTime) : deadline;
+    auto waitMs = std::chrono::ceil<std::chrono::milliseconds>(waitUntil - now).count();
+    auto pollResult = SOCKET_POLL(pollFds.data(), static_cast<int>(pollFds.size()), static_cast<int>(std::max<int64_t>(waitMs, 0)));
+    if(pollResult < 0) {
+      auto error = SOCKET_LAST_ERROR;
+      if(error == SOCKET_ERROR_INTERRUPTED)
+        continue;
+      spdlog::error("poll() failed. (Code={})", error);
+      break;
+    }
+    if(pollFds.size() > attempts.size() && pollFds.back().revents != 0)
+      break;
+
+    for(size_t i = attempts.size(); i-- > 0;) {
+      if(pollFds[i].revents == 0)
+        continue;
+      int error = 0;
+      socklen_t errorLen = sizeof(error);
+      if(getsockopt(attempts[i].socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &errorLen) < 0)
+        error = SOCKET_LAST_ERROR;
+      if(error == 0 && connectedSocket == SOCKET_INVALID) {
+        spdlog::info("Connected to {}. (Attempt={})", candidates[attempts[i].candidate].name, attempts[i].candidate + 1);
+        connectedSocket = attempts[i].socket;
+        attempts.erase(attempts.begin() + static_cast<ptrdiff_t>(i));
+        continue;
+      }
+      if(error != 0) {
+        spdlog::warn("Connection attempt failed. (Address={}, Code={})", candidates[attempts[i].candidate].name, error);
+        SOCKET_CLOSE(attempts[i].socket);
+        attempts.erase(attempts.begin() + static_cast<ptrdiff_t>(i));
+        nextAttemptTime = std::chrono::steady_clock::now();
+      }
+    }
+  }
+
+  for(auto &attempt : attempts)
+    SOCKET_CLOSE(attempt.socket);
+  return connectedSocket;
+}
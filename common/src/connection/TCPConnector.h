@@ -0,0 +1,27 @@
+#ifndef PCBU_DESKTOP_TCPCONNECTOR_H
+#define PCBU_DESKTOP_TCPCONNECTOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "connection/BaseConnection.h"
+#include "connection/SocketNotifier.h"
+
+// Races TCP connections to several candidate addresses. Attempts start one after another with a short delay
+// while the earlier ones are still pending, the first connected socket wins and the others are closed.
+class TCPConnector {
+public:
+  static constexpr auto STAGGER_DELAY = std::chrono::milliseconds(250);
+
+  // Addresses may be IP addresses or host names, every resolved address is a candidate.
+  // Returns a non-blocking socket, or SOCKET_INVALID on failure or once stopNotifier is notified.
+  static SOCKET Connect(const std::vector<std::string> &addresses, uint16_t port, std::chrono::milliseconds timeout,
+                        const SocketNotifier *stopNotifier = nullptr);
+
+private:
+  TCPConnector() = default;
+};
+
+#endif // PCBU_DESKTOP_TCPCONNECTOR_H
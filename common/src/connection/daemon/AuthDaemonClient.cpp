@@ -0,0 +1,89 @@
+#include "AuthDaemonClient.h"
+
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <sys/un.h>
+
+#include "connection/SocketDefs.h"
+
+// The daemon only answers once the phone did, which can take as long as the user needs.
+// Requests that would wait for another unlock are answered right away.
+constexpr auto REQUEST_TIMEOUT = std::chrono::seconds(5);
+constexpr auto RESPONSE_TIMEOUT = std::chrono::minutes(10);
+
+std::optional<PacketAuthResult> AuthDaemonClient::Authenticate(const std::string &userName,
+                                                               const std::function<void(const std::string &)> &printMessage) {
+  auto clientSocket = Connect();
+  if(clientSocket == SOCKET_INVALID)
+    return {};
+  // A busy daemon answers right away and may close the socket before reading the request
+  auto isSent = SendRequest(clientSocket, PACKET_ID_AUTH_REQUEST, userName);
+
+  // Once the request was accepted, errors are not retried with pcbu_auth
+  auto result = PacketAuthResult{-1};
+  PacketReadBuffer buffer{};
+  while(true) {
+    auto packet = ReadPacket(clientSocket, buffer, isSent ? RESPONSE_TIMEOUT : REQUEST_TIMEOUT);
+    if(packet.error != PacketError::NONE && !isSent) {
+      SOCKET_CLOSE(clientSocket);
+      return {};
+    }
+    if(packet.error != PacketError::NONE) {
+      spdlog::error("Reading from pcbu_authd failed. (PacketError={})", static_cast<int>(packet.error));
+      break;
+    }
+    auto dataStr = std::string(packet.data.begin(), packet.data.end());
+    if(packet.id == PACKET_ID_AUTH_MESSAGE) {
+      printMessage(dataStr);
+      continue;
+    }
+    if(packet.id == PACKET_ID_AUTH_RESULT) {
+      auto resultPacket = PacketAuthResult::FromJson(dataStr);
+      if(resultPacket.has_value())
+        result = resultPacket.value();
+      else
+        spdlog::error("Error parsing auth result packet.");
+      break;
+    }
+    spdlog::error("Invalid packet from pcbu_authd. (ID={0:X})", packet.id);
+    break;
+  }
+  SOCKET_CLOSE(clientSocket);
+  return result;
+}
+
+SOCKET AuthDaemonClient::Connect() {
+  SOCKET clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(clientSocket == SOCKET_INVALID) {
+    spdlog::error("socket() failed. (Code={})", SOCKET_LAST_ERROR);
+    return SOCKET_INVALID;
+  }
+  fcntl(clientSocket, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+  int noSigPipe = 1;
+  setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+  struct sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, AUTHD_SOCKET_PATH, sizeof(address.sun_path) - 1);
+  if(connect(clientSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+    spdlog::debug("pcbu_authd is not running. (Code={})", SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
+  }
+  if(!SetSocketBlocking(clientSocket, false)) {
+    spdlog::error("Failed to set socket to non-blocking mode.");
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
+  }
+  return clientSocket;
+}
+
+bool AuthDaemonClient::SendRequest(SOCKET clientSocket, uint16_t packetId, const std::string &userName) {
+  auto request = PacketAuthRequest();
+  request.userName = userName;
+  auto requestStr = request.ToJson().dump();
+  return WritePacket(clientSocket, packetId, {reinterpret_cast<const uint8_t *>(requestStr.data()), requestStr.size()}, REQUEST_TIMEOUT) ==
+         PacketError::NONE;
+}
@@ -0,0 +1,30 @@
+#ifndef PCBU_DESKTOP_AUTHDAEMONCLIENT_H
+#define PCBU_DESKTOP_AUTHDAEMONCLIENT_H
+
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "connection/BaseConnection.h"
+#include "connection/Packets.h"
+
+#ifdef APPLE
+constexpr auto AUTHD_SOCKET_PATH = "/var/run/pcbu_authd.sock";
+#else
+constexpr auto AUTHD_SOCKET_PATH = "/run/pcbu_authd.sock";
+#endif
+
+class AuthDaemonClient : public BaseConnection {
+public:
+  // Runs an unlock through pcbu_authd. Returns no value if the daemon is not running,
+  // so the caller can fall back to executing pcbu_auth.
+  static std::optional<PacketAuthResult> Authenticate(const std::string &userName, const std::function<void(const std::string &)> &printMessage);
+
+private:
+  AuthDaemonClient() = default;
+
+  static SOCKET Connect();
+  static bool SendRequest(SOCKET clientSocket, uint16_t packetId, const std::string &userName);
+};
+
+#endif // PCBU_DESKTOP_AUTHDAEMONCLIENT_H
@@ -75,7 +75,7 @@ void PairingServer::AcceptThread() {
 
   address.sin_family = AF_INET;
   address.sin_addr.s_addr = INADDR_ANY;
-  address.sin_port = htons(settings.pairingServerPort);
+  address.sin_port = htons(settings->pairingServerPort);
   if(bind(m_ServerSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
     spdlog::error("bind() failed. (Code={})", SOCKET_LAST_ERROR);
     m_ErrorCallback(I18n::Get("error_pairing_server_init"));
@@ -92,7 +92,7 @@ void PairingServer::AcceptThread() {
     goto threadEnd;
   }
 
-  spdlog::info("TCP pairing server started on port '{}'.", settings.pairingServerPort);
+  spdlog::info("TCP pairing server started on port '{}'.", settings->pairingServerPort);
   while(m_IsRunning) {
     if(m_NumConnections >= MAX_CLIENTS) {
       std::this_thread::sleep_for(std::chrono::milliseconds(50));
@@ -156,18 +156,26 @@ void PairingServer::ClientThread(SOCKET clientSocket) {
       initPacket.value().deviceUUID = StringUtils::RandomString(32);
     }
 
-    auto passwordKey = StringUtils::RandomString(64);
-    auto pwEnc = CryptUtils::EncryptAES(m_UIData.password, passwordKey);
-    if(!pwEnc.has_value())
-      throw std::runtime_error(I18n::Get("error_password_encrypt"));
-
     auto device = PairedDevice();
-    device.id = CryptUtils::Sha256(AppSettings::Get().machineID + initPacket->deviceUUID + m_UIData.userName);
+    device.id = CryptUtils::Sha256(AppSettings::Get()->machineID + initPacket->deviceUUID + m_UIData.userName);
     device.pairingMethod = m_UIData.method;
     device.deviceName = initPacket->deviceName;
     device.userName = m_UIData.userName;
-    device.passwordEnc = pwEnc.value();
     device.encryptionKey = m_UIData.encKey;
+    if(!initPacket->unlockProtoVersion.empty() && AppInfo::CompareVersion(UNLOCK_PROTO_VERSION_DERIVED_KEY, initPacket->unlockProtoVersion) >= 0) {
+      // Use the highest version both sides support
+      auto ownVersion = AppInfo::GetUnlockProtocolVersion();
+      device.unlockProtoVersion = AppInfo::CompareVersion(ownVersion, initPacket->unlockProtoVersion) >= 0 ? ownVersion : initPacket->unlockProtoVersion;
+      device.derivedKey = CryptUtils::DeriveDeviceKey(device.encryptionKey, device.id);
+      if(device.derivedKey.empty())
+        throw std::runtime_error(I18n::Get("error_password_encrypt"));
+    }
+
+    auto passwordKey = StringUtils::RandomString(64);
+    auto pwEnc = CryptUtils::EncryptAES(m_UIData.password, device.GetPasswordKey(passwordKey));
+    if(!pwEnc.has_value())
+      throw std::runtime_error(I18n::Get("error_password_encrypt"));
+    device.passwordEnc = pwEnc.value();
 
     device.ipAddress = initPacket->ipAddress;
     device.tcpPort = initPacket->tcpPort;
@@ -181,12 +189,13 @@ void PairingServer::ClientThread(SOCKET clientSocket) {
     respPacket.data.deviceId = device.id;
     respPacket.data.deviceName = NetworkHelper::GetHostName();
     respPacket.data.deviceOS = AppInfo::GetOperatingSystem();
-    respPacket.data.unlockServerPort = AppSettings::Get().unlockServerPort;
+    respPacket.data.unlockServerPort = AppSettings::Get()->unlockServerPort;
     respPacket.data.pairingMethod = device.pairingMethod;
     for(const auto &netIf : NetworkHelper::GetWakeOnLanInterfaces())
       respPacket.data.macAddresses.emplace_back(netIf.macAddress);
     respPacket.data.userName = m_UIData.userName;
     respPacket.data.passwordKey = passwordKey;
+    respPacket.data.unlockProtoVersion = device.unlockProtoVersion.empty() ? AppInfo::GetLegacyUnlockProtocolVersion() : device.unlockProtoVersion;
 
     if(WriteEncryptedPacket(clientSocket, PACKET_ID_PAIR_RESPONSE, respPacket.ToJson().dump())) {
       PairedDevicesStorage::AddDevice(device);
@@ -212,7 +221,7 @@ void PairingServer::ClientThread(SOCKET clientSocket) {
 }
 
 CryptPacket PairingServer::ReadEncryptedPacket(SOCKET clientSocket) const {
-  auto packet = ReadPacket(clientSocket);
+  auto packet = ReadPacket(clientSocket, std::chrono::seconds(AppSettings::Get()->clientSocketTimeout));
   if(packet.error != PacketError::NONE) {
     spdlog::error("Error reading pairing packet. (Code={})", static_cast<int>(packet.error));
     return {};
@@ -229,7 +238,7 @@ bool PairingServer::WriteEncryptedPacket(SOCKET clientSocket, uint8_t packetId,
     spdlog::error("Error encrypting pairing packet. (Size={}, Code={})", data.size(), static_cast<int>(encRes.result));
     return false;
   }
-  auto writeRes = WritePacket(clientSocket, packetId, {encRes.data.begin(), encRes.data.end()});
+  auto writeRes = WritePacket(clientSocket, packetId, encRes.data, std::chrono::seconds(AppSettings::Get()->clientSocketTimeout));
   if(writeRes != PacketError::NONE) {
     spdlog::error("Error writing pairing packet. (Code={})", static_cast<int>(writeRes));
     return false;
@@ -11,8 +11,8 @@ constexpr int INTERVAL_MS = 2000;
 UDPPairingBroadcaster::UDPPairingBroadcaster(std::string serverId, const std::string &encKey)
     : UDPBroadcaster("UDPPairingBroadcaster", INTERVAL_MS), m_ServerId(std::move(serverId)) {
   m_EncKey = encKey;
-  m_PairingPort = AppSettings::Get().pairingServerPort;
-  m_DiscoveryPort = AppSettings::Get().pairingDiscoveryPort;
+  m_PairingPort = AppSettings::Get()->pairingServerPort;
+  m_DiscoveryPort = AppSettings::Get()->pairingDiscoveryPort;
 }
 
 UDPPairingBroadcaster::~UDPPairingBroadcaster() {
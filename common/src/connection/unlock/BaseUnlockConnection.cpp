@@ -1,11 +1,13 @@
 #include "BaseUnlockConnection.h"
 
+#include "storage/AppSettings.h"
 #include "utils/AppInfo.h"
 #include "utils/StringUtils.h"
 
 BaseUnlockConnection::BaseUnlockConnection() {
   m_UnlockToken = StringUtils::RandomString(64);
   m_UnlockState = UnlockState::UNKNOWN;
+  m_SocketTimeout = std::chrono::seconds(AppSettings::Get()->clientSocketTimeout);
 }
 
 BaseUnlockConnection::BaseUnlockConnection(const PairedDevice &device) : BaseUnlockConnection() {
@@ -34,41 +36,80 @@ bool BaseUnlockConnection::HasClient() const {
   return m_HasConnection;
 }
 
+void BaseUnlockConnection::SetStateEvent(StateEvent *stateEvent) {
+  m_StateEvent = stateEvent;
+}
+
+void BaseUnlockConnection::SetTrace(UnlockTrace *trace) {
+  m_Trace = trace;
+}
+
 UnlockState BaseUnlockConnection::PollResult() {
   return m_UnlockState;
 }
 
+void BaseUnlockConnection::SetUnlockState(UnlockState state) {
+  m_UnlockState = state;
+  if(auto stateEvent = m_StateEvent.load())
+    stateEvent->Notify();
+}
+
+void BaseUnlockConnection::SetHasConnection(bool hasConnection) {
+  m_HasConnection = hasConnection;
+  if(hasConnection)
+    TraceMark("connected");
+  if(auto stateEvent = m_StateEvent.load())
+    stateEvent->Notify();
+}
+
+void BaseUnlockConnection::TraceMark(const char *phase) {
+  if(m_Trace != nullptr && m_Trace->IsActive())
+    m_Trace->Mark(phase, m_PairedDevice.id);
+}
+
 void BaseUnlockConnection::PerformAuthFlow(SOCKET socket, bool needsDeviceID) {
+  if(!OnConnectionOpened(socket, needsDeviceID))
+    return;
+
+  PacketReadBuffer readBuffer{};
+  auto packet = ReadPacket(socket, readBuffer, m_SocketTimeout);
+  while(packet.error == PacketError::NONE) {
+    OnPacketReceived(socket, packet);
+    packet = ReadPacket(socket, readBuffer, m_SocketTimeout);
+  }
+  OnConnectionClosed(socket, packet.error);
+}
+
+bool BaseUnlockConnection::OnConnectionOpened(SOCKET socket, bool needsDeviceID) {
   m_StateMutex.lock();
   m_ConnectionStates[socket] = needsDeviceID ? UnlockConnectionState::NONE : UnlockConnectionState::HAS_DEVICE_ID;
   m_StateMutex.unlock();
   if(!needsDeviceID) {
-    if(SendUnlockRequest(socket)) {
-      m_StateMutex.lock();
-      m_ConnectionStates[socket] = UnlockConnectionState::HAS_UNLOCK_REQUEST;
-      m_StateMutex.unlock();
-    } else {
-      return;
-    }
+    if(!SendUnlockRequest(socket))
+      return false;
+    m_StateMutex.lock();
+    m_ConnectionStates[socket] = UnlockConnectionState::HAS_UNLOCK_REQUEST;
+    m_StateMutex.unlock();
   }
+  return true;
+}
 
-  auto packet = ReadPacket(socket);
-  while(packet.error == PacketError::NONE) {
-    OnPacketReceived(socket, packet);
-    packet = ReadPacket(socket);
-  }
+void BaseUnlockConnection::OnConnectionClosed(SOCKET socket, PacketError error) {
+  m_StateMutex.lock();
+  m_ConnectionStates.erase(socket);
+  m_StateMutex.unlock();
   if(m_UnlockState == UnlockState::UNKNOWN) {
-    switch(packet.error) {
+    switch(error) {
       case PacketError::CLOSED_CONNECTION: {
-        m_UnlockState = UnlockState::CONNECT_ERROR;
+        SetUnlockState(UnlockState::CONNECT_ERROR);
         break;
       }
       case PacketError::TIMEOUT: {
-        m_UnlockState = UnlockState::TIMEOUT;
+        SetUnlockState(UnlockState::TIMEOUT);
         break;
       }
       default: {
-        m_UnlockState = UnlockState::DATA_ERROR;
+        SetUnlockState(UnlockState::DATA_ERROR);
         break;
       }
     }
@@ -91,18 +132,19 @@ void BaseUnlockConnection::OnPacketReceived(SOCKET socket, Packet &packet) {
     case PACKET_ID_DEVICE_ID: {
       auto deviceId = std::string(reinterpret_cast<const char *>(packet.data.data()), packet.data.size());
       auto device = PairedDevicesStorage::GetDeviceByID(deviceId);
-      if(!device.has_value()) {
+      if(device == nullptr) {
         spdlog::error("Invalid device ID.");
-        m_UnlockState = UnlockState::DATA_ERROR;
+        SetUnlockState(UnlockState::DATA_ERROR);
         return;
       }
-      m_PairedDevice = device.value();
+      m_PairedDevice = *device;
       if(SendUnlockRequest(socket)) {
         m_ConnectionStates[socket] = UnlockConnectionState::HAS_UNLOCK_REQUEST;
       }
       break;
     }
     case PACKET_ID_UNLOCK_RESPONSE: {
+      TraceMark("response_read");
       OnResponseReceived(packet);
       break;
     }
@@ -118,45 +160,66 @@ bool BaseUnlockConnection::SendUnlockRequest(SOCKET socket) {
   encData.user = m_AuthUser;
   encData.program = m_AuthProgram;
   encData.unlockToken = m_UnlockToken;
-  auto encDataStr = encData.ToJson().dump();
-  auto cryptResult = CryptUtils::EncryptAESPacket({encDataStr.begin(), encDataStr.end()}, m_PairedDevice.encryptionKey);
+  auto isBinary = m_PairedDevice.SupportsUnlockProtocol(UNLOCK_PROTO_VERSION_BINARY);
+  std::vector<uint8_t> encDataBytes{};
+  if(isBinary) {
+    encDataBytes = encData.ToBinary();
+  } else {
+    auto encDataStr = encData.ToJson().dump();
+    encDataBytes = {encDataStr.begin(), encDataStr.end()};
+  }
+  auto cryptResult = CryptUtils::EncryptAESPacket(encDataBytes, m_PairedDevice.GetPacketKey());
   if(cryptResult.result != PacketCryptResult::OK) {
     spdlog::error("Failed to encrypt unlock request packet.");
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     return false;
   }
+  TraceMark("request_encrypted");
   auto requestPacket = PacketUnlockRequest();
-  requestPacket.protoVersion = AppInfo::GetUnlockProtocolVersion();
+  requestPacket.protoVersion = m_PairedDevice.unlockProtoVersion.empty() ? AppInfo::GetLegacyUnlockProtocolVersion() : m_PairedDevice.unlockProtoVersion;
   requestPacket.deviceId = m_PairedDevice.id;
-  requestPacket.encData = StringUtils::ToHexString(cryptResult.data);
-  auto requestStr = requestPacket.ToJson().dump();
+  requestPacket.encData = std::move(cryptResult.data);
+  std::vector<uint8_t> requestBytes{};
+  if(isBinary) {
+    requestBytes = requestPacket.ToBinary();
+  } else {
+    auto requestStr = requestPacket.ToJson().dump();
+    requestBytes = {requestStr.begin(), requestStr.end()};
+  }
+  if(requestBytes.empty()) {
+    spdlog::error("Failed to encode unlock request packet.");
+    SetUnlockState(UnlockState::UNK_ERROR);
+    return false;
+  }
   spdlog::debug("Writing PacketUnlockRequest...");
-  auto writeResult = WritePacket(socket, PACKET_ID_UNLOCK_REQUEST, {requestStr.begin(), requestStr.end()});
+  auto writeResult = WritePacket(socket, PACKET_ID_UNLOCK_REQUEST, requestBytes, m_SocketTimeout);
   if(writeResult != PacketError::NONE) {
     switch(writeResult) {
       case PacketError::CLOSED_CONNECTION:
-        m_UnlockState = UnlockState::CONNECT_ERROR;
+        SetUnlockState(UnlockState::CONNECT_ERROR);
         break;
       case PacketError::TIMEOUT:
-        m_UnlockState = UnlockState::TIMEOUT;
+        SetUnlockState(UnlockState::TIMEOUT);
         break;
       default:
-        m_UnlockState = UnlockState::UNK_ERROR;
+        SetUnlockState(UnlockState::UNK_ERROR);
         break;
     }
     spdlog::error("Failed to write unlock request packet. (WriteResult={}, UnlockState={})", static_cast<int>(writeResult), UnlockStateUtils::ToString(m_UnlockState));
     return false;
   }
+  TraceMark("request_written");
   return true;
 }
 
 void BaseUnlockConnection::OnResponseReceived(const Packet &packet) {
   // Parse data
-  auto respStr = std::string(packet.data.begin(), packet.data.end());
-  auto responsePacket = PacketUnlockResponse::FromJson(respStr);
+  auto isBinary = m_PairedDevice.SupportsUnlockProtocol(UNLOCK_PROTO_VERSION_BINARY);
+  auto responsePacket = isBinary ? PacketUnlockResponse::FromBinary(packet.data)
+                                 : PacketUnlockResponse::FromJson(std::string(packet.data.begin(), packet.data.end()));
   if(!responsePacket.has_value()) {
     spdlog::error("Error parsing response packet.");
-    m_UnlockState = UnlockState::DATA_ERROR;
+    SetUnlockState(UnlockState::DATA_ERROR);
     return;
   }
 
@@ -165,56 +228,57 @@ void BaseUnlockConnection::OnResponseReceived(const Packet &packet) {
   if(!error.empty()) {
     spdlog::error("Error in response packet: {}", error);
     if(error == "CANCEL") {
-      m_UnlockState = UnlockState::CANCELED;
+      SetUnlockState(UnlockState::CANCELED);
     } else if(error == "NOT_PAIRED") {
-      m_UnlockState = UnlockState::NOT_PAIRED_ERROR;
+      SetUnlockState(UnlockState::NOT_PAIRED_ERROR);
     } else if(error == "APP_ERROR") {
-      m_UnlockState = UnlockState::APP_ERROR;
+      SetUnlockState(UnlockState::APP_ERROR);
     } else if(error == "TIME_ERROR") {
-      m_UnlockState = UnlockState::TIME_ERROR;
+      SetUnlockState(UnlockState::TIME_ERROR);
     } else if(error == "DATA_ERROR") {
-      m_UnlockState = UnlockState::DATA_ERROR;
+      SetUnlockState(UnlockState::DATA_ERROR);
     } else if(error == "PROTOCOL_ERROR") {
-      m_UnlockState = UnlockState::PROTOCOL_ERROR;
+      SetUnlockState(UnlockState::PROTOCOL_ERROR);
     } else {
-      m_UnlockState = UnlockState::UNK_ERROR;
+      SetUnlockState(UnlockState::UNK_ERROR);
     }
     return;
   }
 
   // Decrypt data
-  auto cryptData = StringUtils::FromHexString(responsePacket.value().encData);
-  auto cryptResult = CryptUtils::DecryptAESPacket(cryptData, m_PairedDevice.encryptionKey);
+  auto cryptResult = CryptUtils::DecryptAESPacket(responsePacket.value().encData, m_PairedDevice.GetPacketKey());
   if(cryptResult.result != PacketCryptResult::OK) {
     switch(cryptResult.result) {
       case INVALID_TIMESTAMP: {
         spdlog::error("Invalid timestamp on AES data.");
-        m_UnlockState = UnlockState::TIME_ERROR;
+        SetUnlockState(UnlockState::TIME_ERROR);
         break;
       }
       default: {
         spdlog::error("Invalid data received. (Size={})", packet.data.size());
-        m_UnlockState = UnlockState::DATA_ERROR;
+        SetUnlockState(UnlockState::DATA_ERROR);
         break;
       }
     }
     return;
   }
 
+  TraceMark("response_decrypted");
+
   // Parse encrypted data
-  auto dataStr = std::string(cryptResult.data.begin(), cryptResult.data.end());
-  auto dataPacket = PacketUnlockResponseData::FromJson(dataStr);
+  auto dataPacket = isBinary ? PacketUnlockResponseData::FromBinary(cryptResult.data)
+                             : PacketUnlockResponseData::FromJson(std::string(cryptResult.data.begin(), cryptResult.data.end()));
   if(!dataPacket.has_value()) {
     spdlog::error("Error parsing response data.");
-    m_UnlockState = UnlockState::DATA_ERROR;
+    SetUnlockState(UnlockState::DATA_ERROR);
     return;
   }
   m_ResponseData = dataPacket.value();
 
   // Token check
   if(m_ResponseData.unlockToken == m_UnlockToken) {
-    m_UnlockState = UnlockState::SUCCESS;
+    SetUnlockState(UnlockState::SUCCESS);
   } else {
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
   }
 }
@@ -10,8 +10,10 @@
 #include "../BaseConnection.h"
 #include "../Packets.h"
 #include "handler/UnlockState.h"
+#include "handler/UnlockTrace.h"
 #include "storage/PairedDevicesStorage.h"
 #include "utils/CryptUtils.h"
+#include "utils/StateEvent.h"
 #include "utils/Utils.h"
 
 enum UnlockConnectionState {
@@ -35,13 +37,24 @@ public:
   [[nodiscard]] bool HasClient() const;
 
   void SetUnlockInfo(const std::string &authUser, const std::string &authProgram);
+  // Notified whenever the result or the client state changes
+  void SetStateEvent(StateEvent *stateEvent);
+  void SetTrace(UnlockTrace *trace);
   UnlockState PollResult();
 
 protected:
   void PerformAuthFlow(SOCKET socket, bool needsDeviceID = false);
 
-private:
+  // Steps of the auth flow, for connections that are not driven by PerformAuthFlow
+  bool OnConnectionOpened(SOCKET socket, bool needsDeviceID);
   void OnPacketReceived(SOCKET socket, Packet &packet);
+  void OnConnectionClosed(SOCKET socket, PacketError error);
+
+  void SetUnlockState(UnlockState state);
+  void SetHasConnection(bool hasConnection);
+  void TraceMark(const char *phase);
+
+private:
   bool SendUnlockRequest(SOCKET socket);
   void OnResponseReceived(const Packet &packet);
 
@@ -49,11 +62,14 @@ protected:
   std::atomic<bool> m_IsRunning{};
   std::thread m_AcceptThread{};
   std::atomic<bool> m_HasConnection{};
+  std::chrono::milliseconds m_SocketTimeout{};
   std::string m_UserName{};
 
   std::atomic<UnlockState> m_UnlockState{};
   PairedDevice m_PairedDevice{};
   PacketUnlockResponseData m_ResponseData{};
+  std::atomic<StateEvent *> m_StateEvent{};
+  UnlockTrace *m_Trace{};
 
   std::map<SOCKET, UnlockConnectionState> m_ConnectionStates{};
   std::mutex m_StateMutex{};
@@ -6,15 +6,19 @@
 constexpr int INTERVAL_MS = 2000;
 
 UDPUnlockBroadcaster::UDPUnlockBroadcaster() : UDPBroadcaster("UDPUnlockBroadcaster", INTERVAL_MS) {
-  m_UnlockPort = AppSettings::Get().unlockServerPort;
+  m_UnlockPort = AppSettings::Get()->unlockServerPort;
 }
 
 UDPUnlockBroadcaster::~UDPUnlockBroadcaster() {
   Stop();
 }
 
-void UDPUnlockBroadcaster::AddDevice(const std::string &deviceID, uint16_t devicePort, bool isManual) {
-  m_Devices.emplace_back(deviceID, devicePort, isManual);
+void UDPUnlockBroadcaster::AddDevice(const std::string &deviceID, uint16_t devicePort, bool isManual, bool isBinary) {
+  m_Devices.emplace_back(deviceID, devicePort, isManual, isBinary);
+}
+
+void UDPUnlockBroadcaster::SetTrace(UnlockTrace *trace) {
+  m_Trace = trace;
 }
 
 void UDPUnlockBroadcaster::SendToTarget(const BroadcastTarget &target) {
@@ -24,7 +28,13 @@ void UDPUnlockBroadcaster::SendToTarget(const BroadcastTarget &target) {
     packet.pcbuIP = target.sourceIP;
     packet.pcbuPort = m_UnlockPort;
     packet.isManual = device.isManual;
-    auto payload = packet.ToJson().dump();
-    SendBroadcast(target, {payload.begin(), payload.end()}, device.devicePort);
+    if(device.isBinary) {
+      SendBroadcast(target, packet.ToBinary(), device.devicePort);
+    } else {
+      auto payload = packet.ToJson().dump();
+      SendBroadcast(target, {payload.begin(), payload.end()}, device.devicePort);
+    }
+    if(m_Trace != nullptr)
+      m_Trace->Mark("udp_broadcast_sent", device.deviceID);
   }
 }
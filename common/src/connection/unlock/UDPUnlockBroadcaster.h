@@ -6,11 +6,13 @@
 #include <vector>
 
 #include "connection/UDPBroadcaster.h"
+#include "handler/UnlockTrace.h"
 
 struct UDPBroadcastDevice {
   std::string deviceID;
   uint16_t devicePort;
   bool isManual;
+  bool isBinary;
 };
 
 class UDPUnlockBroadcaster : public UDPBroadcaster {
@@ -18,7 +20,8 @@ public:
   UDPUnlockBroadcaster();
   ~UDPUnlockBroadcaster() override;
 
-  void AddDevice(const std::string &deviceID, uint16_t devicePort, bool isManual);
+  void AddDevice(const std::string &deviceID, uint16_t devicePort, bool isManual, bool isBinary);
+  void SetTrace(UnlockTrace *trace);
 
 protected:
   void SendToTarget(const BroadcastTarget &target) override;
@@ -26,6 +29,7 @@ protected:
 private:
   uint16_t m_UnlockPort;
   std::vector<UDPBroadcastDevice> m_Devices{};
+  UnlockTrace *m_Trace{};
 };
 
 #endif // PCBU_DESKTOP_UDPUNLOCKBROADCASTER_H
@@ -82,6 +82,6 @@ void BTUnlockClient::Stop() {
     return;
 
   m_IsRunning = false;
-  m_HasConnection = false;
+  SetHasConnection(false);
   [(BTUnlockClientWrapper *)m_Wrapper stop];
 }
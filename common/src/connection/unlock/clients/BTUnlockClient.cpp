@@ -3,6 +3,7 @@
 #include "connection/SocketDefs.h"
 #include "platform/BluetoothHelper.h"
 #include "storage/AppSettings.h"
+#include "storage/BTChannelCache.h"
 
 #ifdef WINDOWS
 #include <Ws2tcpip.h>
@@ -27,6 +28,8 @@ bool BTUnlockClient::Start() {
     return true;
 
   WSA_STARTUP
+  if(!m_StopNotifier.Open())
+    return false;
   m_IsRunning = true;
   m_AcceptThread = std::thread(&BTUnlockClient::ConnectThread, this);
   return true;
@@ -40,14 +43,15 @@ void BTUnlockClient::Stop() {
     write(m_ClientSocket, "CLOSE", 5);
 
   m_IsRunning = false;
-  m_HasConnection = false;
+  m_StopNotifier.Notify();
+  SetHasConnection(false);
   SOCKET_CLOSE(m_ClientSocket);
   if(m_AcceptThread.joinable())
     m_AcceptThread.join();
+  m_StopNotifier.Close();
 }
 
 void BTUnlockClient::ConnectThread() {
-  uint32_t numRetries{};
   auto settings = AppSettings::Get();
   spdlog::info("Connecting via BT...");
 
@@ -64,11 +68,17 @@ void BTUnlockClient::ConnectThread() {
   // 62182bf7-97c8-45f9-aa2c-53c5f2008bdf
   static uint8_t CHANNEL_UUID[16] = {0x62, 0x18, 0x2b, 0xf7, 0x97, 0xc8, 0x45, 0xf9, 0xaa, 0x2c, 0x53, 0xc5, 0xf2, 0x00, 0x8b, 0xdf};
 
-  m_Channel = BluetoothHelper::FindSDPChannel(m_DeviceAddress, CHANNEL_UUID);
-  if(m_Channel == -1) {
-    m_IsRunning = false;
-    m_UnlockState = UnlockState::CONNECT_ERROR;
-    return;
+  // The SDP search takes one to several seconds, so the channel of the last unlock is tried first
+  m_Channel = BTChannelCache::Get(m_DeviceAddress);
+  auto isCachedChannel = m_Channel != -1;
+  if(!isCachedChannel) {
+    m_Channel = BluetoothHelper::FindSDPChannel(m_DeviceAddress, CHANNEL_UUID);
+    if(m_Channel == -1) {
+      m_IsRunning = false;
+      SetUnlockState(UnlockState::CONNECT_ERROR);
+      return;
+    }
+    BTChannelCache::Set(m_DeviceAddress, m_Channel);
   }
 
   struct sockaddr_rc address = {0};
@@ -77,71 +87,101 @@ void BTUnlockClient::ConnectThread() {
   str2ba(m_DeviceAddress.c_str(), &address.rc_bdaddr);
 #endif
 
-socketStart:
-  if((m_ClientSocket = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM)) == SOCKET_INVALID) {
-    spdlog::error("socket(AF_BLUETOOTH) failed. (Code={})", SOCKET_LAST_ERROR);
-    m_IsRunning = false;
-    m_UnlockState = UnlockState::UNK_ERROR;
-    return;
+  auto connectTimeout = std::chrono::seconds(settings->clientConnectTimeout);
+  uint32_t numRetries{};
+  while(true) {
+    m_ClientSocket = Connect(reinterpret_cast<struct sockaddr *>(&address), sizeof(address), connectTimeout);
+    if(m_ClientSocket != SOCKET_INVALID)
+      break;
+    if(!m_IsRunning) {
+      SetUnlockState(UnlockState::CONNECT_ERROR);
+      goto threadEnd;
+    }
+#ifdef LINUX
+    if(isCachedChannel) {
+      // The phone may have been given another channel, search it again without using up a retry
+      spdlog::warn("Connecting to cached channel failed. (Channel={})", m_Channel);
+      isCachedChannel = false;
+      BTChannelCache::Remove(m_DeviceAddress);
+      m_Channel = BluetoothHelper::FindSDPChannel(m_DeviceAddress, CHANNEL_UUID);
+      if(m_Channel == -1) {
+        SetUnlockState(UnlockState::CONNECT_ERROR);
+        goto threadEnd;
+      }
+      BTChannelCache::Set(m_DeviceAddress, m_Channel);
+      address.rc_channel = m_Channel;
+      continue;
+    }
+#endif
+    if(numRetries >= settings->clientConnectRetries) {
+      SetUnlockState(UnlockState::CONNECT_ERROR);
+      goto threadEnd;
+    }
+    spdlog::warn("Connecting failed. (Retry={})", numRetries);
+    numRetries++;
   }
 
-  fd_set fdSet{};
-  FD_SET(m_ClientSocket, &fdSet);
-  struct timeval connectTimeout{};
-  connectTimeout.tv_sec = (long)settings.clientConnectTimeout;
-  int error = 0;
-  socklen_t errorLen = sizeof(error);
-  if(!SetSocketRWTimeout(m_ClientSocket, settings.clientSocketTimeout)) {
+  if(!SetSocketRWTimeout(m_ClientSocket, settings->clientSocketTimeout)) {
     spdlog::error("Failed setting R/W timeout for socket. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
-  if(!SetSocketBlocking(m_ClientSocket, false)) {
+
+  SetHasConnection(true);
+  PerformAuthFlow(m_ClientSocket);
+
+threadEnd:
+  m_IsRunning = false;
+  SetHasConnection(false);
+  SOCKET_CLOSE(m_ClientSocket);
+}
+
+SOCKET BTUnlockClient::Connect(const struct sockaddr *address, socklen_t addressLen, std::chrono::milliseconds timeout) {
+  auto clientSocket = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+  if(clientSocket == SOCKET_INVALID) {
+    spdlog::error("socket(AF_BLUETOOTH) failed. (Code={})", SOCKET_LAST_ERROR);
+    return SOCKET_INVALID;
+  }
+  if(!SetSocketBlocking(clientSocket, false)) {
     spdlog::error("Failed setting socket to non-blocking mode. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
-    goto threadEnd;
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
   }
-
-  if(connect(m_ClientSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+  if(connect(clientSocket, address, addressLen) < 0) {
     auto error = SOCKET_LAST_ERROR;
     if(error != SOCKET_ERROR_IN_PROGRESS && error != SOCKET_ERROR_WOULD_BLOCK) {
       spdlog::error("connect() failed. (Code={})", error);
-      m_UnlockState = UnlockState::CONNECT_ERROR;
-      goto threadEnd;
+      SOCKET_CLOSE(clientSocket);
+      return SOCKET_INVALID;
     }
   }
-  if(select((int)m_ClientSocket + 1, nullptr, &fdSet, nullptr, &connectTimeout) <= 0) {
-    spdlog::error("select() timed out or failed. (Code={}, Retry={})", SOCKET_LAST_ERROR, numRetries);
-    if(numRetries < settings.clientConnectRetries && m_IsRunning) {
-      SOCKET_CLOSE(m_ClientSocket);
-      numRetries++;
-      goto socketStart;
-    }
-    m_UnlockState = UnlockState::CONNECT_ERROR;
-    goto threadEnd;
+
+  // Stop() wakes this up through the notifier instead of waiting for the deadline
+  struct pollfd pollFds[2]{};
+  pollFds[0] = {clientSocket, POLLOUT, 0};
+  pollFds[1] = {m_StopNotifier.GetSocket(), POLLIN, 0};
+  auto pollResult = SOCKET_POLL(pollFds, 2, static_cast<int>(timeout.count()));
+  if(pollResult <= 0) {
+    spdlog::error("poll() timed out or failed. (Code={})", pollResult == 0 ? 0 : SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
+  }
+  if(pollFds[1].revents != 0) {
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
   }
 
-  if (getsockopt(m_ClientSocket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &errorLen) < 0) {
+  int error = 0;
+  socklen_t errorLen = sizeof(error);
+  if(getsockopt(clientSocket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &errorLen) < 0) {
     spdlog::error("getsockopt(SO_ERROR) failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
-    goto threadEnd;
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
   }
-  if (error != 0) {
-    spdlog::error("getsockopt(SO_ERROR) returned an error. (Code={}, Retry={})", error, numRetries);
-    if(numRetries < settings.clientConnectRetries && m_IsRunning) {
-      SOCKET_CLOSE(m_ClientSocket);
-      numRetries++;
-      goto socketStart;
-    }
-    m_UnlockState = UnlockState::CONNECT_ERROR;
-    goto threadEnd;
+  if(error != 0) {
+    spdlog::error("getsockopt(SO_ERROR) returned an error. (Code={})", error);
+    SOCKET_CLOSE(clientSocket);
+    return SOCKET_INVALID;
   }
-
-  m_HasConnection = true;
-  PerformAuthFlow(m_ClientSocket);
-
-threadEnd:
-  m_IsRunning = false;
-  m_HasConnection = false;
-  SOCKET_CLOSE(m_ClientSocket);
+  return clientSocket;
 }
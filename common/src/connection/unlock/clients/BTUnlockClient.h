@@ -4,6 +4,7 @@
 #include "BTUnlockClient.Mac.h"
 #else
 
+#include "connection/SocketNotifier.h"
 #include "connection/unlock/BaseUnlockConnection.h"
 
 class BTUnlockClient : public BaseUnlockConnection {
@@ -15,10 +16,13 @@ public:
 
 private:
   void ConnectThread();
+  // Non-blocking connect with a deadline, returns SOCKET_INVALID on failure or when stopped
+  SOCKET Connect(const struct sockaddr *address, socklen_t addressLen, std::chrono::milliseconds timeout);
 
   int m_Channel;
   SOCKET m_ClientSocket;
   std::string m_DeviceAddress;
+  SocketNotifier m_StopNotifier{};
 };
 
 #endif
@@ -0,0 +1,77 @@
+#include "LinkedUnlockClient.h"
+
+#include "connection/SocketDefs.h"
+
+LinkedUnlockClient::LinkedUnlockClient(KeepAliveLink *link, SOCKET socket, const PairedDevice &device) : BaseUnlockConnection(device) {
+  m_Link = link;
+  m_Socket = socket;
+  m_IsRunning = false;
+}
+
+LinkedUnlockClient::~LinkedUnlockClient() {
+  Stop();
+  ReleaseLink(true);
+}
+
+bool LinkedUnlockClient::Start() {
+  if(m_IsRunning)
+    return true;
+
+  m_IsRunning = true;
+  m_AcceptThread = std::thread(&LinkedUnlockClient::UnlockThread, this);
+  return true;
+}
+
+void LinkedUnlockClient::Stop() {
+  if(!m_IsRunning)
+    return;
+
+  m_IsRunning = false;
+  {
+    // Wakes up the pending read, which costs the link its connection
+    std::lock_guard lock(m_LinkMutex);
+    if(m_Socket != SOCKET_INVALID && PollResult() == UnlockState::UNKNOWN) {
+#ifdef WINDOWS
+      shutdown(m_Socket, SD_BOTH);
+#else
+      shutdown(m_Socket, SHUT_RDWR);
+#endif
+    }
+  }
+  if(m_AcceptThread.joinable())
+    m_AcceptThread.join();
+}
+
+void LinkedUnlockClient::UnlockThread() {
+  spdlog::info("Unlocking over keep-alive link. (SavedMs={})", m_Link->GetSetupTime().count());
+  SetHasConnection(true);
+  if(!OnConnectionOpened(m_Socket, false)) {
+    OnConnectionClosed(m_Socket, PacketError::CLOSED_CONNECTION);
+    SetHasConnection(false);
+    ReleaseLink(false);
+    return;
+  }
+
+  // Unlike PerformAuthFlow, the connection stays open after the response
+  PacketReadBuffer readBuffer{};
+  Packet packet{};
+  while(PollResult() == UnlockState::UNKNOWN) {
+    packet = ReadPacket(m_Socket, readBuffer, m_SocketTimeout);
+    if(packet.error != PacketError::NONE)
+      break;
+    if(packet.id == PACKET_ID_HEARTBEAT)
+      continue;
+    OnPacketReceived(m_Socket, packet);
+  }
+  OnConnectionClosed(m_Socket, packet.error);
+  SetHasConnection(false);
+  ReleaseLink(packet.error == PacketError::NONE);
+}
+
+void LinkedUnlockClient::ReleaseLink(bool isHealthy) {
+  std::lock_guard lock(m_LinkMutex);
+  if(m_Socket == SOCKET_INVALID)
+    return;
+  m_Link->Release(isHealthy);
+  m_Socket = SOCKET_INVALID;
+}
@@ -0,0 +1,25 @@
+#ifndef PCBU_DESKTOP_LINKEDUNLOCKCLIENT_H
+#define PCBU_DESKTOP_LINKEDUNLOCKCLIENT_H
+
+#include "connection/unlock/BaseUnlockConnection.h"
+#include "connection/unlock/links/KeepAliveLink.h"
+
+// Unlocks over the socket of an acquired keep-alive link and hands it back afterwards
+class LinkedUnlockClient : public BaseUnlockConnection {
+public:
+  LinkedUnlockClient(KeepAliveLink *link, SOCKET socket, const PairedDevice &device);
+  ~LinkedUnlockClient() override;
+
+  bool Start() override;
+  void Stop() override;
+
+private:
+  void UnlockThread();
+  void ReleaseLink(bool isHealthy);
+
+  KeepAliveLink *m_Link;
+  SOCKET m_Socket;
+  std::mutex m_LinkMutex{};
+};
+
+#endif // PCBU_DESKTOP_LINKEDUNLOCKCLIENT_H
@@ -1,11 +1,13 @@
 #ifndef PAM_PCBIOUNLOCK_TCPUNLOCKCLIENT_H
 #define PAM_PCBIOUNLOCK_TCPUNLOCKCLIENT_H
 
+#include "connection/SocketNotifier.h"
 #include "connection/unlock/BaseUnlockConnection.h"
 
 class TCPUnlockClient : public BaseUnlockConnection {
 public:
-  TCPUnlockClient(const std::string &ipAddress, int port, const PairedDevice &device);
+  // Connects to whichever of the addresses answers first
+  TCPUnlockClient(const std::vector<std::string> &addresses, int port, const PairedDevice &device);
 
   bool Start() override;
   void Stop() override;
@@ -13,9 +15,10 @@ public:
 private:
   void ConnectThread();
 
-  std::string m_IP;
+  std::vector<std::string> m_Addresses;
   int m_Port;
   SOCKET m_ClientSocket;
+  SocketNotifier m_StopNotifier{};
 };
 
 #endif // PAM_PCBIOUNLOCK_TCPUNLOCKCLIENT_H
@@ -0,0 +1,192 @@
+#include "KeepAliveLink.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "connection/Packets.h"
+#include "connection/SocketDefs.h"
+#include "connection/TCPConnector.h"
+#include "storage/AppSettings.h"
+#include "utils/StringUtils.h"
+
+#ifdef WINDOWS
+#include <Ws2tcpip.h>
+#else
+#include <netinet/tcp.h>
+#endif
+
+constexpr auto HEARTBEAT_INTERVAL = std::chrono::seconds(10);
+constexpr auto HEARTBEAT_TIMEOUT = std::chrono::seconds(5);
+constexpr auto MIN_RECONNECT_DELAY = std::chrono::seconds(1);
+constexpr auto MAX_RECONNECT_DELAY = std::chrono::seconds(60);
+constexpr size_t HEARTBEAT_TOKEN_SIZE = 16;
+
+KeepAliveLink::KeepAliveLink(const PairedDevice &device) {
+  m_Device = device;
+}
+
+KeepAliveLink::~KeepAliveLink() {
+  Stop();
+}
+
+void KeepAliveLink::Start() {
+  std::lock_guard lock(m_Mutex);
+  if(m_IsRunning)
+    return;
+  if(!m_StopNotifier.Open())
+    return;
+  m_IsRunning = true;
+  m_LinkThread = std::thread(&KeepAliveLink::LinkThread, this);
+}
+
+void KeepAliveLink::Stop() {
+  {
+    std::lock_guard lock(m_Mutex);
+    if(!m_IsRunning)
+      return;
+    m_IsRunning = false;
+  }
+  m_Condition.notify_all();
+  m_StopNotifier.Notify();
+  if(m_LinkThread.joinable())
+    m_LinkThread.join();
+  m_StopNotifier.Close();
+}
+
+SOCKET KeepAliveLink::Acquire() {
+  std::unique_lock lock(m_Mutex);
+  m_Condition.wait(lock, [&] { return !m_IsInHeartbeat; });
+  if(!m_IsRunning || m_IsAcquired || m_Socket == SOCKET_INVALID)
+    return SOCKET_INVALID;
+  // Catches links the phone has dropped since the last heartbeat, nothing else is sent while idle
+  struct pollfd pollFd{};
+  pollFd.fd = m_Socket;
+  pollFd.events = POLLIN;
+  auto isStale = std::chrono::steady_clock::now() - m_LastHeartbeat > 2 * HEARTBEAT_INTERVAL;
+  if(isStale || SOCKET_POLL(&pollFd, 1, 0) != 0) {
+    spdlog::warn("Keep-alive link is stale. (Device={})", m_Device.id);
+    CloseSocket();
+    m_Condition.notify_all();
+    return SOCKET_INVALID;
+  }
+  m_IsAcquired = true;
+  return m_Socket;
+}
+
+void KeepAliveLink::Release(bool isHealthy) {
+  {
+    std::lock_guard lock(m_Mutex);
+    m_IsAcquired = false;
+    if(isHealthy)
+      m_LastHeartbeat = std::chrono::steady_clock::now();
+    else
+      CloseSocket();
+  }
+  m_Condition.notify_all();
+}
+
+PairedDevice KeepAliveLink::GetDevice() const {
+  return m_Device;
+}
+
+std::chrono::milliseconds KeepAliveLink::GetSetupTime() {
+  std::lock_guard lock(m_Mutex);
+  return m_SetupTime;
+}
+
+void KeepAliveLink::LinkThread() {
+  auto reconnectDelay = std::chrono::duration_cast<std::chrono::milliseconds>(MIN_RECONNECT_DELAY);
+  std::unique_lock lock(m_Mutex);
+  while(m_IsRunning) {
+    if(m_Socket == SOCKET_INVALID) {
+      lock.unlock();
+      auto startTime = std::chrono::steady_clock::now();
+      auto socket = Connect();
+      auto setupTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+      lock.lock();
+      if(socket == SOCKET_INVALID) {
+        m_Condition.wait_for(lock, reconnectDelay, [&] { return !m_IsRunning; });
+        reconnectDelay = std::min(reconnectDelay * 2, std::chrono::duration_cast<std::chrono::milliseconds>(MAX_RECONNECT_DELAY));
+        continue;
+      }
+      if(!m_IsRunning) {
+        SOCKET_CLOSE(socket);
+        break;
+      }
+      spdlog::info("Keep-alive link connected. (Device={}, SetupMs={})", m_Device.id, setupTime.count());
+      m_Socket = socket;
+      m_SetupTime = setupTime;
+      m_LastHeartbeat = std::chrono::steady_clock::now();
+      reconnectDelay = std::chrono::duration_cast<std::chrono::milliseconds>(MIN_RECONNECT_DELAY);
+      continue;
+    }
+
+    if(m_IsAcquired) {
+      m_Condition.wait(lock, [&] { return !m_IsRunning || !m_IsAcquired; });
+      continue;
+    }
+    auto nextHeartbeat = m_LastHeartbeat + HEARTBEAT_INTERVAL;
+    m_Condition.wait_until(lock, nextHeartbeat, [&] { return !m_IsRunning || m_Socket == SOCKET_INVALID || m_IsAcquired; });
+    if(!m_IsRunning || m_Socket == SOCKET_INVALID || m_IsAcquired || std::chrono::steady_clock::now() < m_LastHeartbeat + HEARTBEAT_INTERVAL)
+      continue;
+    m_IsInHeartbeat = true;
+    auto socket = m_Socket;
+    lock.unlock();
+    auto isAlive = SendHeartbeat(socket);
+    lock.lock();
+    m_IsInHeartbeat = false;
+    if(isAlive) {
+      m_LastHeartbeat = std::chrono::steady_clock::now();
+    } else {
+      spdlog::warn("Keep-alive link lost. (Device={})", m_Device.id);
+      CloseSocket();
+    }
+    m_Condition.notify_all();
+  }
+  CloseSocket();
+}
+
+SOCKET KeepAliveLink::Connect() {
+  auto settings = AppSettings::Get();
+  auto socket = TCPConnector::Connect({m_Device.ipAddress}, m_Device.tcpPort, std::chrono::seconds(settings->clientConnectTimeout), &m_StopNotifier);
+  if(socket == SOCKET_INVALID)
+    return SOCKET_INVALID;
+  int opt = 1;
+  if(setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&opt), sizeof(opt)) ||
+     setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char *>(&opt), sizeof(opt))) {
+    spdlog::error("setsockopt() failed. (Code={})", SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(socket);
+    return SOCKET_INVALID;
+  }
+  // The first heartbeat tells the phone to keep the connection open and proves that both sides hold the key
+  if(!SendHeartbeat(socket)) {
+    spdlog::warn("Keep-alive handshake failed. (Device={})", m_Device.id);
+    SOCKET_CLOSE(socket);
+    return SOCKET_INVALID;
+  }
+  return socket;
+}
+
+bool KeepAliveLink::SendHeartbeat(SOCKET socket) {
+  // Requests and answers carry a different direction byte, so a reflected request is not accepted as an answer
+  auto token = StringUtils::RandomString(HEARTBEAT_TOKEN_SIZE);
+  std::vector<uint8_t> request{PACKET_HEARTBEAT_REQUEST};
+  request.insert(request.end(), token.begin(), token.end());
+  auto cryptResult = CryptUtils::EncryptAESPacket(request, m_Device.GetPacketKey());
+  if(cryptResult.result != PacketCryptResult::OK)
+    return false;
+  if(WritePacket(socket, PACKET_ID_HEARTBEAT, cryptResult.data, HEARTBEAT_TIMEOUT) != PacketError::NONE)
+    return false;
+
+  auto packet = ReadPacket(socket, HEARTBEAT_TIMEOUT);
+  if(packet.error != PacketError::NONE || packet.id != PACKET_ID_HEARTBEAT)
+    return false;
+  auto response = CryptUtils::DecryptAESPacket(packet.data, m_Device.GetPacketKey());
+  if(response.result != PacketCryptResult::OK || response.data.size() != request.size() || response.data[0] != PACKET_HEARTBEAT_RESPONSE)
+    return false;
+  return std::equal(response.data.begin() + 1, response.data.end(), request.begin() + 1);
+}
+
+void KeepAliveLink::CloseSocket() {
+  SOCKET_CLOSE(m_Socket);
+}
@@ -0,0 +1,51 @@
+#ifndef PCBU_DESKTOP_KEEPALIVELINK_H
+#define PCBU_DESKTOP_KEEPALIVELINK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "connection/BaseConnection.h"
+#include "connection/SocketNotifier.h"
+#include "storage/PairedDevicesStorage.h"
+
+// Long-lived, authenticated TCP connection to a paired phone. It is kept alive with heartbeats and reconnected
+// with a backoff, so an unlock only needs the request and the response on the already open socket.
+class KeepAliveLink : public BaseConnection {
+public:
+  explicit KeepAliveLink(const PairedDevice &device);
+  ~KeepAliveLink() override;
+
+  void Start();
+  void Stop();
+
+  // Hands the socket to an unlock, heartbeats pause until it is released. Returns SOCKET_INVALID if not connected.
+  SOCKET Acquire();
+  // An unhealthy socket is closed and the link reconnects
+  void Release(bool isHealthy);
+
+  [[nodiscard]] PairedDevice GetDevice() const;
+  // How long connecting and authenticating took, which is what an unlock over this link saves
+  [[nodiscard]] std::chrono::milliseconds GetSetupTime();
+
+private:
+  void LinkThread();
+  SOCKET Connect();
+  bool SendHeartbeat(SOCKET socket);
+  void CloseSocket();
+
+  PairedDevice m_Device{};
+  std::thread m_LinkThread{};
+  SocketNotifier m_StopNotifier{};
+  std::mutex m_Mutex{};
+  std::condition_variable m_Condition{};
+  bool m_IsRunning{};
+  bool m_IsAcquired{};
+  bool m_IsInHeartbeat{};
+  SOCKET m_Socket = SOCKET_INVALID;
+  std::chrono::steady_clock::time_point m_LastHeartbeat{};
+  std::chrono::milliseconds m_SetupTime{};
+};
+
+#endif // PCBU_DESKTOP_KEEPALIVELINK_H
@@ -0,0 +1,45 @@
+#include "KeepAliveLinkManager.h"
+
+#include <spdlog/spdlog.h>
+
+#include "utils/AppInfo.h"
+
+KeepAliveLinkManager::~KeepAliveLinkManager() {
+  Stop();
+}
+
+void KeepAliveLinkManager::Sync(const std::vector<PairedDevice> &devices) {
+  std::lock_guard lock(m_Mutex);
+  std::map<std::string, std::unique_ptr<KeepAliveLink>> links{};
+  for(const auto &device : devices) {
+    if(device.pairingMethod != PairingMethod::TCP || !device.SupportsUnlockProtocol(UNLOCK_PROTO_VERSION_KEEP_ALIVE))
+      continue;
+    auto it = m_Links.find(device.id);
+    if(it != m_Links.end()) {
+      auto linkDevice = it->second->GetDevice();
+      if(linkDevice.ipAddress == device.ipAddress && linkDevice.tcpPort == device.tcpPort && linkDevice.encryptionKey == device.encryptionKey) {
+        links[device.id] = std::move(it->second);
+        continue;
+      }
+    }
+    auto link = std::make_unique<KeepAliveLink>(device);
+    link->Start();
+    links[device.id] = std::move(link);
+  }
+  for(auto &[deviceId, link] : m_Links) {
+    if(link)
+      spdlog::info("Stopping keep-alive link. (Device={})", deviceId);
+  }
+  m_Links = std::move(links);
+}
+
+void KeepAliveLinkManager::Stop() {
+  std::lock_guard lock(m_Mutex);
+  m_Links.clear();
+}
+
+KeepAliveLink *KeepAliveLinkManager::GetLink(const std::string &deviceId) {
+  std::lock_guard lock(m_Mutex);
+  auto it = m_Links.find(deviceId);
+  return it != m_Links.end() ? it->second.get() : nullptr;
+}
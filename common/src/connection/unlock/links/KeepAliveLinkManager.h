@@ -0,0 +1,30 @@
+#ifndef PCBU_DESKTOP_KEEPALIVELINKMANAGER_H
+#define PCBU_DESKTOP_KEEPALIVELINKMANAGER_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "KeepAliveLink.h"
+
+// Keeps a link to every paired TCP device whose phone supports them. Links must not be removed while an
+// unlock uses one, so Sync() and Stop() are called between unlocks.
+class KeepAliveLinkManager {
+public:
+  ~KeepAliveLinkManager();
+
+  // Starts links for new devices, restarts links of changed devices and stops links of removed devices
+  void Sync(const std::vector<PairedDevice> &devices);
+  void Stop();
+
+  // nullptr if the device has no link
+  KeepAliveLink *GetLink(const std::string &deviceId);
+
+private:
+  std::map<std::string, std::unique_ptr<KeepAliveLink>> m_Links{};
+  std::mutex m_Mutex{};
+};
+
+#endif // PCBU_DESKTOP_KEEPALIVELINKMANAGER_H
@@ -32,7 +32,7 @@ void BTUnlockServer::Stop() {
     return;
 
   m_IsRunning = false;
-  m_HasConnection = false;
+  SetHasConnection(false);
   SOCKET_CLOSE(m_ServerSocket);
   if(m_AcceptThread.joinable())
     m_AcceptThread.join();
@@ -58,27 +58,27 @@ void BTUnlockServer::AcceptThread() {
   if((m_ServerSocket = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM)) == SOCKET_INVALID) {
     spdlog::error("socket(AF_BLUETOOTH) failed. (Code={})", SOCKET_LAST_ERROR);
     m_IsRunning = false;
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     return;
   }
 
   int opt = 1;
   if(setsockopt(m_ServerSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&opt), sizeof(opt))) {
     spdlog::error("setsockopt(SO_REUSEADDR) failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
 
   if(bind(m_ServerSocket, (struct sockaddr *)&address, sizeof(address)) < 0) {
     spdlog::error("bind() failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
 
 #ifdef WINDOWS
   if(getsockname(m_ServerSocket, (SOCKADDR *)&sockAddr, &sockAddrLen) != 0) {
     spdlog::error("getsockname() failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
   sdpService = BluetoothHelper::RegisterSDPService(sockAddr);
@@ -87,13 +87,13 @@ void BTUnlockServer::AcceptThread() {
 #endif
   if(!sdpService) {
     spdlog::error("RegisterSDPService() failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
 
   if(listen(m_ServerSocket, 3) < 0) {
     spdlog::error("listen() failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
 
@@ -106,7 +106,7 @@ void BTUnlockServer::AcceptThread() {
     }
     if(!SetSocketBlocking(clientSocket, false)) {
       spdlog::error("Failed setting client socket to non-blocking mode. (Code={})", SOCKET_LAST_ERROR);
-      m_UnlockState = UnlockState::UNK_ERROR;
+      SetUnlockState(UnlockState::UNK_ERROR);
       break;
     }
     spdlog::info("BT client connected.");
@@ -115,7 +115,7 @@ void BTUnlockServer::AcceptThread() {
 
 threadEnd:
   m_IsRunning = false;
-  m_HasConnection = false;
+  SetHasConnection(false);
   if(sdpService.has_value() && !BluetoothHelper::CloseSDPService(sdpService.value()))
     spdlog::warn("CloseSDPService() failed. (Code={})", SOCKET_LAST_ERROR);
   SOCKET_CLOSE(m_ServerSocket);
@@ -126,9 +126,9 @@ threadEnd:
 }
 
 void BTUnlockServer::ClientThread(SOCKET clientSocket) {
-  m_HasConnection = true;
+  SetHasConnection(true);
   PerformAuthFlow(clientSocket, true);
-  m_HasConnection = false;
+  SetHasConnection(false);
   SOCKET_CLOSE(clientSocket);
   spdlog::info("BT Client closed.");
 }
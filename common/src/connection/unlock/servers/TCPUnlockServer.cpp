@@ -1,5 +1,7 @@
 #include "TCPUnlockServer.h"
 
+#include <algorithm>
+
 #include "connection/SocketDefs.h"
 #include "handler/UnlockState.h"
 #include "storage/AppSettings.h"
@@ -11,10 +13,11 @@
 #include <netinet/tcp.h>
 #endif
 
-constexpr int MAX_CLIENTS = 10;
+constexpr size_t NUM_WORKERS = 2;
 
-TCPUnlockServer::TCPUnlockServer() : BaseUnlockConnection() {
+TCPUnlockServer::TCPUnlockServer(size_t maxClients) : BaseUnlockConnection() {
   m_ServerSocket = SOCKET_INVALID;
+  m_MaxClients = maxClients;
 }
 
 bool TCPUnlockServer::IsServer() {
@@ -26,115 +29,216 @@ bool TCPUnlockServer::Start() {
     return true;
 
   WSA_STARTUP
+  if(!m_Notifier.Open())
+    return false;
   m_IsRunning = true;
-  m_AcceptThread = std::thread(&TCPUnlockServer::AcceptThread, this);
+  m_AcceptThread = std::thread(&TCPUnlockServer::ServerThread, this);
   return true;
 }
 
 void TCPUnlockServer::Stop() {
-  SOCKET_CLOSE(m_ServerSocket);
+  m_IsRunning = false;
+  m_Notifier.Notify();
   if(m_AcceptThread.joinable())
     m_AcceptThread.join();
-  m_IsRunning = false;
-  m_HasConnection = false;
+  m_Notifier.Close();
+  SetHasConnection(false);
 }
 
-void TCPUnlockServer::AcceptThread() {
+void TCPUnlockServer::ServerThread() {
   struct sockaddr_in address {};
-  socklen_t addrLen = sizeof(address);
   auto settings = AppSettings::Get();
-  auto clientSockets = std::vector<SOCKET>();
-  auto clientThreads = std::vector<std::thread>();
+  auto clients = std::map<SOCKET, ClientConnection>();
+  auto pollFds = std::vector<struct pollfd>();
+  auto finishedClients = std::vector<SOCKET>();
+  auto expiredClients = std::vector<SOCKET>();
+  ThreadPool workerPool(NUM_WORKERS);
   spdlog::info("Starting TCP server...");
 
   if((m_ServerSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) == SOCKET_INVALID) {
     spdlog::error("socket() failed. (Code={})", SOCKET_LAST_ERROR);
     m_IsRunning = false;
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     return;
   }
 
   int opt = 1;
   if(setsockopt(m_ServerSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&opt), sizeof(opt))) {
     spdlog::error("setsockopt(SO_REUSEADDR) failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
   if(setsockopt(m_ServerSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&opt), sizeof(opt))) {
     spdlog::error("setsockopt(TCP_NODELAY) failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
 
   address.sin_family = AF_INET;
   address.sin_addr.s_addr = INADDR_ANY;
-  address.sin_port = htons(settings.unlockServerPort);
+  address.sin_port = htons(settings->unlockServerPort);
   if(bind(m_ServerSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
     spdlog::error("bind() failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::PORT_ERROR;
+    SetUnlockState(UnlockState::PORT_ERROR);
     goto threadEnd;
   }
-  if(listen(m_ServerSocket, MAX_CLIENTS) < 0) {
+  if(listen(m_ServerSocket, (int)m_MaxClients) < 0) {
     spdlog::error("listen() failed. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
   if(!SetSocketBlocking(m_ServerSocket, false)) {
     spdlog::error("Failed setting server socket to non-blocking mode. (Code={})", SOCKET_LAST_ERROR);
-    m_UnlockState = UnlockState::UNK_ERROR;
+    SetUnlockState(UnlockState::UNK_ERROR);
     goto threadEnd;
   }
 
-  spdlog::info("TCP server started on port '{}'.", settings.unlockServerPort);
+  spdlog::info("TCP server started on port '{}'.", settings->unlockServerPort);
   while(m_IsRunning) {
-    if(m_NumConnections >= MAX_CLIENTS) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(50));
-      continue;
+    // Busy clients are not polled, so their packets stay in order
+    pollFds.clear();
+    pollFds.push_back({m_Notifier.GetSocket(), POLLIN, 0});
+    if(clients.size() < m_MaxClients)
+      pollFds.push_back({m_ServerSocket, POLLIN, 0});
+    auto nextDeadline = std::chrono::steady_clock::time_point::max();
+    for(const auto &[clientSocket, client] : clients) {
+      if(client.isBusy)
+        continue;
+      pollFds.push_back({clientSocket, POLLIN, 0});
+      nextDeadline = std::min(nextDeadline, client.deadline);
     }
-    SOCKET clientSocket;
-    if((clientSocket = accept(m_ServerSocket, reinterpret_cast<struct sockaddr *>(&address), (socklen_t *)&addrLen)) == SOCKET_INVALID) {
+    int timeoutMs = -1;
+    if(nextDeadline != std::chrono::steady_clock::time_point::max()) {
+      auto remaining = std::chrono::ceil<std::chrono::milliseconds>(nextDeadline - std::chrono::steady_clock::now()).count();
+      timeoutMs = (int)std::clamp<int64_t>(remaining, 0, INT32_MAX);
+    }
+
+    if(SOCKET_POLL(pollFds.data(), pollFds.size(), timeoutMs) < 0) {
       auto err = SOCKET_LAST_ERROR;
-      if(err == SOCKET_ERROR_TRY_AGAIN || err == SOCKET_ERROR_WOULD_BLOCK) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      if(err == SOCKET_ERROR_INTERRUPTED)
         continue;
-      }
-      if(err != SOCKET_ERROR_CONNECT_ABORTED)
-        spdlog::error("accept() failed. (Code={})", err);
+      spdlog::error("poll() failed. (Code={})", err);
+      SetUnlockState(UnlockState::UNK_ERROR);
       break;
     }
-    if(!SetSocketBlocking(clientSocket, false)) {
-      spdlog::error("Failed setting client socket to non-blocking mode. (Code={})", SOCKET_LAST_ERROR);
-      m_UnlockState = UnlockState::UNK_ERROR;
-      break;
+    for(const auto &pollFd : pollFds) {
+      if(pollFd.revents == 0)
+        continue;
+      if(pollFd.fd == m_Notifier.GetSocket()) {
+        m_Notifier.Drain();
+      } else if(pollFd.fd == m_ServerSocket) {
+        if(!AcceptClients(clients))
+          goto threadEnd;
+      } else {
+        ReadClient(clients, pollFd.fd, workerPool);
+      }
+    }
+
+    // Continue with the next buffered packet once a worker is done
+    {
+      std::lock_guard lock(m_FinishedClientsMutex);
+      finishedClients.swap(m_FinishedClients);
+    }
+    for(auto clientSocket : finishedClients) {
+      auto it = clients.find(clientSocket);
+      if(it == clients.end())
+        continue;
+      it->second.isBusy = false;
+      it->second.deadline = std::chrono::steady_clock::now() + m_SocketTimeout;
+      DispatchPacket(clients, clientSocket, workerPool);
     }
-    clientSockets.emplace_back(clientSocket);
-    clientThreads.emplace_back(&TCPUnlockServer::ClientThread, this, clientSocket);
+    finishedClients.clear();
+
+    auto now = std::chrono::steady_clock::now();
+    for(const auto &[clientSocket, client] : clients)
+      if(!client.isBusy && client.deadline <= now)
+        expiredClients.push_back(clientSocket);
+    for(auto clientSocket : expiredClients) {
+      spdlog::error("TCP client timed out.");
+      CloseClient(clients, clientSocket, PacketError::TIMEOUT);
+    }
+    expiredClients.clear();
   }
 
 threadEnd:
-  for(auto clientSocket : clientSockets) {
-    SOCKET_CLOSE(clientSocket);
-  }
+  workerPool.Stop();
+  while(!clients.empty())
+    CloseClient(clients, clients.begin()->first, PacketError::CLOSED_CONNECTION);
   SOCKET_CLOSE(m_ServerSocket);
-  for(auto &thread : clientThreads)
-    if(thread.joinable())
-      thread.join();
-  m_HasConnection = false;
+  m_FinishedClients.clear();
+  SetHasConnection(false);
   m_IsRunning = false;
   spdlog::info("TCP server stopped.");
 }
 
-void TCPUnlockServer::ClientThread(SOCKET clientSocket) {
-  spdlog::info("TCP client connected.");
-  m_HasConnection = true;
-  ++m_NumConnections;
-  int opt = 1;
-  if(setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&opt), sizeof(opt))) {
-    spdlog::error("setsockopt(TCP_NODELAY) failed. (Code={})", SOCKET_LAST_ERROR);
+bool TCPUnlockServer::AcceptClients(std::map<SOCKET, ClientConnection> &clients) {
+  while(clients.size() < m_MaxClients) {
+    struct sockaddr_in address {};
+    socklen_t addrLen = sizeof(address);
+    SOCKET clientSocket;
+    if((clientSocket = accept(m_ServerSocket, reinterpret_cast<struct sockaddr *>(&address), &addrLen)) == SOCKET_INVALID) {
+      auto err = SOCKET_LAST_ERROR;
+      if(err == SOCKET_ERROR_TRY_AGAIN || err == SOCKET_ERROR_WOULD_BLOCK || err == SOCKET_ERROR_CONNECT_ABORTED || err == SOCKET_ERROR_INTERRUPTED)
+        return true;
+      spdlog::error("accept() failed. (Code={})", err);
+      return false;
+    }
+    if(!SetSocketBlocking(clientSocket, false)) {
+      spdlog::error("Failed setting client socket to non-blocking mode. (Code={})", SOCKET_LAST_ERROR);
+      SetUnlockState(UnlockState::UNK_ERROR);
+      SOCKET_CLOSE(clientSocket);
+      return false;
+    }
+    int opt = 1;
+    if(setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&opt), sizeof(opt))) {
+      spdlog::error("setsockopt(TCP_NODELAY) failed. (Code={})", SOCKET_LAST_ERROR);
+    }
+
+    spdlog::info("TCP client connected.");
+    auto &client = clients[clientSocket];
+    client.deadline = std::chrono::steady_clock::now() + m_SocketTimeout;
+    SetHasConnection(true);
+    OnConnectionOpened(clientSocket, true);
+  }
+  return true;
+}
+
+void TCPUnlockServer::ReadClient(std::map<SOCKET, ClientConnection> &clients, SOCKET clientSocket, ThreadPool &workerPool) {
+  auto &client = clients.at(clientSocket);
+  size_t bytesRead{};
+  auto error = ReceiveData(clientSocket, client.readBuffer, client.minReadSize, bytesRead);
+  if(error != PacketError::NONE) {
+    CloseClient(clients, clientSocket, error);
+    return;
   }
-  PerformAuthFlow(clientSocket, true);
-  --m_NumConnections;
-  m_HasConnection = m_NumConnections > 0;
+  DispatchPacket(clients, clientSocket, workerPool);
+}
+
+void TCPUnlockServer::DispatchPacket(std::map<SOCKET, ClientConnection> &clients, SOCKET clientSocket, ThreadPool &workerPool) {
+  auto &client = clients.at(clientSocket);
+  Packet packet{};
+  if(client.isBusy || !ParsePacket(client.readBuffer, packet, client.minReadSize))
+    return;
+  if(packet.error != PacketError::NONE) {
+    CloseClient(clients, clientSocket, packet.error);
+    return;
+  }
+
+  client.isBusy = true;
+  workerPool.Post([this, clientSocket, packet = std::move(packet)]() mutable {
+    OnPacketReceived(clientSocket, packet);
+    {
+      std::lock_guard lock(m_FinishedClientsMutex);
+      m_FinishedClients.push_back(clientSocket);
+    }
+    m_Notifier.Notify();
+  });
+}
+
+void TCPUnlockServer::CloseClient(std::map<SOCKET, ClientConnection> &clients, SOCKET clientSocket, PacketError error) {
+  OnConnectionClosed(clientSocket, error);
+  clients.erase(clientSocket);
+  SetHasConnection(!clients.empty());
   SOCKET_CLOSE(clientSocket);
   spdlog::info("TCP client closed.");
 }
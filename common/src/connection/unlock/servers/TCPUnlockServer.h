@@ -1,22 +1,45 @@
 #ifndef PCBU_DESKTOP_TCPUNLOCKSERVER_H
 #define PCBU_DESKTOP_TCPUNLOCKSERVER_H
 
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "connection/SocketNotifier.h"
 #include "connection/unlock/BaseUnlockConnection.h"
+#include "utils/ThreadPool.h"
 
 class TCPUnlockServer : public BaseUnlockConnection {
 public:
-  TCPUnlockServer();
+  explicit TCPUnlockServer(size_t maxClients = DEFAULT_MAX_CLIENTS);
+
+  static constexpr size_t DEFAULT_MAX_CLIENTS = 10;
 
   bool IsServer() override;
   bool Start() override;
   void Stop() override;
 
 private:
-  void AcceptThread();
-  void ClientThread(SOCKET clientSocket);
+  struct ClientConnection {
+    PacketReadBuffer readBuffer{};
+    size_t minReadSize = 1;
+    std::chrono::steady_clock::time_point deadline{};
+    bool isBusy{};
+  };
+
+  // Single event loop owning the server socket and all client sockets.
+  // Packets are handed to a worker pool, as handling them involves key derivation.
+  void ServerThread();
+  bool AcceptClients(std::map<SOCKET, ClientConnection> &clients);
+  void ReadClient(std::map<SOCKET, ClientConnection> &clients, SOCKET clientSocket, ThreadPool &workerPool);
+  void DispatchPacket(std::map<SOCKET, ClientConnection> &clients, SOCKET clientSocket, ThreadPool &workerPool);
+  void CloseClient(std::map<SOCKET, ClientConnection> &clients, SOCKET clientSocket, PacketError error);
 
   SOCKET m_ServerSocket;
-  std::atomic<int> m_NumConnections{};
+  size_t m_MaxClients;
+  SocketNotifier m_Notifier{};
+  std::vector<SOCKET> m_FinishedClients{};
+  std::mutex m_FinishedClientsMutex{};
 };
 
 #endif // PCBU_DESKTOP_TCPUNLOCKSERVER_H
@@ -5,12 +5,17 @@
 #ifdef WINDOWS
 #include <Windows.h>
 #elif LINUX
-#include <chrono>
+#include <algorithm>
 #include <fcntl.h>
 #include <filesystem>
 #include <linux/input.h>
-#include <thread>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
+
+#define INPUT_DIR "/dev/input/"
+#define KEYBOARD_DIR "/dev/input/by-path/"
 #elif APPLE
 #include <Carbon/Carbon.h>
 #endif
@@ -24,9 +29,14 @@ bool KeyScanner::GetKeyState(int key) {
   return GetAsyncKeyState(key) < 0;
 #endif
 #ifdef LINUX
+  if(key < 0 || key > KEY_MAX)
+    return false;
   std::lock_guard<std::mutex> lock(m_ScanMutex);
-  for(auto keyMap : m_KeyMaps) {
-    if(keyMap.count(key) && keyMap[key])
+  for(const auto &keyboard : m_Keyboards) {
+    uint8_t keyBits[KEY_MAX / 8 + 1]{};
+    if(ioctl(keyboard.fd, EVIOCGKEY(sizeof(keyBits)), keyBits) < 0)
+      continue;
+    if(keyBits[key / 8] & (1 << (key % 8)))
       return true;
   }
   return false;
@@ -47,10 +57,18 @@ std::map<int, bool> KeyScanner::GetAllKeys() {
   return map;
 #endif
 #ifdef LINUX
+  auto map = std::map<int, bool>();
   std::lock_guard<std::mutex> lock(m_ScanMutex);
-  if(m_KeyMaps.empty())
-    return {};
-  return m_KeyMaps[0]; // ToDo
+  for(const auto &keyboard : m_Keyboards) {
+    uint8_t keyBits[KEY_MAX / 8 + 1]{};
+    if(ioctl(keyboard.fd, EVIOCGKEY(sizeof(keyBits)), keyBits) < 0)
+      continue;
+    for(int i = 0; i <= KEY_MAX; i++) {
+      if(keyBits[i / 8] & (1 << (i % 8)))
+        map[i] = true;
+    }
+  }
+  return map;
 #endif
 #ifdef APPLE
   auto map = std::map<int, bool>();
@@ -61,38 +79,20 @@ std::map<int, bool> KeyScanner::GetAllKeys() {
 #endif
 }
 
-void KeyScanner::Start() {
+void KeyScanner::Start(const std::function<void()> &onKeyEvent) {
 #ifdef LINUX
   if(m_IsRunning)
     return;
 
   m_IsRunning = true;
-  for(const auto &keyboard : GetKeyboards()) {
-    int kbd = open(keyboard.c_str(), O_RDONLY);
-    if(kbd == -1) {
-      spdlog::error("Keyboard open() failed. (Code={})", errno);
-      continue;
-    }
-    int flags = fcntl(kbd, F_GETFL, 0);
-    if(flags == -1) {
-      spdlog::error("Keyboard fcntl() failed. (Code={})", errno);
-      continue;
-    }
-    if(fcntl(kbd, F_SETFL, flags | O_NONBLOCK) == -1) {
-      spdlog::error("Keyboard fcntl(O_NONBLOCK) failed. (Code={})", errno);
-      continue;
-    }
-    m_KeyboardFds.push_back(kbd);
-  }
-  if(m_KeyboardFds.empty()) {
-    spdlog::error("No keyboards found.");
-    return;
-  }
-  m_KeyMaps.clear();
-  for(int i = 0; i < m_KeyboardFds.size(); i++) {
-    m_KeyMaps.emplace_back();
-    m_ScanThreads.emplace_back(&KeyScanner::ScanThread, this, i);
-  }
+  m_OnKeyEvent = onKeyEvent;
+  WatchKeyboards();
+  OpenKeyboards();
+  if(m_Keyboards.empty())
+    spdlog::warn("No keyboards found.");
+  // Key states are queried on demand, the thread only wakes up for key events and new keyboards
+  if(m_OnKeyEvent && m_StopNotifier.Open())
+    m_ScanThread = std::thread(&KeyScanner::ScanThread, this);
 #endif
 }
 
@@ -102,32 +102,130 @@ void KeyScanner::Stop() {
     return;
 
   m_IsRunning = false;
-  for(auto fd : m_KeyboardFds)
-    close(fd);
-  for(auto &thread : m_ScanThreads)
-    if(thread.joinable())
-      thread.join();
-  m_KeyboardFds.clear();
-  m_ScanThreads.clear();
+  if(m_ScanThread.joinable()) {
+    m_StopNotifier.Notify();
+    m_ScanThread.join();
+  }
+  m_StopNotifier.Close();
+  std::lock_guard<std::mutex> lock(m_ScanMutex);
+  for(const auto &keyboard : m_Keyboards)
+    close(keyboard.fd);
+  m_Keyboards.clear();
+  if(m_InotifyFd != -1)
+    close(m_InotifyFd);
+  m_InotifyFd = -1;
+  m_WatchFd = -1;
+  m_IsWatchingByPath = false;
 #endif
 }
 
+bool KeyScanner::HasKeyEvents() const {
 #ifdef LINUX
-void KeyScanner::ScanThread(int idx) {
-  while(m_IsRunning) {
-    struct input_event ie{};
-    if(read(m_KeyboardFds[idx], &ie, sizeof(ie)) == sizeof(ie)) {
-      m_ScanMutex.lock();
-      m_KeyMaps[idx][ie.code] = ie.value != 0;
-      m_ScanMutex.unlock();
+  return m_ScanThread.joinable();
+#else
+  return false;
+#endif
+}
+
+#ifdef LINUX
+void KeyScanner::OpenKeyboards() {
+  std::lock_guard<std::mutex> lock(m_ScanMutex);
+  for(const auto &path : GetKeyboards()) {
+    if(std::any_of(m_Keyboards.begin(), m_Keyboards.end(), [&](const Keyboard &keyboard) { return keyboard.path == path; }))
+      continue;
+    int kbd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if(kbd == -1) {
+      spdlog::error("Keyboard open() failed. (Code={})", errno);
+      continue;
+    }
+    m_Keyboards.push_back({path, kbd});
+  }
+}
+
+void KeyScanner::WatchKeyboards() {
+  if(m_InotifyFd == -1) {
+    if((m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+      spdlog::error("inotify_init1() failed. (Code={})", errno);
+      return;
+    }
+    // Catches the creation of the by-path directory when no keyboard was connected
+    if(inotify_add_watch(m_InotifyFd, INPUT_DIR, IN_CREATE | IN_MOVED_TO) == -1)
+      spdlog::error("inotify_add_watch() failed. (Code={})", errno);
+  }
+  if(m_IsWatchingByPath)
+    return;
+  std::error_code error{};
+  if(std::filesystem::is_directory(KEYBOARD_DIR, error))
+    m_IsWatchingByPath = (m_WatchFd = inotify_add_watch(m_InotifyFd, KEYBOARD_DIR, IN_CREATE | IN_MOVED_TO)) != -1;
+}
+
+void KeyScanner::ScanThread() {
+  while(true) {
+    std::vector<struct pollfd> pollFds{};
+    pollFds.push_back({m_StopNotifier.GetSocket(), POLLIN, 0});
+    pollFds.push_back({m_InotifyFd, POLLIN, 0});
+    m_ScanMutex.lock();
+    for(const auto &keyboard : m_Keyboards)
+      pollFds.push_back({keyboard.fd, POLLIN, 0});
+    m_ScanMutex.unlock();
+
+    if(poll(pollFds.data(), pollFds.size(), -1) < 0) {
+      if(errno == EINTR)
+        continue;
+      spdlog::error("Keyboard poll() failed. (Code={})", errno);
+      return;
+    }
+    if(pollFds[0].revents != 0)
+      return;
+
+    // New keyboards
+    if(pollFds[1].revents & POLLIN) {
+      alignas(struct inotify_event) char buffer[4096];
+      ssize_t numBytes{};
+      while((numBytes = read(m_InotifyFd, buffer, sizeof(buffer))) > 0) {
+        for(ssize_t offset = 0; offset < numBytes;) {
+          auto event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+          if(event->wd == m_WatchFd && (event->mask & IN_IGNORED))
+            m_IsWatchingByPath = false;
+          offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+        }
+      }
+      WatchKeyboards();
+      OpenKeyboards();
+    }
+
+    // Key events, only used as a trigger since states are read with EVIOCGKEY
+    auto hasKeyEvent = false;
+    for(size_t i = 2; i < pollFds.size(); i++) {
+      auto isRemoved = (pollFds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+      if(!isRemoved && (pollFds[i].revents & POLLIN)) {
+        struct input_event events[64];
+        ssize_t numBytes{};
+        while((numBytes = read(pollFds[i].fd, events, sizeof(events))) > 0) {
+          for(size_t j = 0; j < numBytes / sizeof(struct input_event); j++)
+            hasKeyEvent |= events[j].type == EV_KEY;
+        }
+        isRemoved = numBytes < 0 && errno == ENODEV;
+      }
+      if(isRemoved) {
+        std::lock_guard<std::mutex> lock(m_ScanMutex);
+        auto it = std::find_if(m_Keyboards.begin(), m_Keyboards.end(), [&](const Keyboard &keyboard) { return keyboard.fd == pollFds[i].fd; });
+        if(it != m_Keyboards.end()) {
+          close(it->fd);
+          m_Keyboards.erase(it);
+        }
+        hasKeyEvent = true;
+      }
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if(hasKeyEvent)
+      m_OnKeyEvent();
   }
 }
 
 std::vector<std::string> KeyScanner::GetKeyboards() {
   auto keyboards = std::vector<std::string>();
-  for(const auto &entry : std::filesystem::directory_iterator("/dev/input/by-path/")) {
+  std::error_code error{};
+  for(const auto &entry : std::filesystem::directory_iterator(KEYBOARD_DIR, error)) {
     if(entry.path().filename().string().ends_with("-event-kbd"))
       keyboards.push_back(entry.path().string());
   }
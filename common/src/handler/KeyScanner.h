@@ -1,12 +1,19 @@
 #ifndef PAM_PCBIOUNLOCK_KEYSCANNER_H
 #define PAM_PCBIOUNLOCK_KEYSCANNER_H
 
+#include <functional>
 #include <map>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "utils/Utils.h"
 
+#ifdef LINUX
+#include "connection/SocketNotifier.h"
+#endif
+
 class KeyScanner {
 public:
   ~KeyScanner();
@@ -14,20 +21,33 @@ public:
   bool GetKeyState(int key);
   std::map<int, bool> GetAllKeys();
 
-  void Start();
+  // onKeyEvent is called from the scanner thread whenever a key changes
+  void Start(const std::function<void()> &onKeyEvent = {});
   void Stop();
+  // False if key changes are not reported and GetKeyState has to be polled
+  [[nodiscard]] bool HasKeyEvents() const;
 
 private:
 #ifdef LINUX
+  struct Keyboard {
+    std::string path{};
+    int fd{};
+  };
+
   static std::vector<std::string> GetKeyboards();
-  void ScanThread(int idx);
+  void OpenKeyboards();
+  void WatchKeyboards();
+  void ScanThread();
 
-  std::vector<int> m_KeyboardFds{};
-  std::vector<std::thread> m_ScanThreads{};
+  std::vector<Keyboard> m_Keyboards{};
   std::mutex m_ScanMutex{};
+  std::thread m_ScanThread{};
+  SocketNotifier m_StopNotifier{};
+  int m_InotifyFd = -1;
+  int m_WatchFd = -1;
+  bool m_IsWatchingByPath{};
   bool m_IsRunning{};
-
-  std::vector<std::map<int, bool>> m_KeyMaps{};
+  std::function<void()> m_OnKeyEvent{};
 #endif
 };
 
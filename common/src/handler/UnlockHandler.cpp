@@ -1,10 +1,14 @@
 #include "UnlockHandler.h"
 
+#include <algorithm>
+
 #include "KeyScanner.h"
 #include "connection/unlock/clients/BTUnlockClient.h"
+#include "connection/unlock/clients/LinkedUnlockClient.h"
 #include "connection/unlock/clients/TCPUnlockClient.h"
 #include "connection/unlock/servers/TCPUnlockServer.h"
 #include "storage/AppSettings.h"
+#include "utils/AppInfo.h"
 
 #ifdef WINDOWS
 #include <Windows.h>
@@ -18,32 +22,47 @@
 #define KEY_LEFTALT kVK_Option
 #endif
 
+// Used where the key scanner cannot report key events
+constexpr auto KEY_POLL_INTERVAL = std::chrono::milliseconds(50);
+
 UnlockHandler::UnlockHandler(const std::function<void(std::string)> &printMessage) {
   m_PrintMessage = printMessage;
 }
 
-UnlockResult UnlockHandler::GetResult(const std::string &authUser, const std::string &authProgram, std::atomic<bool> *isRunning) {
+UnlockResult UnlockHandler::GetResult(const std::string &authUser, const std::string &authProgram) {
+  m_Trace.Begin(authUser, authProgram);
   auto settings = AppSettings::Get();
   auto devices = PairedDevicesStorage::GetDevicesForUser(authUser);
+  m_Trace.Mark("devices_loaded");
   auto hasTCPServer = false;
 
   UDPUnlockBroadcaster *udpBroadcaster{};
   std::vector<BaseUnlockConnection *> connections{};
-  for(const auto &device : devices) {
+  for(const auto &devicePtr : devices) {
+    const auto &device = *devicePtr;
     BaseUnlockConnection *connection{};
     switch(device.pairingMethod) {
-      case PairingMethod::TCP:
-        connection = new TCPUnlockClient(device.ipAddress, device.tcpPort, device);
+      case PairingMethod::TCP: {
+        if(auto link = m_KeepAliveLinks != nullptr ? m_KeepAliveLinks->GetLink(device.id) : nullptr) {
+          if(auto linkSocket = link->Acquire(); linkSocket != SOCKET_INVALID) {
+            connection = new LinkedUnlockClient(link, linkSocket, device);
+            break;
+          }
+        }
+        connection = new TCPUnlockClient({device.ipAddress}, device.tcpPort, device);
         break;
+      }
       case PairingMethod::BLUETOOTH:
         connection = new BTUnlockClient(device.bluetoothAddress, device);
         break;
       case PairingMethod::MANUAL_UDP:
       case PairingMethod::UDP: {
-        if(udpBroadcaster == nullptr)
+        if(udpBroadcaster == nullptr) {
           udpBroadcaster = new UDPUnlockBroadcaster();
+          udpBroadcaster->SetTrace(&m_Trace);
+        }
         auto port = device.pairingMethod == PairingMethod::UDP ? device.udpPort : device.udpManualPort;
-        udpBroadcaster->AddDevice(device.id, port, device.pairingMethod == PairingMethod::MANUAL_UDP);
+        udpBroadcaster->AddDevice(device.id, port, device.pairingMethod == PairingMethod::MANUAL_UDP, device.SupportsUnlockProtocol(UNLOCK_PROTO_VERSION_BINARY));
       }
       case PairingMethod::CLOUD_TCP:
         hasTCPServer = true;
@@ -55,41 +74,45 @@ UnlockResult UnlockHandler::GetResult(const std::string &authUser, const std::st
     }
     if(connection != nullptr) {
       connection->SetUnlockInfo(authUser, authProgram);
+      connection->SetTrace(&m_Trace);
       connections.emplace_back(connection);
     }
   }
   if(hasTCPServer) {
     auto server = new TCPUnlockServer();
     server->SetUnlockInfo(authUser, authProgram);
+    server->SetTrace(&m_Trace);
     connections.emplace_back(server);
   }
   if(connections.empty()) {
     auto errorMsg = I18n::Get("error_not_paired", authUser);
     spdlog::error(errorMsg);
     m_PrintMessage(errorMsg);
+    m_Trace.SetResult(UnlockState::NOT_PAIRED_ERROR);
     return UnlockResult(UnlockState::NOT_PAIRED_ERROR);
   }
+  return GetResult(connections, udpBroadcaster);
+}
 
+UnlockResult UnlockHandler::GetResult(const std::vector<BaseUnlockConnection *> &connections, UDPUnlockBroadcaster *udpBroadcaster) {
   // Start servers
+  m_IsKeyCanceled = false;
   std::vector<std::thread> threads{};
   AtomicUnlockResult currentResult{};
-  std::atomic completed(0);
-  std::mutex mutex{};
-  std::condition_variable cv{};
+  std::atomic<size_t> completed(0);
   auto numServers = connections.size();
   threads.reserve(numServers);
   for(auto connection : connections) {
-    threads.emplace_back([this, connection, numServers, isRunning, &currentResult, &completed, &cv, &mutex, udpBroadcaster]() {
-      auto serverResult = RunServer(connection, udpBroadcaster, &currentResult, isRunning);
-      completed.fetch_add(1);
+    connection->SetStateEvent(&m_StateEvent);
+    threads.emplace_back([this, connection, numServers, &currentResult, &completed, udpBroadcaster]() {
+      auto serverResult = RunServer(connection, udpBroadcaster, &currentResult);
       if(serverResult.state == UnlockState::SUCCESS)
         currentResult.store(serverResult);
-      if(completed.load() == numServers) {
+      if(completed.fetch_add(1) + 1 == numServers) {
         if(currentResult.load().state != UnlockState::SUCCESS)
           currentResult.store(serverResult);
-        std::lock_guard l(mutex);
-        cv.notify_one();
       }
+      m_StateEvent.Notify();
     });
   }
 
@@ -98,9 +121,21 @@ UnlockResult UnlockHandler::GetResult(const std::string &authUser, const std::st
     udpBroadcaster->Start();
   }
 
-  // Wait
-  std::unique_lock lock(mutex);
-  cv.wait(lock, [&] { return completed.load() == numServers; });
+  // Wait, the servers and the key scanner wake this thread on every state change
+  auto keyScanner = KeyScanner();
+  keyScanner.Start([this]() { m_StateEvent.Notify(); });
+  auto generation = m_StateEvent.GetGeneration();
+  while(completed.load() != numServers) {
+    if(!m_IsKeyCanceled && keyScanner.GetKeyState(KEY_LEFTCTRL) && keyScanner.GetKeyState(KEY_LEFTALT)) {
+      m_IsKeyCanceled = true;
+      m_StateEvent.Notify();
+    }
+    if(keyScanner.HasKeyEvents())
+      generation = m_StateEvent.Wait(generation);
+    else
+      generation = m_StateEvent.WaitFor(generation, KEY_POLL_INTERVAL);
+  }
+  keyScanner.Stop();
   auto result = currentResult.load();
 
   // Cleanup
@@ -114,11 +149,30 @@ UnlockResult UnlockHandler::GetResult(const std::string &authUser, const std::st
   }
   for(const auto connection : connections)
     delete connection;
+  m_Trace.SetResult(result.state);
   return result;
 }
 
-UnlockResult UnlockHandler::RunServer(BaseUnlockConnection *connection, UDPUnlockBroadcaster *udpBroadcaster, AtomicUnlockResult *currentResult,
-                                      std::atomic<bool> *isRunning) {
+void UnlockHandler::Cancel() {
+  m_IsCanceled = true;
+  m_StateEvent.Notify();
+}
+
+void UnlockHandler::SetKeepAliveLinks(KeepAliveLinkManager *keepAliveLinks) {
+  m_KeepAliveLinks = keepAliveLinks;
+}
+
+UnlockTrace &UnlockHandler::GetTrace() {
+  return m_Trace;
+}
+
+bool UnlockHandler::IsCanceled(const AtomicUnlockResult *currentResult) const {
+  return m_IsCanceled || currentResult->load().state == UnlockState::SUCCESS;
+}
+
+UnlockResult UnlockHandler::RunServer(BaseUnlockConnection *connection, UDPUnlockBroadcaster *udpBroadcaster, AtomicUnlockResult *currentResult) {
+  if(m_Trace.IsActive())
+    m_Trace.Mark("transport_start", connection->GetDevice().id);
   if(!connection->Start()) {
     auto errorMsg = I18n::Get("error_start_handler");
     spdlog::error(errorMsg);
@@ -128,15 +182,14 @@ UnlockResult UnlockHandler::RunServer(BaseUnlockConnection *connection, UDPUnloc
 
   auto connectMessage = I18n::Get(connection->IsServer() ? "wait_server_phone_connect" : "wait_client_phone_connect");
   m_PrintMessage(connectMessage);
-  auto keyScanner = KeyScanner();
-  keyScanner.Start();
 
   auto state = UnlockState::UNKNOWN;
   auto startTime = Utils::GetCurrentTimeMs();
   auto isWaitingForConnection = true;
   auto isFutureCancel = false;
+  auto generation = m_StateEvent.GetGeneration();
   while(true) {
-    if(currentResult->load().state == UnlockState::SUCCESS || (isRunning != nullptr && !isRunning->load())) {
+    if(IsCanceled(currentResult)) {
       state = UnlockState::CANCELED;
       isFutureCancel = true;
       break;
@@ -152,11 +205,12 @@ UnlockResult UnlockHandler::RunServer(BaseUnlockConnection *connection, UDPUnloc
     state = connection->PollResult();
     if(state != UnlockState::UNKNOWN)
       break;
-    if(!connection->HasClient() && Utils::GetCurrentTimeMs() - startTime > CRYPT_PACKET_TIMEOUT) {
+    auto elapsedTime = Utils::GetCurrentTimeMs() - startTime;
+    if(!connection->HasClient() && elapsedTime > CRYPT_PACKET_TIMEOUT) {
       state = UnlockState::TIMEOUT;
       break;
     }
-    if(keyScanner.GetKeyState(KEY_LEFTCTRL) && keyScanner.GetKeyState(KEY_LEFTALT)) {
+    if(m_IsKeyCanceled) {
       state = UnlockState::CANCELED;
       break;
     }
@@ -168,26 +222,31 @@ UnlockResult UnlockHandler::RunServer(BaseUnlockConnection *connection, UDPUnloc
         udpBroadcaster->Start();
       }
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // A connected client is bounded by the socket timeout, so only the connect timeout needs a wakeup
+    auto waitTime = connection->HasClient() ? CRYPT_PACKET_TIMEOUT : std::max<int64_t>(CRYPT_PACKET_TIMEOUT - elapsedTime, 0) + 1;
+    generation = m_StateEvent.WaitFor(generation, std::chrono::milliseconds(waitTime));
   }
 
   connection->Stop();
-  keyScanner.Stop();
   if(!isFutureCancel)
     m_PrintMessage(UnlockStateUtils::ToString(state));
   spdlog::info("Connection result: {}", UnlockStateUtils::ToString(state));
 
-  auto pwDec = CryptUtils::DecryptAES(connection->GetDevice().passwordEnc, connection->GetResponseData().passwordKey);
-  if(!pwDec.has_value() && state == UnlockState::SUCCESS) {
+  auto result = UnlockResult();
+  result.state = state;
+  result.device = connection->GetDevice();
+  if(state != UnlockState::SUCCESS)
+    return result;
+
+  // Other states carry no key, deriving one would only log crypt errors
+  auto pwDec = CryptUtils::DecryptAES(result.device.passwordEnc, result.device.GetPasswordKey(connection->GetResponseData().passwordKey));
+  if(!pwDec.has_value()) {
     auto errorMsg = I18n::Get("error_password_decrypt");
     spdlog::error(errorMsg);
     m_PrintMessage(errorMsg);
     return UnlockResult(UnlockState::DATA_ERROR);
   }
-
-  auto result = UnlockResult();
-  result.state = state;
-  result.device = connection->GetDevice();
-  result.password = pwDec.has_value() ? pwDec.value() : "";
+  m_Trace.Mark("password_decrypted", result.device.id);
+  result.password = pwDec.value();
   return result;
 }
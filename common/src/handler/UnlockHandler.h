@@ -6,9 +6,12 @@
 #include <string>
 
 #include "UnlockState.h"
+#include "UnlockTrace.h"
 #include "connection/unlock/BaseUnlockConnection.h"
 #include "connection/unlock/UDPUnlockBroadcaster.h"
+#include "connection/unlock/links/KeepAliveLinkManager.h"
 #include "storage/PairedDevicesStorage.h"
+#include "utils/StateEvent.h"
 
 struct UnlockResult {
   UnlockResult() = default;
@@ -40,12 +43,26 @@ private:
 class UnlockHandler {
 public:
   explicit UnlockHandler(const std::function<void(std::string)> &printMessage);
-  UnlockResult GetResult(const std::string &authUser, const std::string &authProgram, std::atomic<bool> *isRunning = nullptr);
+  UnlockResult GetResult(const std::string &authUser, const std::string &authProgram);
+  // Runs the given connections until one succeeds or all have finished, takes ownership of them
+  UnlockResult GetResult(const std::vector<BaseUnlockConnection *> &connections, UDPUnlockBroadcaster *udpBroadcaster = nullptr);
+  // Makes a running or future GetResult call return as canceled, may be called from any thread
+  void Cancel();
+  // TCP devices with a connected link are unlocked over it instead of a new connection
+  void SetKeepAliveLinks(KeepAliveLinkManager *keepAliveLinks);
+  // Phases after GetResult, like checking the password, are added by the caller. Written when the handler is destroyed.
+  UnlockTrace &GetTrace();
 
 private:
-  UnlockResult RunServer(BaseUnlockConnection *connection, UDPUnlockBroadcaster *udpBroadcaster, AtomicUnlockResult *currentResult,
-                         std::atomic<bool> *isRunning);
+  UnlockResult RunServer(BaseUnlockConnection *connection, UDPUnlockBroadcaster *udpBroadcaster, AtomicUnlockResult *currentResult);
+  bool IsCanceled(const AtomicUnlockResult *currentResult) const;
+
   std::function<void(std::string)> m_PrintMessage{};
+  KeepAliveLinkManager *m_KeepAliveLinks{};
+  UnlockTrace m_Trace{};
+  StateEvent m_StateEvent{};
+  std::atomic<bool> m_IsCanceled{};
+  std::atomic<bool> m_IsKeyCanceled{};
 };
 
 #endif // PAM_PCBIOUNLOCK_UNLOCKHANDLER_H
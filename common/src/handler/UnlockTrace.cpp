@@ -0,0 +1,76 @@
+#include "UnlockTrace.h"
+
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "storage/AppSettings.h"
+
+constexpr auto TRACE_ENABLE_FILE_NAME = "TRACE_UNLOCK";
+constexpr auto TRACE_FILE_NAME = "unlock_trace.jsonl";
+constexpr uintmax_t TRACE_FILE_MAX_SIZE = 5000 * 1000;
+
+UnlockTrace::~UnlockTrace() {
+  Write();
+}
+
+void UnlockTrace::Begin(const std::string &authUser, const std::string &authProgram) {
+  Write();
+  std::error_code ec{};
+  if(!std::filesystem::exists(AppSettings::GetBaseDir() / TRACE_ENABLE_FILE_NAME, ec))
+    return;
+
+  std::lock_guard lock(m_Mutex);
+  m_AuthUser = authUser;
+  m_AuthProgram = authProgram;
+  m_Result = UnlockState::UNKNOWN;
+  m_StartTime = std::chrono::system_clock::now();
+  m_Start = std::chrono::steady_clock::now();
+  m_Events.clear();
+  m_Events.reserve(32);
+  m_IsActive = true;
+}
+
+void UnlockTrace::Mark(const char *phase, const std::string &deviceId) {
+  if(!m_IsActive)
+    return;
+  auto time = std::chrono::steady_clock::now();
+  std::lock_guard lock(m_Mutex);
+  m_Events.push_back({phase, deviceId, time});
+}
+
+void UnlockTrace::SetResult(UnlockState state) {
+  if(!m_IsActive)
+    return;
+  auto time = std::chrono::steady_clock::now();
+  std::lock_guard lock(m_Mutex);
+  m_Result = state;
+  m_Events.push_back({"result", {}, time});
+}
+
+void UnlockTrace::Write() {
+  if(!m_IsActive.exchange(false))
+    return;
+
+  std::lock_guard lock(m_Mutex);
+  auto events = nlohmann::json::array();
+  for(const auto &event : m_Events) {
+    auto offsetUs = std::chrono::duration_cast<std::chrono::microseconds>(event.time - m_Start).count();
+    events.push_back({{"phase", event.phase}, {"device", event.deviceId}, {"us", offsetUs}});
+  }
+  auto startMs = std::chrono::duration_cast<std::chrono::milliseconds>(m_StartTime.time_since_epoch()).count();
+  auto json = nlohmann::json{
+      {"startMs", startMs}, {"user", m_AuthUser}, {"program", m_AuthProgram}, {"result", static_cast<int>(m_Result)}, {"events", events}};
+
+  auto tracePath = AppSettings::GetBaseDir() / TRACE_FILE_NAME;
+  std::error_code ec{};
+  auto fileSize = std::filesystem::file_size(tracePath, ec);
+  auto mode = !ec && fileSize > TRACE_FILE_MAX_SIZE ? std::ios::trunc : std::ios::app;
+  std::ofstream traceFile(tracePath, std::ios::out | mode);
+  if(!traceFile) {
+    spdlog::warn("Failed to open unlock trace file.");
+    return;
+  }
+  traceFile << json.dump() << '\n';
+}
@@ -0,0 +1,48 @@
+#ifndef PCBU_DESKTOP_UNLOCKTRACE_H
+#define PCBU_DESKTOP_UNLOCKTRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "UnlockState.h"
+
+struct UnlockTraceEvent {
+  const char *phase;
+  std::string deviceId;
+  std::chrono::steady_clock::time_point time;
+};
+
+// Timestamps of the phases of one authentication. Enabled by creating the file TRACE_UNLOCK in the base directory,
+// every authentication then appends one JSON line to unlock_trace.jsonl. Marks are dropped if it is disabled.
+class UnlockTrace {
+public:
+  UnlockTrace() = default;
+  UnlockTrace(const UnlockTrace &) = delete;
+  UnlockTrace &operator=(const UnlockTrace &) = delete;
+  ~UnlockTrace();
+
+  // Writes the previous trace, if any, and starts a new one
+  void Begin(const std::string &authUser, const std::string &authProgram);
+  void Mark(const char *phase, const std::string &deviceId = {});
+  void SetResult(UnlockState state);
+  void Write();
+
+  [[nodiscard]] bool IsActive() const {
+    return m_IsActive;
+  }
+
+private:
+  std::atomic<bool> m_IsActive{};
+  std::mutex m_Mutex{};
+  std::string m_AuthUser{};
+  std::string m_AuthProgram{};
+  UnlockState m_Result{};
+  std::chrono::system_clock::time_point m_StartTime{};
+  std::chrono::steady_clock::time_point m_Start{};
+  std::vector<UnlockTraceEvent> m_Events{};
+};
+
+#endif // PCBU_DESKTOP_UNLOCKTRACE_H
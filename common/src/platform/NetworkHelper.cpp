@@ -240,9 +240,9 @@ NetworkInterface NetworkHelper::GetSavedNetworkInterface() {
   auto localIfs = NetworkHelper::GetLocalNetInterfaces();
   auto settings = AppSettings::Get();
   auto found = false;
-  if(settings.serverIP == "auto") {
+  if(settings->serverIP == "auto") {
     for(const auto &netIf : localIfs) {
-      if(netIf.macAddress == settings.serverMAC) {
+      if(netIf.macAddress == settings->serverMAC) {
         result = netIf;
         found = true;
         break;
@@ -255,7 +255,7 @@ NetworkInterface NetworkHelper::GetSavedNetworkInterface() {
         spdlog::warn("Invalid server IP settings.");
     }
   } else {
-    result.ipAddress = settings.serverIP;
+    result.ipAddress = settings->serverIP;
   }
   return result;
 }
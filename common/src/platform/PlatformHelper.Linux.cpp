@@ -5,6 +5,7 @@
 #include <optional>
 #include <pwd.h>
 #include <shadow.h>
+#include <sstream>
 #include <unistd.h>
 
 #include "shell/Shell.h"
@@ -87,3 +88,28 @@ bool PlatformHelper::HasNativeLibrary(const std::string &libName) {
          std::filesystem::exists(std::filesystem::path("/usr/lib/x86_64-linux-gnu") / libName) ||
          std::filesystem::exists(std::filesystem::path("/usr/lib/aarch64-linux-gnu") / libName);
 }
+
+static std::string JoinCommandLine(const char *start, const char *end, int skipNum) {
+  auto i = 0;
+  std::ostringstream result{};
+  while(start < end) {
+    std::string_view str(start);
+    if(!str.empty()) {
+      if(i > skipNum)
+        result << " ";
+      if(i > skipNum - 1)
+        result << str;
+      i++;
+    }
+    start += str.size() + 1;
+  }
+  return StringUtils::Truncate(result.str(), 256);
+}
+
+std::string PlatformHelper::GetProcessCommandLine(int pid) {
+  auto cmdline = Shell::ReadBytes(fmt::format("/proc/{}/cmdline", pid));
+  if(cmdline.empty())
+    return {};
+  auto start = reinterpret_cast<const char *>(cmdline.data());
+  return JoinCommandLine(start, start + cmdline.size(), 0);
+}
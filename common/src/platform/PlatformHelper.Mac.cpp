@@ -2,6 +2,8 @@
 
 #include <CoreServices/CoreServices.h>
 #include <SystemConfiguration/SystemConfiguration.h>
+#include <sstream>
+#include <sys/sysctl.h>
 
 #include "shell/Shell.h"
 #include "utils/StringUtils.h"
@@ -68,3 +70,32 @@ PlatformLoginStatus PlatformHelper::CheckLogin(const std::string &userName, cons
 bool PlatformHelper::HasNativeLibrary(const std::string &libName) {
   return false;
 }
+
+static std::string JoinCommandLine(const char *start, const char *end, int skipNum) {
+  auto i = 0;
+  std::ostringstream result{};
+  while(start < end) {
+    std::string_view str(start);
+    if(!str.empty()) {
+      if(i > skipNum)
+        result << " ";
+      if(i > skipNum - 1)
+        result << str;
+      i++;
+    }
+    start += str.size() + 1;
+  }
+  return StringUtils::Truncate(result.str(), 256);
+}
+
+std::string PlatformHelper::GetProcessCommandLine(int pid) {
+  int mib[] = {CTL_KERN, KERN_PROCARGS2, pid};
+  size_t size{};
+  if(sysctl(mib, 3, nullptr, &size, nullptr, 0) == -1)
+    return {};
+  std::vector<char> cmdline(size);
+  if(sysctl(mib, 3, cmdline.data(), &size, nullptr, 0) == -1 || size == 0)
+    return {};
+  // Skips argc and the executable path
+  return JoinCommandLine(cmdline.data(), cmdline.data() + size, 2);
+}
@@ -33,6 +33,11 @@ public:
 
   static PlatformLoginStatus CheckLogin(const std::string &userName, const std::string &password);
 
+#ifndef WINDOWS
+  // Arguments of a process joined by spaces, empty if unavailable
+  static std::string GetProcessCommandLine(int pid);
+#endif
+
 #ifdef WINDOWS
   static bool SetDefaultCredProv(const std::string &userName, const std::string &provId);
 #endif
@@ -11,6 +11,11 @@
 #endif
 #include <fstream>
 #include <spdlog/spdlog.h>
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "utils/StringUtils.h"
 
@@ -165,3 +170,86 @@ bool Shell::WriteBytes(const std::filesystem::path &path, const std::vector<uint
   file.close();
   return !file.fail() && !file.bad();
 }
+
+bool Shell::WriteBytesAtomic(const std::filesystem::path &path, const std::vector<uint8_t> &data, bool isPrivate) {
+  // Renaming over a symlink would replace it, e.g. /etc/pam.d files managed by authselect
+  std::error_code ec{};
+  auto targetPath = std::filesystem::weakly_canonical(path, ec);
+  if(ec)
+    targetPath = path;
+#ifdef WINDOWS
+  // Access rights come from the directory, PairedDevicesStorage protects its file afterwards
+  auto tmpPath = targetPath;
+  tmpPath += fmt::format(".{}.tmp", StringUtils::RandomString(8));
+  auto file = CreateFileW(tmpPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(file == INVALID_HANDLE_VALUE) {
+    spdlog::error("Failed to create file '{}'. (Code={})", tmpPath.string(), GetLastError());
+    return false;
+  }
+  DWORD bytesWritten{};
+  auto isWritten = WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &bytesWritten, nullptr) && bytesWritten == data.size() &&
+                   FlushFileBuffers(file);
+  CloseHandle(file);
+  if(!isWritten || !MoveFileExW(tmpPath.c_str(), targetPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    spdlog::error("Failed to write file '{}'. (Code={})", targetPath.string(), GetLastError());
+    DeleteFileW(tmpPath.c_str());
+    return false;
+  }
+  return true;
+#else
+  auto tmpPath = targetPath.string() + ".XXXXXX";
+  int fd = mkostemp(tmpPath.data(), O_CLOEXEC);
+  if(fd == -1) {
+    spdlog::error("Failed to create file '{}'. (Code={})", tmpPath, errno);
+    return false;
+  }
+
+  struct stat fileStat{};
+  struct stat tmpStat{};
+  auto uid = static_cast<uid_t>(0);
+  auto gid = static_cast<gid_t>(0);
+  mode_t mode = 0600;
+  if(!isPrivate) {
+    mode = 0644;
+    if(fstat(fd, &tmpStat) == 0) {
+      uid = tmpStat.st_uid;
+      gid = tmpStat.st_gid;
+    }
+    if(stat(targetPath.c_str(), &fileStat) == 0) {
+      uid = fileStat.st_uid;
+      gid = fileStat.st_gid;
+      mode = fileStat.st_mode & 07777;
+    }
+  }
+
+  auto isWritten = true;
+  size_t offset{};
+  while(offset < data.size()) {
+    auto count = write(fd, data.data() + offset, data.size() - offset);
+    if(count < 0 && errno == EINTR)
+      continue;
+    if(count <= 0) {
+      isWritten = false;
+      break;
+    }
+    offset += count;
+  }
+  auto error = 0;
+  if(!isWritten || fchown(fd, uid, gid) != 0 || fchmod(fd, mode) != 0 || fsync(fd) != 0)
+    error = errno;
+  close(fd);
+  if(error != 0 || rename(tmpPath.c_str(), targetPath.c_str()) != 0) {
+    spdlog::error("Failed to write file '{}'. (Code={})", targetPath.string(), error != 0 ? error : errno);
+    unlink(tmpPath.c_str());
+    return false;
+  }
+
+  // Makes the rename itself survive a power loss
+  int dirFd = open(targetPath.parent_path().empty() ? "." : targetPath.parent_path().c_str(), O_RDONLY | O_CLOEXEC);
+  if(dirFd != -1) {
+    fsync(dirFd);
+    close(dirFd);
+  }
+  return true;
+#endif
+}
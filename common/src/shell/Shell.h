@@ -27,6 +27,10 @@ public:
 
   static std::vector<uint8_t> ReadBytes(const std::filesystem::path &path);
   static bool WriteBytes(const std::filesystem::path &path, const std::vector<uint8_t> &data);
+  // Writes a temporary file and renames it over the file, so a crash leaves either the old or the new data.
+  // The file keeps its owner and mode, new files get mode 0644. Private files are owned by root with mode 0600.
+  // Symlinks are followed, the file they point to is replaced.
+  static bool WriteBytesAtomic(const std::filesystem::path &path, const std::vector<uint8_t> &data, bool isPrivate = false);
 
 private:
   Shell() = default;
@@ -12,8 +12,12 @@
 #include <spdlog/fmt/xchar.h>
 #endif
 
-PCBUAppStorage AppSettings::g_Cache{};
+AppSettingsPtr AppSettings::g_Snapshot{};
+std::atomic<uint64_t> AppSettings::g_Version{1};
 std::mutex AppSettings::g_Mutex{};
+std::vector<std::pair<int, std::function<void(const AppSettingsPtr &)>>> AppSettings::g_Subscribers{};
+int AppSettings::g_NextSubscriberId{};
+std::mutex AppSettings::g_SubscriberMutex{};
 
 std::filesystem::path AppSettings::GetBaseDir() {
 #ifdef WINDOWS
@@ -26,26 +30,61 @@ std::filesystem::path AppSettings::GetBaseDir() {
 #endif
 }
 
-PCBUAppStorage AppSettings::Get() {
-  std::unique_lock lock(g_Mutex);
-  if(!g_Cache.machineID.empty())
-    return g_Cache;
-  g_Cache = Load();
-  return g_Cache;
+AppSettingsPtr AppSettings::Get() {
+  thread_local AppSettingsPtr t_Snapshot{};
+  thread_local uint64_t t_Version{};
+  if(t_Version == g_Version.load(std::memory_order_acquire))
+    return t_Snapshot;
+
+  auto needsSave = false;
+  {
+    std::lock_guard lock(g_Mutex);
+    if(g_Snapshot == nullptr)
+      g_Snapshot = std::make_shared<const PCBUAppStorage>(Load(needsSave));
+    t_Snapshot = g_Snapshot;
+    t_Version = g_Version.load(std::memory_order_relaxed);
+  }
+  if(needsSave)
+    Save(*t_Snapshot);
+  return t_Snapshot;
 }
 
-PCBUAppStorage AppSettings::Load() {
+PCBUAppStorage AppSettings::Load(bool &needsSave) {
   std::string machineID{};
+  if(auto settings = Read(machineID, needsSave))
+    return settings.value();
+
+  auto def = PCBUAppStorage();
+  def.machineID = machineID.empty() ? StringUtils::RandomString(32) : machineID;
+  def.language = "auto";
+  def.serverIP = "auto";
+  def.pairingDiscoveryPort = 43297;
+  def.pairingServerPort = 43295;
+  def.unlockServerPort = 43296;
+  def.clientSocketTimeout = 120;
+  def.clientConnectTimeout = 5;
+  def.clientConnectRetries = 2;
+
+  def.winUnlockBehavior = "key_press_lock_only";
+  def.winHidePasswordField = false;
+  def.winForceDefaultCredProv = true;
+  def.unixSetPasswordPAM = false;
+  def.unixKeepAliveLinks = false;
+  def.unixAuthGraceSeconds = 0;
+  needsSave = true;
+  return def;
+}
+
+std::optional<PCBUAppStorage> AppSettings::Read(std::string &machineID, bool &needsSave) {
   try {
     auto jsonData = Shell::ReadBytes(GetBaseDir() / SETTINGS_FILE_NAME);
     auto json = nlohmann::json::parse(jsonData);
     auto settings = PCBUAppStorage();
-    bool save = false;
     try {
       machineID = json["machineID"];
     } catch(...) {
       machineID = StringUtils::RandomString(32);
-      save = true;
+      needsSave = true;
     }
     settings.machineID = machineID;
     settings.installedVersion = json["installedVersion"];
@@ -63,37 +102,17 @@ PCBUAppStorage AppSettings::Load() {
     settings.winHidePasswordField = json["winHidePasswordField"];
     settings.winForceDefaultCredProv = json.value("winForceDefaultCredProv", true);
     settings.unixSetPasswordPAM = json["unixSetPasswordPAM"];
-    if(save) {
-      g_Mutex.unlock();
-      Save(settings);
-      g_Mutex.lock();
-    }
+    settings.unixKeepAliveLinks = json.value("unixKeepAliveLinks", false);
+    settings.unixAuthGraceSeconds = json.value("unixAuthGraceSeconds", 0);
     return settings;
   } catch(const std::exception &ex) {
     spdlog::error("Failed reading app storage: {}", ex.what());
-    auto def = PCBUAppStorage();
-    def.machineID = machineID.empty() ? StringUtils::RandomString(32) : machineID;
-    def.language = "auto";
-    def.serverIP = "auto";
-    def.pairingDiscoveryPort = 43297;
-    def.pairingServerPort = 43295;
-    def.unlockServerPort = 43296;
-    def.clientSocketTimeout = 120;
-    def.clientConnectTimeout = 5;
-    def.clientConnectRetries = 2;
-
-    def.winUnlockBehavior = "key_press_lock_only";
-    def.winHidePasswordField = false;
-    def.winForceDefaultCredProv = true;
-    def.unixSetPasswordPAM = false;
-    g_Mutex.unlock();
-    Save(def);
-    g_Mutex.lock();
-    return def;
+    return {};
   }
 }
 
 void AppSettings::Save(const PCBUAppStorage &storage) {
+  AppSettingsPtr snapshot{};
   std::unique_lock lock(g_Mutex);
   try {
     nlohmann::json json = {
@@ -113,25 +132,81 @@ void AppSettings::Save(const PCBUAppStorage &storage) {
         {"winHidePasswordField", storage.winHidePasswordField},
         {"winForceDefaultCredProv", storage.winForceDefaultCredProv},
         {"unixSetPasswordPAM", storage.unixSetPasswordPAM},
+        {"unixKeepAliveLinks", storage.unixKeepAliveLinks},
+        {"unixAuthGraceSeconds", storage.unixAuthGraceSeconds},
     };
     auto baseDir = GetBaseDir();
     if(!std::filesystem::exists(baseDir))
       Shell::CreateDir(baseDir);
     auto jsonStr = json.dump();
-    Shell::WriteBytes(baseDir / SETTINGS_FILE_NAME, {jsonStr.begin(), jsonStr.end()});
-    g_Cache = storage;
+    if(!Shell::WriteBytesAtomic(baseDir / SETTINGS_FILE_NAME, {jsonStr.begin(), jsonStr.end()}))
+      throw std::runtime_error(fmt::format("Error writing file '{}'.", (baseDir / SETTINGS_FILE_NAME).string()));
+    snapshot = std::make_shared<const PCBUAppStorage>(storage);
+    g_Snapshot = snapshot;
+    g_Version.fetch_add(1, std::memory_order_release);
   } catch(const std::exception &ex) {
     spdlog::error("Failed writing app storage: {}", ex.what());
+    return;
   }
+  lock.unlock();
+  Notify(snapshot);
 }
 
 void AppSettings::InvalidateCache() {
   std::unique_lock lock(g_Mutex);
-  g_Cache = {};
+  g_Snapshot = nullptr;
+  g_Version.fetch_add(1, std::memory_order_release);
+}
+
+void AppSettings::Reload() {
+  std::string machineID{};
+  auto needsSave = false;
+  auto settings = Read(machineID, needsSave);
+  if(!settings.has_value()) {
+    spdlog::warn("Keeping current app settings.");
+    return;
+  }
+  if(needsSave) {
+    Save(settings.value());
+    return;
+  }
+
+  AppSettingsPtr snapshot{};
+  {
+    std::lock_guard lock(g_Mutex);
+    // Our own saves are reported by the watcher as well
+    if(g_Snapshot != nullptr && *g_Snapshot == settings.value())
+      return;
+    snapshot = std::make_shared<const PCBUAppStorage>(std::move(settings.value()));
+    g_Snapshot = snapshot;
+    g_Version.fetch_add(1, std::memory_order_release);
+  }
+  spdlog::info("Reloaded app settings.");
+  Notify(snapshot);
+}
+
+int AppSettings::Subscribe(const std::function<void(const AppSettingsPtr &)> &callback) {
+  std::lock_guard lock(g_SubscriberMutex);
+  auto id = g_NextSubscriberId++;
+  g_Subscribers.emplace_back(id, callback);
+  return id;
+}
+
+void AppSettings::Unsubscribe(int id) {
+  std::lock_guard lock(g_SubscriberMutex);
+  std::erase_if(g_Subscribers, [id](const auto &subscriber) { return subscriber.first == id; });
+}
+
+void AppSettings::Notify(const AppSettingsPtr &snapshot) {
+  // Callbacks may call Get(), so they run without holding g_Mutex. Holding the subscriber mutex
+  // makes sure no callback runs anymore after Unsubscribe().
+  std::lock_guard lock(g_SubscriberMutex);
+  for(const auto &subscriber : g_Subscribers)
+    subscriber.second(snapshot);
 }
 
 void AppSettings::SetInstalledVersion(bool isInstalled) {
-  auto settings = Get();
+  auto settings = *Get();
   settings.installedVersion = isInstalled ? AppInfo::GetVersion() : "";
   Save(settings);
   InvalidateCache();
@@ -1,9 +1,13 @@
 #ifndef PCBU_DESKTOP_APPSTORAGE_H
 #define PCBU_DESKTOP_APPSTORAGE_H
 
+#include <atomic>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -24,25 +28,47 @@ struct PCBUAppStorage {
   bool winHidePasswordField{};
   bool winForceDefaultCredProv{};
   bool unixSetPasswordPAM{};
+  bool unixKeepAliveLinks{};
+  uint32_t unixAuthGraceSeconds{};
+
+  bool operator==(const PCBUAppStorage &) const = default;
 };
 
+using AppSettingsPtr = std::shared_ptr<const PCBUAppStorage>;
+
+// Settings are published as immutable snapshots. Get() only takes the mutex on the first call of a thread
+// after a change, otherwise it returns the snapshot the thread already holds.
 class AppSettings {
 public:
   static std::filesystem::path GetBaseDir();
 
-  static PCBUAppStorage Get();
+  static AppSettingsPtr Get();
   static void Save(const PCBUAppStorage &storage);
 
   static void InvalidateCache();
+  // Reads the file again and publishes it if it changed. An invalid file keeps the current settings.
+  static void Reload();
   static void SetInstalledVersion(bool isInstalled);
 
+  // Called with the new snapshot after settings were saved or reloaded. Returns an ID for Unsubscribe().
+  // Callbacks must not subscribe, unsubscribe or save settings themselves.
+  static int Subscribe(const std::function<void(const AppSettingsPtr &)> &callback);
+  // The callback is not called anymore once this returns
+  static void Unsubscribe(int id);
+
+  static constexpr std::string_view SETTINGS_FILE_NAME = "app_settings.json";
+
 private:
-  static PCBUAppStorage Load();
+  static PCBUAppStorage Load(bool &needsSave);
+  static std::optional<PCBUAppStorage> Read(std::string &machineID, bool &needsSave);
+  static void Notify(const AppSettingsPtr &snapshot);
 
-  static PCBUAppStorage g_Cache;
+  static AppSettingsPtr g_Snapshot;
+  static std::atomic<uint64_t> g_Version;
   static std::mutex g_Mutex;
-
-  static constexpr std::string_view SETTINGS_FILE_NAME = "app_settings.json";
+  static std::vector<std::pair<int, std::function<void(const AppSettingsPtr &)>>> g_Subscribers;
+  static int g_NextSubscriberId;
+  static std::mutex g_SubscriberMutex;
 };
 
 #endif // PCBU_DESKTOP_APPSTORAGE_H
@@ -0,0 +1,65 @@
+#include "BTChannelCache.h"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "AppSettings.h"
+#include "shell/Shell.h"
+
+std::mutex BTChannelCache::g_Mutex{};
+
+int BTChannelCache::Get(const std::string &deviceAddress) {
+  std::lock_guard lock(g_Mutex);
+  auto filePath = AppSettings::GetBaseDir() / CACHE_FILE_NAME;
+  if(!std::filesystem::exists(filePath))
+    return -1;
+  try {
+    auto jsonData = Shell::ReadBytes(filePath);
+    auto json = nlohmann::json::parse(jsonData);
+    return json.value(deviceAddress, -1);
+  } catch(const std::exception &ex) {
+    spdlog::warn("Failed reading Bluetooth channel cache: {}", ex.what());
+  }
+  return -1;
+}
+
+void BTChannelCache::Set(const std::string &deviceAddress, int channel) {
+  Update(deviceAddress, channel);
+}
+
+void BTChannelCache::Remove(const std::string &deviceAddress) {
+  Update(deviceAddress, -1);
+}
+
+void BTChannelCache::Update(const std::string &deviceAddress, int channel) {
+  std::lock_guard lock(g_Mutex);
+  try {
+    auto baseDir = AppSettings::GetBaseDir();
+    auto filePath = baseDir / CACHE_FILE_NAME;
+    auto json = nlohmann::json::object();
+    if(std::filesystem::exists(filePath)) {
+      try {
+        auto jsonData = Shell::ReadBytes(filePath);
+        json = nlohmann::json::parse(jsonData);
+      } catch(...) {
+        json = nlohmann::json::object();
+      }
+    }
+    if(channel == -1) {
+      if(!json.contains(deviceAddress))
+        return;
+      json.erase(deviceAddress);
+    } else {
+      if(json.value(deviceAddress, -1) == channel)
+        return;
+      json[deviceAddress] = channel;
+    }
+
+    if(!std::filesystem::exists(baseDir))
+      Shell::CreateDir(baseDir);
+    auto jsonStr = json.dump();
+    Shell::WriteBytesAtomic(filePath, {jsonStr.begin(), jsonStr.end()});
+  } catch(const std::exception &ex) {
+    spdlog::error("Failed writing Bluetooth channel cache: {}", ex.what());
+  }
+}
@@ -0,0 +1,26 @@
+#ifndef PCBU_DESKTOP_BTCHANNELCACHE_H
+#define PCBU_DESKTOP_BTCHANNELCACHE_H
+
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// RFCOMM channels found via SDP, by Bluetooth address. Phones keep their channel across unlocks, so a cached
+// channel saves the SDP search. Callers remove it when connecting to it fails.
+class BTChannelCache {
+public:
+  // -1 if the address has no cached channel
+  static int Get(const std::string &deviceAddress);
+  static void Set(const std::string &deviceAddress, int channel);
+  static void Remove(const std::string &deviceAddress);
+
+private:
+  BTChannelCache() = default;
+  static void Update(const std::string &deviceAddress, int channel);
+
+  static std::mutex g_Mutex;
+
+  static constexpr std::string_view CACHE_FILE_NAME = "bt_channels.json";
+};
+
+#endif // PCBU_DESKTOP_BTCHANNELCACHE_H
@@ -1,48 +1,39 @@
 #include "LoggingSystem.h"
 
-#include <fstream>
+#include <spdlog/async_logger.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_sinks.h>
 
 #include "AppSettings.h"
-#include "shell/Shell.h"
 
 std::string LoggingSystem::g_LogName{};
 
-void LoggingSystem::Init(const std::string &logName, bool printToConsole) {
-  g_LogName = logName;
-  auto logPath = AppSettings::GetBaseDir() / fmt::format("{}.log", g_LogName);
-  std::ifstream logFile(logPath, std::ifstream::ate | std::ifstream::binary);
-  if(logFile) {
-    auto sizeKb = logFile.tellg() / 1000;
-    if(sizeKb > 5000)
-      Shell::RemoveFile(logPath);
+static void RotateSharedLog(const std::filesystem::path &logPath) {
+  std::error_code ec{};
+  auto size = std::filesystem::file_size(logPath, ec);
+  if(ec || size < LoggingSystem::MAX_LOG_SIZE)
+    return;
+  // Same names as rotating_file_sink, a process starting at the same time may rotate once more
+  auto fileName = logPath.string();
+  for(auto i = LoggingSystem::MAX_LOG_FILES; i > 0; i--) {
+    auto srcName = i == 1 ? fileName : spdlog::sinks::rotating_file_sink_mt::calc_filename(fileName, i - 1);
+    std::filesystem::rename(srcName, spdlog::sinks::rotating_file_sink_mt::calc_filename(fileName, i), ec);
   }
+}
 
+void LoggingSystem::Init(const std::string &logName, const LoggingOptions &options) {
+  g_LogName = logName;
+  auto logPath = AppSettings::GetBaseDir() / fmt::format("{}.log", g_LogName);
   try {
-    auto enableDebug = std::filesystem::exists(AppSettings::GetBaseDir() / "LOG_DEBUG");
-    auto fileSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(logPath.string(), false);
-    fileSink->set_level(enableDebug ? spdlog::level::debug : spdlog::level::info);
-
-    std::shared_ptr<spdlog::logger> loggerPtr{};
-    if(printToConsole) {
-      auto consoleSink = std::make_shared<spdlog::sinks::stdout_sink_mt>();
-      consoleSink->set_level(enableDebug ? spdlog::level::debug : spdlog::level::info);
-      auto logger = spdlog::logger("pcbu_logger", {consoleSink, fileSink});
-      loggerPtr = std::make_shared<spdlog::logger>(logger);
-    } else {
-      auto logger = spdlog::logger("pcbu_logger", {fileSink});
-      loggerPtr = std::make_shared<spdlog::logger>(logger);
-    }
-
-    loggerPtr->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] %v");
-    loggerPtr->set_level(spdlog::level::debug);
-    spdlog::set_default_logger(loggerPtr);
+    spdlog::set_default_logger(CreateLogger(logPath, options));
+    // Errors are written right away, everything else at least every flushInterval
 #ifdef _DEBUG
     spdlog::flush_on(spdlog::level::debug);
 #else
-    spdlog::flush_on(spdlog::level::info);
+    spdlog::flush_on(spdlog::level::err);
 #endif
+    spdlog::flush_every(options.flushInterval);
 
     spdlog::info("Logger init.");
   } catch(const std::exception &ex) {
@@ -52,6 +43,35 @@ void LoggingSystem::Init(const std::string &logName, bool printToConsole) {
 
 void LoggingSystem::Destroy() {
   spdlog::info("Logger destroy.");
+  // Writes the queued lines before the thread pool is stopped
   spdlog::shutdown();
   g_LogName = {};
 }
+
+std::shared_ptr<spdlog::logger> LoggingSystem::CreateLogger(const std::filesystem::path &logPath, const LoggingOptions &options) {
+  auto enableDebug = std::filesystem::exists(AppSettings::GetBaseDir() / "LOG_DEBUG");
+  spdlog::sink_ptr fileSink{};
+  if(options.isShared) {
+    RotateSharedLog(logPath);
+    fileSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(logPath.string());
+  } else {
+    fileSink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(logPath.string(), MAX_LOG_SIZE, MAX_LOG_FILES);
+  }
+  fileSink->set_level(enableDebug ? spdlog::level::debug : spdlog::level::info);
+  std::vector<spdlog::sink_ptr> sinks{fileSink};
+  if(options.printToConsole) {
+    auto consoleSink = std::make_shared<spdlog::sinks::stdout_sink_mt>();
+    consoleSink->set_level(enableDebug ? spdlog::level::debug : spdlog::level::info);
+    sinks.insert(sinks.begin(), consoleSink);
+  }
+
+  auto threadPool = spdlog::thread_pool();
+  if(threadPool == nullptr) {
+    spdlog::init_thread_pool(options.queueSize, 1);
+    threadPool = spdlog::thread_pool();
+  }
+  auto logger = std::make_shared<spdlog::async_logger>("pcbu_logger", sinks.begin(), sinks.end(), threadPool, options.overflowPolicy);
+  logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] %v");
+  logger->set_level(enableDebug ? spdlog::level::debug : spdlog::level::info);
+  return logger;
+}
@@ -1,13 +1,37 @@
 #ifndef PCBU_DESKTOP_LOGGINGSYSTEM_H
 #define PCBU_DESKTOP_LOGGINGSYSTEM_H
 
+#include <chrono>
+#include <filesystem>
+#include <spdlog/async.h>
 #include <spdlog/spdlog.h>
 
+struct LoggingOptions {
+  bool printToConsole = true;
+  // Other processes append to the same file, see LoggingSystem
+  bool isShared = false;
+  size_t queueSize = 8192;
+  // block waits for the writer, overrun_oldest and discard_new drop lines instead
+  spdlog::async_overflow_policy overflowPolicy = spdlog::async_overflow_policy::block;
+  std::chrono::seconds flushInterval = std::chrono::seconds(1);
+};
+
+// Log lines are queued and written by a background thread, so logging does not block the unlock path on disk I/O.
+// Files are rotated by size and keep the previous MAX_LOG_FILES files as <name>.1.log, <name>.2.log, ...
+// Each rotating sink tracks the size on its own, so a shared file is only appended to and rotated when a process
+// opens it. It can grow past MAX_LOG_SIZE while processes keep it open, and on Windows the rename fails until none do.
 class LoggingSystem {
 public:
-  static void Init(const std::string &logName, bool printToConsole = true);
+  static void Init(const std::string &logName, const LoggingOptions &options = {});
   static void Destroy();
 
+  // The logger Init() installs, without making it the default. The thread pool is shared by all
+  // loggers and sized by the first one.
+  static std::shared_ptr<spdlog::logger> CreateLogger(const std::filesystem::path &logPath, const LoggingOptions &options);
+
+  static constexpr size_t MAX_LOG_SIZE = 5 * 1000 * 1000;
+  static constexpr size_t MAX_LOG_FILES = 2;
+
 private:
   LoggingSystem() = default;
   static std::string g_LogName;
@@ -6,44 +6,57 @@
 
 #include "AppSettings.h"
 #include "shell/Shell.h"
+#include "utils/AppInfo.h"
 #include "utils/StringUtils.h"
 
 #ifdef WINDOWS
 #include <Windows.h>
 #include <aclapi.h>
 #include <sddl.h>
-#elif APPLE
-#define CHOWN_USER "root"
-#elif LINUX
-#define CHOWN_USER "root:root"
 #endif
 
-std::optional<PairedDevice> PairedDevicesStorage::GetDeviceByID(const std::string &id) {
-  for(const auto &device : GetDevices())
-    if(device.id == id)
-      return device;
-  return {};
+std::shared_ptr<const PairedDevicesStorage::DevicesCache> PairedDevicesStorage::g_Cache{};
+std::shared_ptr<const PairedDevicesStorage::DevicesCache> PairedDevicesStorage::g_NotifiedCache{};
+std::mutex PairedDevicesStorage::g_Mutex{};
+std::vector<std::pair<int, std::function<void(const std::vector<PairedDevicePtr> &)>>> PairedDevicesStorage::g_Subscribers{};
+int PairedDevicesStorage::g_NextSubscriberId{};
+std::mutex PairedDevicesStorage::g_SubscriberMutex{};
+
+CryptKey PairedDevice::GetPacketKey() const {
+  if(derivedKey.empty())
+    return {encryptionKey};
+  auto key = StringUtils::FromHexString(derivedKey);
+  return {{key.begin(), key.end()}, KeyDerivation::HKDF};
 }
 
-std::vector<PairedDevice> PairedDevicesStorage::GetDevicesForUser(const std::string &userName) {
-  std::vector<PairedDevice> result{};
+CryptKey PairedDevice::GetPasswordKey(const std::string &passwordKey) const {
+  // passwordKey is random, so it only needs stretching for devices paired before derived keys
+  return {passwordKey, derivedKey.empty() ? KeyDerivation::PBKDF2 : KeyDerivation::HKDF};
+}
+
+bool PairedDevice::SupportsUnlockProtocol(const std::string &version) const {
+  return !unlockProtoVersion.empty() && AppInfo::CompareVersion(version, unlockProtoVersion) >= 0;
+}
+
+PairedDevicePtr PairedDevicesStorage::GetDeviceByID(const std::string &id) {
+  auto cache = GetCache();
+  auto it = cache->devicesById.find(id);
+  return it != cache->devicesById.end() ? it->second : nullptr;
+}
+
+std::vector<PairedDevicePtr> PairedDevicesStorage::GetDevicesForUser(const std::string &userName) {
+  auto cache = GetCache();
+  std::vector<PairedDevicePtr> result{};
+  if(auto it = cache->devicesByUser.find(NormalizeUserName(userName)); it != cache->devicesByUser.end())
+    result = it->second;
 #ifdef WINDOWS
-  auto userNameLower = StringUtils::ToLower(userName);
-  std::string principalName{};
+  // Microsoft accounts may be paired with their principal name
   auto userSplit = StringUtils::Split(userName, "\\");
-  if(userSplit.size() == 2 && userSplit[1].find('@') != std::string::npos)
-    principalName = StringUtils::ToLower(userSplit[1]);
-#endif
-  for(const auto &device : GetDevices()) {
-#ifdef WINDOWS
-    auto deviceUserName = StringUtils::ToLower(device.userName);
-    if(deviceUserName == userNameLower || (!principalName.empty() && deviceUserName == principalName))
-      result.emplace_back(device);
-#else
-    if(device.userName == userName)
-      result.emplace_back(device);
-#endif
+  if(userSplit.size() == 2 && userSplit[1].find('@') != std::string::npos) {
+    if(auto it = cache->devicesByUser.find(NormalizeUserName(userSplit[1])); it != cache->devicesByUser.end())
+      result.insert(result.end(), it->second.begin(), it->second.end());
   }
+#endif
   return result;
 }
 
@@ -63,9 +76,91 @@ void PairedDevicesStorage::RemoveDevice(const std::string &id) {
 }
 
 std::vector<PairedDevice> PairedDevicesStorage::GetDevices() {
+  auto cache = GetCache();
   std::vector<PairedDevice> result{};
+  result.reserve(cache->devices.size());
+  for(const auto &device : cache->devices)
+    result.emplace_back(*device);
+  return result;
+}
+
+void PairedDevicesStorage::InvalidateCache() {
+  std::lock_guard lock(g_Mutex);
+  g_Cache.reset();
+}
+
+void PairedDevicesStorage::Reload() {
+  auto cache = ReadCache();
+  if(cache == nullptr) {
+    spdlog::warn("Keeping current paired devices.");
+    return;
+  }
+  // Our own saves are reported by the watcher as well. A reader may have installed the changed
+  // file already, so it is compared against what subscribers saw last instead of g_Cache.
+  {
+    std::lock_guard lock(g_Mutex);
+    if(cache == g_NotifiedCache)
+      return;
+    g_NotifiedCache = cache;
+  }
+  spdlog::info("Reloaded paired devices.");
+  Notify(cache->devices);
+}
+
+int PairedDevicesStorage::Subscribe(const std::function<void(const std::vector<PairedDevicePtr> &)> &callback) {
+  std::lock_guard lock(g_SubscriberMutex);
+  auto id = g_NextSubscriberId++;
+  g_Subscribers.emplace_back(id, callback);
+  return id;
+}
+
+void PairedDevicesStorage::Unsubscribe(int id) {
+  std::lock_guard lock(g_SubscriberMutex);
+  std::erase_if(g_Subscribers, [id](const auto &subscriber) { return subscriber.first == id; });
+}
+
+void PairedDevicesStorage::Notify(const std::vector<PairedDevicePtr> &devices) {
+  std::lock_guard lock(g_SubscriberMutex);
+  for(const auto &subscriber : g_Subscribers)
+    subscriber.second(devices);
+}
+
+std::shared_ptr<const PairedDevicesStorage::DevicesCache> PairedDevicesStorage::GetCache() {
+  if(auto cache = ReadCache()) {
+    // The first read is what subscribers start from
+    std::lock_guard lock(g_Mutex);
+    if(g_NotifiedCache == nullptr)
+      g_NotifiedCache = cache;
+    return cache;
+  }
+  // An invalid or unreadable file is left alone, so it can still be fixed by hand
+  std::error_code ec{};
+  if(!std::filesystem::exists(AppSettings::GetBaseDir() / DEVICES_FILE_NAME, ec) && !ec) {
+    spdlog::info("Creating new devices storage...");
+    SaveDevices({});
+  } else {
+    std::lock_guard lock(g_Mutex);
+    if(g_Cache != nullptr)
+      return g_Cache;
+  }
+  return std::make_shared<const DevicesCache>();
+}
+
+std::shared_ptr<const PairedDevicesStorage::DevicesCache> PairedDevicesStorage::ReadCache() {
+  // Only the file's metadata is read while it is unchanged. If it cannot be read, e.g. while the file
+  // is protected on Windows, the file is read on every call like before the cache.
+  auto filePath = AppSettings::GetBaseDir() / DEVICES_FILE_NAME;
+  std::error_code ec{};
+  auto writeTime = std::filesystem::last_write_time(filePath, ec);
+  auto fileSize = ec ? 0 : std::filesystem::file_size(filePath, ec);
+  {
+    std::lock_guard lock(g_Mutex);
+    if(g_Cache != nullptr && !ec && g_Cache->writeTime == writeTime && g_Cache->fileSize == fileSize)
+      return g_Cache;
+  }
+
+  std::vector<PairedDevicePtr> devices{};
   try {
-    auto filePath = AppSettings::GetBaseDir() / DEVICES_FILE_NAME;
 #ifdef WINDOWS
     ProtectFile(filePath.string(), false);
 #endif
@@ -82,6 +177,8 @@ std::vector<PairedDevice> PairedDevicesStorage::GetDevices() {
       device.userName = entry["userName"];
       device.passwordEnc = entry["passwordEnc"];
       device.encryptionKey = entry["encryptionKey"];
+      device.unlockProtoVersion = entry.value("unlockProtoVersion", "");
+      device.derivedKey = entry.value("derivedKey", "");
 
       device.ipAddress = entry["ipAddress"];
       device.bluetoothAddress = entry["bluetoothAddress"];
@@ -89,14 +186,41 @@ std::vector<PairedDevice> PairedDevicesStorage::GetDevices() {
       device.tcpPort = entry["tcpPort"];
       device.udpPort = entry["udpPort"];
       device.udpManualPort = entry["udpManualPort"];
-      result.emplace_back(device);
+      devices.emplace_back(std::make_shared<const PairedDevice>(std::move(device)));
     }
   } catch(const std::exception &ex) {
     spdlog::error("Failed reading paired devices storage: {}", ex.what());
-    spdlog::info("Creating new devices storage...");
-    SaveDevices({});
+    return nullptr;
   }
-  return result;
+
+  // Uses the metadata from before reading, so a write in between is picked up by the next call
+  auto cache = CreateCache(std::move(devices), writeTime, fileSize);
+  if(!ec) {
+    std::lock_guard lock(g_Mutex);
+    g_Cache = cache;
+  }
+  return cache;
+}
+
+std::shared_ptr<const PairedDevicesStorage::DevicesCache> PairedDevicesStorage::CreateCache(std::vector<PairedDevicePtr> devices,
+                                                                                           std::filesystem::file_time_type writeTime, uintmax_t fileSize) {
+  auto cache = std::make_shared<DevicesCache>();
+  for(const auto &device : devices) {
+    cache->devicesById.emplace(device->id, device);
+    cache->devicesByUser[NormalizeUserName(device->userName)].emplace_back(device);
+  }
+  cache->devices = std::move(devices);
+  cache->writeTime = writeTime;
+  cache->fileSize = fileSize;
+  return cache;
+}
+
+std::string PairedDevicesStorage::NormalizeUserName(const std::string &userName) {
+#ifdef WINDOWS
+  return StringUtils::ToLower(userName);
+#else
+  return userName;
+#endif
 }
 
 void PairedDevicesStorage::SaveDevices(const std::vector<PairedDevice> &devices) {
@@ -110,6 +234,8 @@ void PairedDevicesStorage::SaveDevices(const std::vector<PairedDevice> &devices)
                                    {"userName", device.userName},
                                    {"passwordEnc", device.passwordEnc},
                                    {"encryptionKey", device.encryptionKey},
+                                   {"unlockProtoVersion", device.unlockProtoVersion},
+                                   {"derivedKey", device.derivedKey},
 
                                    {"ipAddress", device.ipAddress},
                                    {"tcpPort", device.tcpPort},
@@ -123,19 +249,38 @@ void PairedDevicesStorage::SaveDevices(const std::vector<PairedDevice> &devices)
     if(!std::filesystem::exists(baseDir))
       Shell::CreateDir(baseDir);
     auto filePath = baseDir / DEVICES_FILE_NAME;
+#ifdef WINDOWS
     ProtectFile(filePath.string(), false);
+#endif
     auto jsonStr = devicesJson.dump();
-    Shell::WriteBytes(filePath, {jsonStr.begin(), jsonStr.end()});
+    auto isWritten = Shell::WriteBytesAtomic(filePath, {jsonStr.begin(), jsonStr.end()}, true);
+#ifdef WINDOWS
     ProtectFile(filePath.string(), true);
+#endif
+    if(!isWritten)
+      throw std::runtime_error(fmt::format("Error writing file '{}'.", filePath.string()));
+
+    std::vector<PairedDevicePtr> cachedDevices{};
+    for(const auto &device : devices)
+      cachedDevices.emplace_back(std::make_shared<const PairedDevice>(device));
+    std::error_code ec{};
+    auto writeTime = std::filesystem::last_write_time(filePath, ec);
+    auto fileSize = ec ? 0 : std::filesystem::file_size(filePath, ec);
+    {
+      std::lock_guard lock(g_Mutex);
+      g_Cache = ec ? nullptr : CreateCache(cachedDevices, writeTime, fileSize);
+      g_NotifiedCache = g_Cache;
+    }
+    Notify(cachedDevices);
   } catch(const std::exception &ex) {
     spdlog::error("Failed writing paired devices storage: {}", ex.what());
   }
 }
 
+#ifdef WINDOWS
 void PairedDevicesStorage::ProtectFile(const std::string &filePath, bool protect) {
   if(!std::filesystem::exists(filePath))
     return;
-#ifdef WINDOWS
   PSID pSystemSid = nullptr;
   BOOL bIsSystem = FALSE;
   if(!ConvertStringSidToSidW(L"S-1-5-18", &pSystemSid)) {
@@ -153,16 +298,8 @@ void PairedDevicesStorage::ProtectFile(const std::string &filePath, bool protect
     else
       throw std::runtime_error(errorStr);
   }
-#elif defined(APPLE) || defined(LINUX)
-  if(protect) {
-    auto cmd = Shell::RunCommand(fmt::format(R"(chown {0} "{1}" && chmod 600 "{1}")", CHOWN_USER, filePath));
-    if(cmd.exitCode != 0)
-      throw std::runtime_error(fmt::format("Error setting file permissions. (Code={})", cmd.exitCode));
-  }
-#endif
 }
 
-#ifdef WINDOWS
 bool PairedDevicesStorage::ModifyFileAccess(const std::string &filePath, const std::string &sid, bool deny) {
   PSID pSid{};
   if(!ConvertStringSidToSidW(StringUtils::ToWideString(sid).c_str(), &pSid)) {
@@ -2,11 +2,16 @@
 #define PCBU_DESKTOP_PAIREDDEVICESSTORAGE_H
 
 #include <cstdint>
-#include <optional>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "PairingMethod.h"
+#include "utils/CryptUtils.h"
 
 struct PairedDevice {
   std::string id{};
@@ -15,6 +20,12 @@ struct PairedDevice {
   std::string userName{};
   std::string passwordEnc{};
   std::string encryptionKey{};
+  std::string unlockProtoVersion{}; // Empty if paired with the legacy unlock protocol
+  std::string derivedKey{};         // CryptUtils::DeriveDeviceKey() of encryptionKey
+
+  [[nodiscard]] CryptKey GetPacketKey() const;
+  [[nodiscard]] CryptKey GetPasswordKey(const std::string &passwordKey) const;
+  [[nodiscard]] bool SupportsUnlockProtocol(const std::string &version) const;
 
   std::string ipAddress{};
   uint16_t tcpPort{};
@@ -24,10 +35,14 @@ struct PairedDevice {
   std::string cloudToken{};
 };
 
+using PairedDevicePtr = std::shared_ptr<const PairedDevice>;
+
+// Devices are cached per process and only read again when the file has changed.
 class PairedDevicesStorage {
 public:
-  static std::optional<PairedDevice> GetDeviceByID(const std::string &id);
-  static std::vector<PairedDevice> GetDevicesForUser(const std::string &userName);
+  // nullptr if no device has the ID
+  static PairedDevicePtr GetDeviceByID(const std::string &id);
+  static std::vector<PairedDevicePtr> GetDevicesForUser(const std::string &userName);
 
   static void AddDevice(const PairedDevice &device);
   static void RemoveDevice(const std::string &id);
@@ -35,13 +50,45 @@ public:
   static std::vector<PairedDevice> GetDevices();
   static void SaveDevices(const std::vector<PairedDevice> &devices);
 
+  static void InvalidateCache();
+  // Reads the file again and publishes it if it changed. An invalid file keeps the current devices.
+  static void Reload();
+
+  // Called with all devices after they were saved or reloaded. Returns an ID for Unsubscribe().
+  // Callbacks must not subscribe, unsubscribe or save devices themselves.
+  static int Subscribe(const std::function<void(const std::vector<PairedDevicePtr> &)> &callback);
+  // The callback is not called anymore once this returns
+  static void Unsubscribe(int id);
+
+  static constexpr std::string_view DEVICES_FILE_NAME = "paired_devices.json";
+
 private:
-  static void ProtectFile(const std::string &filePath, bool protect);
+  struct DevicesCache {
+    std::vector<PairedDevicePtr> devices{};
+    std::unordered_map<std::string, PairedDevicePtr> devicesById{};
+    std::unordered_map<std::string, std::vector<PairedDevicePtr>> devicesByUser{}; // By NormalizeUserName()
+    std::filesystem::file_time_type writeTime{};
+    uintmax_t fileSize{};
+  };
+
+  static std::shared_ptr<const DevicesCache> GetCache();
+  // nullptr if the file is invalid
+  static std::shared_ptr<const DevicesCache> ReadCache();
+  static std::shared_ptr<const DevicesCache> CreateCache(std::vector<PairedDevicePtr> devices, std::filesystem::file_time_type writeTime,
+                                                         uintmax_t fileSize);
+  static std::string NormalizeUserName(const std::string &userName);
+  static void Notify(const std::vector<PairedDevicePtr> &devices);
 #ifdef WINDOWS
+  static void ProtectFile(const std::string &filePath, bool protect);
   static bool ModifyFileAccess(const std::string &filePath, const std::string &sid, bool deny);
 #endif
 
-  static constexpr std::string_view DEVICES_FILE_NAME = "paired_devices.json";
+  static std::shared_ptr<const DevicesCache> g_Cache;
+  static std::shared_ptr<const DevicesCache> g_NotifiedCache; // Last devices passed to Notify()
+  static std::mutex g_Mutex;
+  static std::vector<std::pair<int, std::function<void(const std::vector<PairedDevicePtr> &)>>> g_Subscribers;
+  static int g_NextSubscriberId;
+  static std::mutex g_SubscriberMutex;
 };
 
 #endif // PCBU_DESKTOP_PAIREDDEVICESSTORAGE_H
@@ -0,0 +1,148 @@
+#include "StorageWatcher.h"
+
+#include <spdlog/spdlog.h>
+#include <vector>
+
+#include "AppSettings.h"
+#include "PairedDevicesStorage.h"
+
+#ifdef LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+constexpr int POLL_INTERVAL_MS = 2000;
+
+static std::filesystem::file_time_type GetWriteTime(const std::filesystem::path &path) {
+  std::error_code ec{};
+  auto writeTime = std::filesystem::last_write_time(path, ec);
+  return ec ? std::filesystem::file_time_type::min() : writeTime;
+}
+
+StorageWatcher::~StorageWatcher() {
+  Stop();
+}
+
+bool StorageWatcher::Start() {
+  if(m_IsRunning)
+    return true;
+  if(!m_StopNotifier.Open()) {
+    spdlog::error("Failed to create notifier socket.");
+    return false;
+  }
+
+#ifdef LINUX
+  AddWatch();
+#endif
+  auto baseDir = AppSettings::GetBaseDir();
+  m_SettingsWriteTime = GetWriteTime(baseDir / AppSettings::SETTINGS_FILE_NAME);
+  m_DevicesWriteTime = GetWriteTime(baseDir / PairedDevicesStorage::DEVICES_FILE_NAME);
+  m_IsRunning = true;
+  m_WatchThread = std::thread(&StorageWatcher::WatchThread, this);
+  return true;
+}
+
+void StorageWatcher::Stop() {
+  if(!m_IsRunning)
+    return;
+
+  m_IsRunning = false;
+  m_StopNotifier.Notify();
+  if(m_WatchThread.joinable())
+    m_WatchThread.join();
+  m_StopNotifier.Close();
+#ifdef LINUX
+  if(m_InotifyFd != -1)
+    close(m_InotifyFd);
+  m_InotifyFd = -1;
+  m_WatchFd = -1;
+#endif
+}
+
+void StorageWatcher::WatchThread() {
+  while(m_IsRunning) {
+    std::vector<struct pollfd> pollFds{};
+    pollFds.push_back({m_StopNotifier.GetSocket(), POLLIN, 0});
+#ifdef LINUX
+    if(m_WatchFd != -1)
+      pollFds.push_back({m_InotifyFd, POLLIN, 0});
+#endif
+    auto isWatching = pollFds.size() > 1;
+    if(SOCKET_POLL(pollFds.data(), pollFds.size(), isWatching ? -1 : POLL_INTERVAL_MS) < 0) {
+      auto error = SOCKET_LAST_ERROR;
+      if(error == SOCKET_ERROR_INTERRUPTED)
+        continue;
+      spdlog::error("Storage poll() failed. (Code={})", error);
+      return;
+    }
+    if(pollFds[0].revents != 0)
+      return;
+
+    Changes changes{};
+#ifdef LINUX
+    if(isWatching)
+      changes = ReadEvents();
+    else
+#endif
+      changes = PollChanges();
+    if(changes.settings)
+      AppSettings::Reload();
+    if(changes.devices)
+      PairedDevicesStorage::Reload();
+  }
+}
+
+StorageWatcher::Changes StorageWatcher::PollChanges() {
+  auto baseDir = AppSettings::GetBaseDir();
+#ifdef LINUX
+  // The directory is created on the first save after installing
+  std::error_code ec{};
+  if(m_InotifyFd != -1 && std::filesystem::is_directory(baseDir, ec)) {
+    AddWatch();
+    if(m_WatchFd != -1)
+      return {true, true};
+  }
+#endif
+  auto settingsWriteTime = GetWriteTime(baseDir / AppSettings::SETTINGS_FILE_NAME);
+  auto devicesWriteTime = GetWriteTime(baseDir / PairedDevicesStorage::DEVICES_FILE_NAME);
+  auto changes = Changes{settingsWriteTime != m_SettingsWriteTime, devicesWriteTime != m_DevicesWriteTime};
+  m_SettingsWriteTime = settingsWriteTime;
+  m_DevicesWriteTime = devicesWriteTime;
+  return changes;
+}
+
+#ifdef LINUX
+void StorageWatcher::AddWatch() {
+  if(m_InotifyFd == -1 && (m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+    spdlog::error("inotify_init1() failed. (Code={})", errno);
+    return;
+  }
+  // Files are replaced by rename, so the directory is watched instead of their inodes
+  auto baseDir = AppSettings::GetBaseDir();
+  if((m_WatchFd = inotify_add_watch(m_InotifyFd, baseDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF)) == -1)
+    spdlog::warn("inotify_add_watch() failed, polling for changes instead. (Code={})", errno);
+}
+
+StorageWatcher::Changes StorageWatcher::ReadEvents() {
+  Changes changes{};
+  alignas(struct inotify_event) char buffer[4096];
+  ssize_t numBytes{};
+  while((numBytes = read(m_InotifyFd, buffer, sizeof(buffer))) > 0) {
+    for(ssize_t offset = 0; offset < numBytes;) {
+      auto event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+      offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+      if(event->mask & IN_Q_OVERFLOW) {
+        changes = {true, true};
+      } else if(event->mask & IN_IGNORED) {
+        // Directory was removed, e.g. on uninstall
+        m_WatchFd = -1;
+      } else if(event->len > 0) {
+        auto fileName = std::string_view(event->name);
+        changes.settings |= fileName == AppSettings::SETTINGS_FILE_NAME;
+        changes.devices |= fileName == PairedDevicesStorage::DEVICES_FILE_NAME;
+      }
+    }
+  }
+  return changes;
+}
+#endif
@@ -0,0 +1,47 @@
+#ifndef PCBU_DESKTOP_STORAGEWATCHER_H
+#define PCBU_DESKTOP_STORAGEWATCHER_H
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "connection/SocketNotifier.h"
+
+// Reloads app settings and paired devices when their files are changed by another process, which
+// publishes them to the subscribers of AppSettings and PairedDevicesStorage.
+// Uses inotify on Linux and compares modification times every few seconds otherwise.
+class StorageWatcher {
+public:
+  StorageWatcher() = default;
+  ~StorageWatcher();
+  StorageWatcher(const StorageWatcher &) = delete;
+  StorageWatcher &operator=(const StorageWatcher &) = delete;
+
+  bool Start();
+  void Stop();
+
+private:
+  struct Changes {
+    bool settings{};
+    bool devices{};
+  };
+
+  void WatchThread();
+  Changes PollChanges();
+#ifdef LINUX
+  void AddWatch();
+  Changes ReadEvents();
+#endif
+
+  std::thread m_WatchThread{};
+  SocketNotifier m_StopNotifier{};
+  std::atomic<bool> m_IsRunning{};
+  std::filesystem::file_time_type m_SettingsWriteTime{};
+  std::filesystem::file_time_type m_DevicesWriteTime{};
+#ifdef LINUX
+  int m_InotifyFd = -1;
+  int m_WatchFd = -1;
+#endif
+};
+
+#endif // PCBU_DESKTOP_STORAGEWATCHER_H
@@ -17,6 +17,10 @@ std::string AppInfo::GetPairingProtocolVersion() {
 }
 
 std::string AppInfo::GetUnlockProtocolVersion() {
+  return "3.3.0";
+}
+
+std::string AppInfo::GetLegacyUnlockProtocolVersion() {
   return "3.0.0";
 }
 
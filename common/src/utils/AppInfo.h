@@ -3,11 +3,17 @@
 
 #include <string>
 
+// First unlock protocol versions supporting each feature
+constexpr auto UNLOCK_PROTO_VERSION_DERIVED_KEY = "3.1.0";
+constexpr auto UNLOCK_PROTO_VERSION_BINARY = "3.2.0";
+constexpr auto UNLOCK_PROTO_VERSION_KEEP_ALIVE = "3.3.0";
+
 class AppInfo {
 public:
   static std::string GetVersion();
   static std::string GetPairingProtocolVersion();
   static std::string GetUnlockProtocolVersion();
+  static std::string GetLegacyUnlockProtocolVersion();
 
   static std::string GetOperatingSystem();
   static std::string GetArchitecture();
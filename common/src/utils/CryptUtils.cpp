@@ -4,8 +4,12 @@
 #include "Utils.h"
 
 #include <cstring>
+#include <memory>
+#include <spdlog/spdlog.h>
 #include <openssl/err.h>
+#include <openssl/core_names.h>
 #include <openssl/evp.h>
+#include <openssl/kdf.h>
 #include <openssl/rand.h>
 
 #ifdef WINDOWS
@@ -21,7 +25,7 @@
 #define SALT_SIZE 16
 #define GCM_TAG_SIZE 16
 #define ITERATIONS 65535
-#define CRYPT_BUFFER_SIZE 2048
+#define HKDF_INFO "pcbu-aes-gcm"
 
 std::string CryptUtils::Sha256(const std::string &text) {
   EVP_MD_CTX *context = EVP_MD_CTX_new();
@@ -46,257 +50,340 @@ std::string CryptUtils::Sha256(const std::string &text) {
 }
 
 CryptPacket CryptUtils::EncryptAESPacket(const std::vector<uint8_t> &data, const std::string &pwd) {
-  if(data.size() > CRYPT_BUFFER_SIZE)
-    return {PacketCryptResult::OTHER_ERROR};
-
-  auto dataBuf = static_cast<uint8_t *>(malloc(data.size() + sizeof(int64_t)));
-  if(dataBuf == nullptr)
-    return {PacketCryptResult::OTHER_ERROR};
-
-  auto timeMs = htonll(Utils::GetCurrentTimeMs());
-  memcpy(dataBuf, &timeMs, sizeof(int64_t));
-  memcpy(&dataBuf[sizeof(int64_t)], data.data(), data.size());
-
-  auto encBuffer = static_cast<uint8_t *>(malloc(CRYPT_BUFFER_SIZE));
-  if(encBuffer == nullptr)
-    return {PacketCryptResult::OTHER_ERROR};
-
-  auto encLen = EncryptAES(dataBuf, data.size() + sizeof(int64_t), encBuffer, CRYPT_BUFFER_SIZE, pwd.c_str());
-  free(dataBuf);
-  if(encLen <= sizeof(int64_t)) {
-    free(encBuffer);
-    return {PacketCryptResult::OTHER_ERROR};
-  }
-
-  std::vector<uint8_t> resultVec(encLen);
-  memcpy(resultVec.data(), encBuffer, encLen);
-  free(encBuffer);
-  return {PacketCryptResult::OK, resultVec};
+  return EncryptAESPacket(data, CryptKey{pwd});
 }
 
 CryptPacket CryptUtils::DecryptAESPacket(const std::vector<uint8_t> &data, const std::string &pwd) {
-  if(data.size() > CRYPT_BUFFER_SIZE)
-    return {PacketCryptResult::OTHER_ERROR};
-
-  auto decBuffer = static_cast<uint8_t *>(malloc(CRYPT_BUFFER_SIZE));
-  if(decBuffer == nullptr)
-    return {PacketCryptResult::OTHER_ERROR};
+  return DecryptAESPacket(data, CryptKey{pwd});
+}
 
-  auto decLen = DecryptAES(data.data(), data.size(), decBuffer, CRYPT_BUFFER_SIZE, pwd.c_str());
-  if(decLen <= sizeof(int64_t)) {
-    free(decBuffer);
-    return {PacketCryptResult::OTHER_ERROR};
-  }
-  decLen = decLen - sizeof(int64_t);
+std::optional<std::string> CryptUtils::EncryptAES(const std::string &data, const std::string &pwd) {
+  return EncryptAES(data, CryptKey{pwd});
+}
 
-  int64_t timestamp{};
-  memcpy(&timestamp, decBuffer, sizeof(int64_t));
-  timestamp = static_cast<int64_t>(ntohll(timestamp));
+std::optional<std::string> CryptUtils::DecryptAES(const std::string &data, const std::string &pwd) {
+  return DecryptAES(data, CryptKey{pwd});
+}
 
-  auto timeDiff = Utils::GetCurrentTimeMs() - timestamp;
-  if(timeDiff < -CRYPT_PACKET_TIMEOUT || timeDiff > CRYPT_PACKET_TIMEOUT) {
-    free(decBuffer);
-    return {PacketCryptResult::INVALID_TIMESTAMP};
-  }
+CryptPacket CryptUtils::EncryptAESPacket(const std::vector<uint8_t> &data, const CryptKey &key) {
+  std::vector<uint8_t> result(data.size() + CRYPT_PACKET_OVERHEAD_SIZE);
+  size_t resultLen{};
+  auto cryptResult = EncryptAESPacket(data, result, resultLen, key);
+  if(cryptResult != PacketCryptResult::OK)
+    return {cryptResult};
+  result.resize(resultLen);
+  return {PacketCryptResult::OK, result};
+}
 
-  std::vector<uint8_t> resultVec(decLen);
-  memcpy(resultVec.data(), &decBuffer[sizeof(int64_t)], decLen);
-  free(decBuffer);
-  return {PacketCryptResult::OK, resultVec};
+CryptPacket CryptUtils::DecryptAESPacket(const std::vector<uint8_t> &data, const CryptKey &key) {
+  if(data.size() <= CRYPT_PACKET_OVERHEAD_SIZE)
+    return {PacketCryptResult::OTHER_ERROR};
+  std::vector<uint8_t> result(data.size() - CRYPT_PACKET_OVERHEAD_SIZE);
+  size_t resultLen{};
+  auto cryptResult = DecryptAESPacket(data, result, resultLen, key);
+  if(cryptResult != PacketCryptResult::OK)
+    return {cryptResult};
+  result.resize(resultLen);
+  return {PacketCryptResult::OK, result};
 }
 
-std::optional<std::string> CryptUtils::EncryptAES(const std::string &data, const std::string &pwd) {
-  if(data.size() > CRYPT_BUFFER_SIZE)
+std::optional<std::string> CryptUtils::EncryptAES(const std::string &data, const CryptKey &key) {
+  std::vector<uint8_t> result(data.size() + CRYPT_OVERHEAD_SIZE);
+  size_t resultLen{};
+  if(!EncryptAES({}, {reinterpret_cast<const uint8_t *>(data.data()), data.size()}, result, resultLen, key) || resultLen == 0)
     return {};
+  result.resize(resultLen);
+  return StringUtils::ToHexString(result);
+}
 
-  auto encBuffer = static_cast<uint8_t *>(malloc(CRYPT_BUFFER_SIZE));
-  if(encBuffer == nullptr)
+std::optional<std::string> CryptUtils::DecryptAES(const std::string &data, const CryptKey &key) {
+  auto decVec = StringUtils::FromHexString(data);
+  if(decVec.size() <= CRYPT_OVERHEAD_SIZE)
     return {};
-
-  auto encLen = EncryptAES(reinterpret_cast<const uint8_t *>(data.c_str()), data.size(), encBuffer, CRYPT_BUFFER_SIZE, pwd.c_str());
-  if(encLen <= 0) {
-    free(encBuffer);
+  std::string result(decVec.size() - CRYPT_OVERHEAD_SIZE, '\0');
+  size_t resultLen{};
+  if(!DecryptAES(decVec, {}, {reinterpret_cast<uint8_t *>(result.data()), result.size()}, resultLen, key) || resultLen == 0)
     return {};
-  }
-
-  std::vector<uint8_t> resultVec(encLen);
-  memcpy(resultVec.data(), encBuffer, encLen);
-  free(encBuffer);
-  return StringUtils::ToHexString(resultVec);
+  result.resize(resultLen);
+  return result;
 }
 
-std::optional<std::string> CryptUtils::DecryptAES(const std::string &data, const std::string &pwd) {
-  if(data.size() > CRYPT_BUFFER_SIZE)
-    return {};
+PacketCryptResult CryptUtils::EncryptAESPacket(std::span<const uint8_t> data, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key) {
+  auto timeMs = htonll(Utils::GetCurrentTimeMs());
+  uint8_t timestamp[sizeof(int64_t)]{};
+  memcpy(timestamp, &timeMs, sizeof(timestamp));
+  if(!EncryptAES(timestamp, data, dst, dstLen, key) || dstLen <= CRYPT_PACKET_OVERHEAD_SIZE)
+    return PacketCryptResult::OTHER_ERROR;
+  return PacketCryptResult::OK;
+}
 
-  auto decVec = StringUtils::FromHexString(data);
-  if(decVec.empty())
-    return {};
+PacketCryptResult CryptUtils::DecryptAESPacket(std::span<const uint8_t> data, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key) {
+  uint8_t timestampBuf[sizeof(int64_t)]{};
+  if(!DecryptAES(data, timestampBuf, dst, dstLen, key) || dstLen == 0)
+    return PacketCryptResult::OTHER_ERROR;
 
-  auto decBuffer = static_cast<uint8_t *>(malloc(CRYPT_BUFFER_SIZE));
-  if(decBuffer == nullptr)
-    return {};
+  int64_t timestamp{};
+  memcpy(&timestamp, timestampBuf, sizeof(int64_t));
+  timestamp = static_cast<int64_t>(ntohll(timestamp));
+  auto timeDiff = Utils::GetCurrentTimeMs() - timestamp;
+  if(timeDiff < -CRYPT_PACKET_TIMEOUT || timeDiff > CRYPT_PACKET_TIMEOUT)
+    return PacketCryptResult::INVALID_TIMESTAMP;
+  return PacketCryptResult::OK;
+}
 
-  auto decLen = DecryptAES(decVec.data(), decVec.size(), decBuffer, CRYPT_BUFFER_SIZE, pwd.c_str());
-  if(decLen <= 0) {
-    free(decBuffer);
-    return {};
+static void LogCryptError(const char *operation) {
+  char errorStr[256]{};
+  unsigned long error{};
+  bool hasError = false;
+  while((error = ERR_get_error()) != 0) {
+    ERR_error_string_n(error, errorStr, sizeof(errorStr));
+    spdlog::error("{} failed: {}", operation, errorStr);
+    hasError = true;
   }
+  if(!hasError)
+    spdlog::error("{} failed.", operation);
+}
 
-  auto result = std::string(reinterpret_cast<char *>(decBuffer), decLen);
-  free(decBuffer);
-  return result;
+static const EVP_CIPHER *GetCipher() {
+  static EVP_CIPHER *cipher = EVP_CIPHER_fetch(nullptr, "AES-256-GCM", nullptr);
+  return cipher;
 }
 
-size_t CryptUtils::EncryptAES(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, const char *pwd) {
-  ERR_print_errors_fp(stderr);
-  int status;
-  if(!src || !dst || dstLen < srcLen + SALT_SIZE + IV_SIZE + GCM_TAG_SIZE)
-    return false;
+// Contexts are set up once per thread, so every message only sets key and IV
+static EVP_CIPHER_CTX *GetCipherContext(bool encrypt) {
+  auto createContext = [encrypt]() -> EVP_CIPHER_CTX * {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if(!ctx)
+      return nullptr;
+    if(!GetCipher() || !EVP_CipherInit_ex(ctx, GetCipher(), nullptr, nullptr, nullptr, encrypt ? 1 : 0) ||
+       !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, nullptr) || !EVP_CIPHER_CTX_set_padding(ctx, 0)) {
+      EVP_CIPHER_CTX_free(ctx);
+      return nullptr;
+    }
+    return ctx;
+  };
+  thread_local std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> encryptCtx(nullptr, EVP_CIPHER_CTX_free);
+  thread_local std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> decryptCtx(nullptr, EVP_CIPHER_CTX_free);
+  auto &ctx = encrypt ? encryptCtx : decryptCtx;
+  if(!ctx)
+    ctx.reset(createContext());
+  return ctx.get();
+}
+
+static EVP_KDF_CTX *GetKDFContext() {
+  static EVP_KDF *hkdf = EVP_KDF_fetch(nullptr, OSSL_KDF_NAME_HKDF, nullptr);
+  thread_local std::unique_ptr<EVP_KDF_CTX, decltype(&EVP_KDF_CTX_free)> ctx(nullptr, EVP_KDF_CTX_free);
+  if(!ctx && hkdf)
+    ctx.reset(EVP_KDF_CTX_new(hkdf));
+  return ctx.get();
+}
 
-  unsigned char iv[IV_SIZE]{};
-  if(RAND_bytes(iv, IV_SIZE) != 1)
+bool CryptUtils::EncryptAES(std::span<const uint8_t> prefix, std::span<const uint8_t> data, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key) {
+  dstLen = 0;
+  if(dst.size() < prefix.size() + data.size() + CRYPT_OVERHEAD_SIZE)
     return false;
-  memcpy(dst, iv, IV_SIZE);
 
-  unsigned char salt[SALT_SIZE]{};
-  if(RAND_bytes(salt, SALT_SIZE) != 1)
+  uint8_t *iv = dst.data();
+  uint8_t *salt = iv + IV_SIZE;
+  uint8_t *encData = salt + SALT_SIZE;
+  if(RAND_bytes(iv, IV_SIZE) != 1 || RAND_bytes(salt, SALT_SIZE) != 1) {
+    LogCryptError("RAND_bytes()");
     return false;
-  memcpy(dst + IV_SIZE, salt, SALT_SIZE);
+  }
 
-  unsigned char *key = GenerateKey(pwd, salt);
-  if(!key)
+  uint8_t aesKey[AES_KEY_SIZE / 8]{};
+  if(!GenerateKey(key, salt, aesKey))
     return false;
+  EVP_CIPHER_CTX *ctx = GetCipherContext(true);
+  int status = ctx != nullptr && EVP_EncryptInit_ex(ctx, nullptr, nullptr, aesKey, iv);
+  OPENSSL_cleanse(aesKey, sizeof(aesKey));
 
   int numberOfBytes = 0;
-  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-  if(!ctx) {
-    free(key);
-    return false;
+  int encryptedLen = 0;
+  if(status && !prefix.empty()) {
+    status = EVP_EncryptUpdate(ctx, encData, &numberOfBytes, prefix.data(), (int)prefix.size());
+    encryptedLen += numberOfBytes;
   }
-
-  status = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr);
-  if(!status) {
-    free(key);
-    EVP_CIPHER_CTX_free(ctx);
-    return false;
+  if(status && !data.empty()) {
+    status = EVP_EncryptUpdate(ctx, encData + encryptedLen, &numberOfBytes, data.data(), (int)data.size());
+    encryptedLen += numberOfBytes;
   }
-  status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, nullptr);
-  if(!status) {
-    free(key);
-    EVP_CIPHER_CTX_free(ctx);
-    return false;
+  if(status) {
+    status = EVP_EncryptFinal_ex(ctx, encData + encryptedLen, &numberOfBytes);
+    encryptedLen += numberOfBytes;
   }
-  status = EVP_CIPHER_CTX_set_padding(ctx, 0);
+  if(status)
+    status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, GCM_TAG_SIZE, encData + encryptedLen);
   if(!status) {
-    free(key);
-    EVP_CIPHER_CTX_free(ctx);
+    LogCryptError("AES encryption");
     return false;
   }
-  status = EVP_EncryptInit_ex(ctx, nullptr, nullptr, key, iv);
-  free(key);
-  if(!status) {
-    EVP_CIPHER_CTX_free(ctx);
+  dstLen = IV_SIZE + SALT_SIZE + encryptedLen + GCM_TAG_SIZE;
+  return true;
+}
+
+bool CryptUtils::DecryptAES(std::span<const uint8_t> data, std::span<uint8_t> prefix, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key) {
+  dstLen = 0;
+  if(data.size() < CRYPT_OVERHEAD_SIZE + prefix.size())
+    return false;
+  size_t encLen = data.size() - CRYPT_OVERHEAD_SIZE;
+  if(dst.size() < encLen - prefix.size())
     return false;
-  }
 
-  status = EVP_EncryptUpdate(ctx, dst + IV_SIZE + SALT_SIZE, &numberOfBytes, src, (int)srcLen);
-  if(!status) {
-    EVP_CIPHER_CTX_free(ctx);
+  const uint8_t *iv = data.data();
+  const uint8_t *salt = iv + IV_SIZE;
+  const uint8_t *encData = salt + SALT_SIZE;
+  const uint8_t *tag = encData + encLen;
+
+  uint8_t aesKey[AES_KEY_SIZE / 8]{};
+  if(!GenerateKey(key, salt, aesKey))
     return false;
-  }
+  EVP_CIPHER_CTX *ctx = GetCipherContext(false);
+  int status = ctx != nullptr && EVP_DecryptInit_ex(ctx, nullptr, nullptr, aesKey, iv);
+  OPENSSL_cleanse(aesKey, sizeof(aesKey));
 
-  int encryptedLen = numberOfBytes;
-  status = EVP_EncryptFinal_ex(ctx, dst + IV_SIZE + SALT_SIZE + encryptedLen, &numberOfBytes);
+  int numberOfBytes = 0;
+  int decryptedLen = 0;
+  if(status && !prefix.empty())
+    status = EVP_DecryptUpdate(ctx, prefix.data(), &numberOfBytes, encData, (int)prefix.size());
+  if(status && encLen > prefix.size()) {
+    status = EVP_DecryptUpdate(ctx, dst.data(), &numberOfBytes, encData + prefix.size(), (int)(encLen - prefix.size()));
+    decryptedLen = numberOfBytes;
+  }
+  if(status)
+    status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, GCM_TAG_SIZE, const_cast<uint8_t *>(tag));
   if(!status) {
-    EVP_CIPHER_CTX_free(ctx);
+    LogCryptError("AES decryption");
     return false;
   }
-
-  status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, GCM_TAG_SIZE, dst + IV_SIZE + SALT_SIZE + encryptedLen);
-  if(!status) {
-    EVP_CIPHER_CTX_free(ctx);
+  // A failing final step means the tag did not match, which is not an OpenSSL error
+  if(!EVP_DecryptFinal_ex(ctx, dst.data() + decryptedLen, &numberOfBytes)) {
+    ERR_clear_error();
     return false;
   }
-  EVP_CIPHER_CTX_free(ctx);
-  return IV_SIZE + SALT_SIZE + encryptedLen + GCM_TAG_SIZE;
+  dstLen = decryptedLen;
+  return true;
 }
 
-size_t CryptUtils::DecryptAES(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, const char *pwd) {
-  ERR_print_errors_fp(stderr);
-  int status;
-  if(!src || !dst || srcLen < IV_SIZE + SALT_SIZE + GCM_TAG_SIZE || dstLen < srcLen - IV_SIZE - SALT_SIZE - GCM_TAG_SIZE)
-    return false;
-
-  unsigned char iv[IV_SIZE]{};
-  memcpy(iv, src, IV_SIZE);
+std::string CryptUtils::DeriveDeviceKey(const std::string &encryptionKey, const std::string &deviceId) {
+  std::vector<uint8_t> key(AES_KEY_SIZE / 8);
+  if(PKCS5_PBKDF2_HMAC(encryptionKey.c_str(), (int)encryptionKey.size(), reinterpret_cast<const unsigned char *>(deviceId.c_str()), (int)deviceId.size(),
+                       ITERATIONS, EVP_sha256(), (int)key.size(), key.data()) != 1) {
+    LogCryptError("PBKDF2");
+    return {};
+  }
+  return StringUtils::ToHexString(key);
+}
 
-  unsigned char salt[SALT_SIZE]{};
-  memcpy(salt, src + IV_SIZE, SALT_SIZE);
+bool CryptUtils::GenerateKey(const CryptKey &key, const uint8_t *salt, uint8_t *dst) {
+  if(key.derivation == KeyDerivation::PBKDF2) {
+    if(PKCS5_PBKDF2_HMAC(key.secret.c_str(), (int)key.secret.size(), salt, SALT_SIZE, ITERATIONS, EVP_sha256(), AES_KEY_SIZE / 8, dst) != 1) {
+      LogCryptError("PBKDF2");
+      return false;
+    }
+    return true;
+  }
 
-  unsigned char *key = GenerateKey(pwd, salt);
-  if(!key)
+  EVP_KDF_CTX *ctx = GetKDFContext();
+  char digest[] = SN_sha256;
+  char info[] = HKDF_INFO;
+  OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, digest, 0),
+                         OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, const_cast<char *>(key.secret.data()), key.secret.size()),
+                         OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, const_cast<uint8_t *>(salt), SALT_SIZE),
+                         OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, info, sizeof(info) - 1), OSSL_PARAM_construct_end()};
+  if(!ctx || EVP_KDF_derive(ctx, dst, AES_KEY_SIZE / 8, params) != 1) {
+    LogCryptError("HKDF");
     return false;
+  }
+  return true;
+}
 
-  int numberOfBytes = 0;
-  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-  if(!ctx) {
-    free(key);
+AESStreamEncryptor::AESStreamEncryptor() : m_Context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) {}
+
+bool AESStreamEncryptor::Init(const CryptKey &key, std::span<uint8_t, CRYPT_HEADER_SIZE> header) {
+  uint8_t *iv = header.data();
+  uint8_t *salt = iv + IV_SIZE;
+  if(RAND_bytes(iv, IV_SIZE) != 1 || RAND_bytes(salt, SALT_SIZE) != 1) {
+    LogCryptError("RAND_bytes()");
     return false;
   }
 
-  status = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr);
-  if(!status) {
-    free(key);
-    EVP_CIPHER_CTX_free(ctx);
+  uint8_t aesKey[AES_KEY_SIZE / 8]{};
+  if(!m_Context || !GetCipher() || !CryptUtils::GenerateKey(key, salt, aesKey))
     return false;
-  }
-  status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, nullptr);
+  int status = EVP_EncryptInit_ex(m_Context.get(), GetCipher(), nullptr, nullptr, nullptr) &&
+               EVP_CIPHER_CTX_ctrl(m_Context.get(), EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, nullptr) &&
+               EVP_EncryptInit_ex(m_Context.get(), nullptr, nullptr, aesKey, iv);
+  OPENSSL_cleanse(aesKey, sizeof(aesKey));
   if(!status) {
-    free(key);
-    EVP_CIPHER_CTX_free(ctx);
+    LogCryptError("AES encryption");
     return false;
   }
-  status = EVP_CIPHER_CTX_set_padding(ctx, 0);
-  if(!status) {
-    free(key);
-    EVP_CIPHER_CTX_free(ctx);
+  return true;
+}
+
+bool AESStreamEncryptor::Update(std::span<const uint8_t> data, std::span<uint8_t> dst) {
+  if(!m_Context || dst.size() < data.size() || data.size() > INT32_MAX)
     return false;
-  }
-  status = EVP_DecryptInit_ex(ctx, nullptr, nullptr, key, iv);
-  free(key);
-  if(!status) {
-    EVP_CIPHER_CTX_free(ctx);
+  int numberOfBytes = 0;
+  if(!data.empty() && !EVP_EncryptUpdate(m_Context.get(), dst.data(), &numberOfBytes, data.data(), (int)data.size())) {
+    LogCryptError("AES encryption");
     return false;
   }
+  return true;
+}
 
-  status = EVP_DecryptUpdate(ctx, dst, &numberOfBytes, src + IV_SIZE + SALT_SIZE, (int)srcLen - IV_SIZE - SALT_SIZE - GCM_TAG_SIZE);
-  if(!status) {
-    EVP_CIPHER_CTX_free(ctx);
+bool AESStreamEncryptor::Final(std::span<uint8_t, CRYPT_TAG_SIZE> tag) {
+  uint8_t finalBuffer[GCM_TAG_SIZE]{}; // GCM does not output anything here
+  int numberOfBytes = 0;
+  if(!m_Context || !EVP_EncryptFinal_ex(m_Context.get(), finalBuffer, &numberOfBytes) ||
+     !EVP_CIPHER_CTX_ctrl(m_Context.get(), EVP_CTRL_GCM_GET_TAG, GCM_TAG_SIZE, tag.data())) {
+    LogCryptError("AES encryption");
     return false;
   }
+  return true;
+}
+
+AESStreamDecryptor::AESStreamDecryptor() : m_Context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) {}
 
-  int decryptedLen = numberOfBytes;
-  status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, GCM_TAG_SIZE, (void *)(src + srcLen - GCM_TAG_SIZE));
+bool AESStreamDecryptor::Init(const CryptKey &key, std::span<const uint8_t, CRYPT_HEADER_SIZE> header) {
+  const uint8_t *iv = header.data();
+  const uint8_t *salt = iv + IV_SIZE;
+  uint8_t aesKey[AES_KEY_SIZE / 8]{};
+  if(!m_Context || !GetCipher() || !CryptUtils::GenerateKey(key, salt, aesKey))
+    return false;
+  int status = EVP_DecryptInit_ex(m_Context.get(), GetCipher(), nullptr, nullptr, nullptr) &&
+               EVP_CIPHER_CTX_ctrl(m_Context.get(), EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, nullptr) &&
+               EVP_DecryptInit_ex(m_Context.get(), nullptr, nullptr, aesKey, iv);
+  OPENSSL_cleanse(aesKey, sizeof(aesKey));
   if(!status) {
-    EVP_CIPHER_CTX_free(ctx);
+    LogCryptError("AES decryption");
     return false;
   }
+  return true;
+}
 
-  status = EVP_DecryptFinal_ex(ctx, dst + decryptedLen, &numberOfBytes);
-  EVP_CIPHER_CTX_free(ctx);
-  if(!status)
+bool AESStreamDecryptor::Update(std::span<const uint8_t> data, std::span<uint8_t> dst) {
+  if(!m_Context || dst.size() < data.size() || data.size() > INT32_MAX)
+    return false;
+  int numberOfBytes = 0;
+  if(!data.empty() && !EVP_DecryptUpdate(m_Context.get(), dst.data(), &numberOfBytes, data.data(), (int)data.size())) {
+    LogCryptError("AES decryption");
     return false;
-  return decryptedLen;
+  }
+  return true;
 }
 
-uint8_t *CryptUtils::GenerateKey(const char *pwd, unsigned char *salt) {
-  auto key = static_cast<unsigned char *>(malloc(AES_KEY_SIZE / 8));
-  if(!key)
-    return nullptr;
-  if(PKCS5_PBKDF2_HMAC(pwd, (int)strlen(pwd), salt, SALT_SIZE, ITERATIONS, EVP_sha256(), AES_KEY_SIZE / 8, key) != 1) {
-    free(key);
-    return nullptr;
+bool AESStreamDecryptor::Final(std::span<const uint8_t, CRYPT_TAG_SIZE> tag) {
+  if(!m_Context || !EVP_CIPHER_CTX_ctrl(m_Context.get(), EVP_CTRL_GCM_SET_TAG, GCM_TAG_SIZE, const_cast<uint8_t *>(tag.data()))) {
+    LogCryptError("AES decryption");
+    return false;
+  }
+  uint8_t finalBuffer[GCM_TAG_SIZE]{};
+  int numberOfBytes = 0;
+  if(!EVP_DecryptFinal_ex(m_Context.get(), finalBuffer, &numberOfBytes)) {
+    ERR_clear_error();
+    return false;
   }
-  return key;
+  return true;
 }
@@ -2,12 +2,21 @@
 #define PCBU_DESKTOP_CRYPTUTILS_H
 
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+#include <openssl/types.h>
+
 #define CRYPT_PACKET_TIMEOUT (60000 * 2)
 
+constexpr size_t CRYPT_HEADER_SIZE = 16 + 16;                                        // IV and salt
+constexpr size_t CRYPT_TAG_SIZE = 16;                                                // GCM tag
+constexpr size_t CRYPT_OVERHEAD_SIZE = CRYPT_HEADER_SIZE + CRYPT_TAG_SIZE;           // Header and tag
+constexpr size_t CRYPT_PACKET_OVERHEAD_SIZE = CRYPT_OVERHEAD_SIZE + sizeof(int64_t); // Plus timestamp
+
 enum PacketCryptResult { OK, INVALID_TIMESTAMP, OTHER_ERROR };
 
 struct CryptPacket {
@@ -15,6 +24,16 @@ struct CryptPacket {
   std::vector<uint8_t> data{};
 };
 
+enum class KeyDerivation {
+  PBKDF2, // Secret is a password, stretched for every message
+  HKDF    // Secret is already a strong key, e.g. from DeriveDeviceKey()
+};
+
+struct CryptKey {
+  std::string secret{};
+  KeyDerivation derivation = KeyDerivation::PBKDF2;
+};
+
 class CryptUtils {
 public:
   static std::string Sha256(const std::string &text);
@@ -24,12 +43,58 @@ public:
   static std::optional<std::string> EncryptAES(const std::string &data, const std::string &pwd);
   static std::optional<std::string> DecryptAES(const std::string &data, const std::string &pwd);
 
+  static CryptPacket EncryptAESPacket(const std::vector<uint8_t> &data, const CryptKey &key);
+  static CryptPacket DecryptAESPacket(const std::vector<uint8_t> &data, const CryptKey &key);
+  static std::optional<std::string> EncryptAES(const std::string &data, const CryptKey &key);
+  static std::optional<std::string> DecryptAES(const std::string &data, const CryptKey &key);
+
+  // Core API on caller-owned storage. Reuses per-thread cipher contexts and allocates only in GenerateKey().
+  // dst needs data.size() + CRYPT_PACKET_OVERHEAD_SIZE bytes for encryption and data.size() for decryption.
+  static PacketCryptResult EncryptAESPacket(std::span<const uint8_t> data, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key);
+  static PacketCryptResult DecryptAESPacket(std::span<const uint8_t> data, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key);
+
+  // Runs PBKDF2 once for a paired device. The result is used with KeyDerivation::HKDF.
+  static std::string DeriveDeviceKey(const std::string &encryptionKey, const std::string &deviceId);
+  // Derives the 32-byte AES key of one message from its 16-byte salt. Both KDFs allocate inside OpenSSL,
+  // which is why only the AES-GCM part of the span API is allocation-free.
+  static bool GenerateKey(const CryptKey &key, const uint8_t *salt, uint8_t *dst);
+
 private:
-  static size_t EncryptAES(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, const char *pwd);
-  static size_t DecryptAES(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, const char *pwd);
-  static uint8_t *GenerateKey(const char *pwd, unsigned char *salt);
+  // The plaintext is prefix followed by data, so packets can carry their timestamp without a copy
+  static bool EncryptAES(std::span<const uint8_t> prefix, std::span<const uint8_t> data, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key);
+  static bool DecryptAES(std::span<const uint8_t> data, std::span<uint8_t> prefix, std::span<uint8_t> dst, size_t &dstLen, const CryptKey &key);
 
   CryptUtils() = default;
+  friend class AESStreamEncryptor;
+  friend class AESStreamDecryptor;
+};
+
+// Incremental AES-256-GCM producing the EncryptAES() layout (header, ciphertext, tag), for payloads
+// that are processed in pieces instead of being held in memory at once. Each Update() outputs as many
+// bytes as it is given.
+class AESStreamEncryptor {
+public:
+  AESStreamEncryptor();
+
+  bool Init(const CryptKey &key, std::span<uint8_t, CRYPT_HEADER_SIZE> header);
+  bool Update(std::span<const uint8_t> data, std::span<uint8_t> dst);
+  bool Final(std::span<uint8_t, CRYPT_TAG_SIZE> tag);
+
+private:
+  std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX *)> m_Context;
+};
+
+class AESStreamDecryptor {
+public:
+  AESStreamDecryptor();
+
+  bool Init(const CryptKey &key, std::span<const uint8_t, CRYPT_HEADER_SIZE> header);
+  bool Update(std::span<const uint8_t> data, std::span<uint8_t> dst);
+  // Checks the tag. Until this succeeds, the output of Update() is unauthenticated and must be discarded on failure.
+  bool Final(std::span<const uint8_t, CRYPT_TAG_SIZE> tag);
+
+private:
+  std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX *)> m_Context;
 };
 
 #endif // PCBU_DESKTOP_CRYPTUTILS_H
@@ -8,33 +8,30 @@
 #include "generated/LANG_PT_PT.h"
 #include "generated/LANG_ZH_CN.h"
 
-std::string I18n::Get(const std::string &key) {
-  const auto lang = LocaleHelper::GetUserLocale();
-  const nlohmann::json *langJson{};
+static const I18nTable &GetTable(LocaleHelper::Locale lang) {
   switch(lang) {
     case LocaleHelper::Locale::GERMAN:
-      langJson = &LANG_DE_DE_DATA;
-      break;
+      return LANG_DE_DE_TABLE;
     case LocaleHelper::Locale::CHINESE_SIMPLIFIED:
-      langJson = &LANG_ZH_CN_DATA;
-      break;
+      return LANG_ZH_CN_TABLE;
     case LocaleHelper::Locale::PORTUGUESE_PT:
-      langJson = &LANG_PT_PT_DATA;
-      break;
+      return LANG_PT_PT_TABLE;
     case LocaleHelper::Locale::PORTUGUESE_BR:
-      langJson = &LANG_PT_BR_DATA;
-      break;
+      return LANG_PT_BR_TABLE;
     case LocaleHelper::Locale::ENGLISH:
     default:
-      langJson = &LANG_EN_US_DATA;
-      break;
+      return LANG_EN_US_TABLE;
   }
-  if(langJson->count(key))
-    return langJson->at(key);
+}
+
+std::string I18n::Get(std::string_view key) {
+  const auto lang = LocaleHelper::GetUserLocale();
+  if(auto value = GetTable(lang).Find(key))
+    return std::string(value.value());
   spdlog::warn("Missing I18n key '{}' for locale '{}'.", key, LocaleHelper::ToString(lang));
   if(lang != LocaleHelper::Locale::ENGLISH) {
-    if(LANG_EN_US_DATA.count(key))
-      return LANG_EN_US_DATA.at(key);
+    if(auto value = LANG_EN_US_TABLE.Find(key))
+      return std::string(value.value());
   }
-  return key;
+  return std::string(key);
 }
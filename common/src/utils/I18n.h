@@ -2,14 +2,15 @@
 #define I18N_H
 
 #include <spdlog/spdlog.h>
+#include <string_view>
 
 class I18n {
 public:
-  template <typename... T> static std::string Get(const std::string &key, T &&...args) {
+  template <typename... T> static std::string Get(std::string_view key, T &&...args) {
     return fmt::format(fmt::runtime(Get(key)), args...);
   }
 
-  static std::string Get(const std::string &key);
+  static std::string Get(std::string_view key);
 
 private:
   I18n() = default;
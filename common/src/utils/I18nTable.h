@@ -0,0 +1,53 @@
+#ifndef PCBU_DESKTOP_I18NTABLE_H
+#define PCBU_DESKTOP_I18NTABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+// Strings of one language, generated from common/res/*.json by cmake/GenerateLanguageTable.cmake.
+// Keys are placed with a perfect hash, so a lookup hashes the key once and compares a single entry.
+class I18nTable {
+public:
+  struct Entry {
+    std::string_view key{};
+    std::string_view value{};
+  };
+
+  // Both sizes are powers of two
+  constexpr I18nTable(std::span<const Entry> entries, std::span<const uint32_t> seeds) : m_Entries(entries), m_Seeds(seeds) {}
+
+  [[nodiscard]] constexpr std::optional<std::string_view> Find(std::string_view key) const {
+    auto hash = Hash(key);
+    auto seed = m_Seeds[hash & (m_Seeds.size() - 1)];
+    const auto &entry = m_Entries[Mix(hash ^ seed) & (m_Entries.size() - 1)];
+    if(key.empty() || entry.key != key)
+      return {};
+    return entry.value;
+  }
+
+  // Includes empty slots
+  [[nodiscard]] constexpr std::span<const Entry> GetEntries() const {
+    return m_Entries;
+  }
+
+  // Must match the generator. FNV-1a for the key, then a 32-bit finalizer for the slot.
+  static constexpr uint32_t Hash(std::string_view str) {
+    uint32_t hash = 2166136261u;
+    for(auto c : str)
+      hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    return hash;
+  }
+  static constexpr uint32_t Mix(uint32_t value) {
+    value = ((value >> 16) ^ value) * 0x45d9f3bu;
+    value = ((value >> 16) ^ value) * 0x45d9f3bu;
+    return (value >> 16) ^ value;
+  }
+
+private:
+  std::span<const Entry> m_Entries{};
+  std::span<const uint32_t> m_Seeds{};
+};
+
+#endif // PCBU_DESKTOP_I18NTABLE_H
@@ -11,8 +11,31 @@
 #include <Windows.h>
 #endif
 
+AppSettingsPtr LocaleHelper::g_Settings{};
+LocaleHelper::Locale LocaleHelper::g_Locale{};
+std::mutex LocaleHelper::g_Mutex{};
+
 LocaleHelper::Locale LocaleHelper::GetUserLocale() {
-  auto settingsLang = AppSettings::Get().language;
+  thread_local AppSettingsPtr t_Settings{};
+  thread_local Locale t_Locale{};
+  auto settings = AppSettings::Get();
+  if(settings == t_Settings)
+    return t_Locale;
+
+  // "auto" reads /etc/locale.conf or asks the system, so it is resolved once for all threads
+  {
+    std::lock_guard lock(g_Mutex);
+    if(settings != g_Settings) {
+      g_Locale = ResolveLocale(settings->language);
+      g_Settings = settings;
+    }
+    t_Locale = g_Locale;
+  }
+  t_Settings = settings;
+  return t_Locale;
+}
+
+LocaleHelper::Locale LocaleHelper::ResolveLocale(const std::string &settingsLang) {
   if(settingsLang != "auto") {
     if(settingsLang == "zh_CN")
       return Locale::CHINESE_SIMPLIFIED;
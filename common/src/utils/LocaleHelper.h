@@ -1,8 +1,11 @@
 #ifndef LOCALEHELPER_H
 #define LOCALEHELPER_H
 
+#include <mutex>
 #include <string>
 
+#include "storage/AppSettings.h"
+
 class LocaleHelper {
 public:
   enum class Locale {
@@ -13,11 +16,18 @@ public:
     PORTUGUESE_BR,
   };
 
+  // Resolved once per settings snapshot, so changing the language in the settings takes effect right away
   static Locale GetUserLocale();
   static std::string ToString(Locale locale);
 
 private:
   LocaleHelper() = default;
+
+  static Locale ResolveLocale(const std::string &settingsLang);
+
+  static AppSettingsPtr g_Settings;
+  static Locale g_Locale;
+  static std::mutex g_Mutex;
 };
 
 #endif
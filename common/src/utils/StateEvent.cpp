@@ -0,0 +1,26 @@
+#include "StateEvent.h"
+
+void StateEvent::Notify() {
+  {
+    std::lock_guard lock(m_Mutex);
+    m_Generation++;
+  }
+  m_Condition.notify_all();
+}
+
+uint64_t StateEvent::GetGeneration() {
+  std::lock_guard lock(m_Mutex);
+  return m_Generation;
+}
+
+uint64_t StateEvent::Wait(uint64_t generation) {
+  std::unique_lock lock(m_Mutex);
+  m_Condition.wait(lock, [&] { return m_Generation != generation; });
+  return m_Generation;
+}
+
+uint64_t StateEvent::WaitFor(uint64_t generation, std::chrono::milliseconds timeout) {
+  std::unique_lock lock(m_Mutex);
+  m_Condition.wait_for(lock, timeout, [&] { return m_Generation != generation; });
+  return m_Generation;
+}
@@ -0,0 +1,28 @@
+#ifndef PCBU_DESKTOP_STATEEVENT_H
+#define PCBU_DESKTOP_STATEEVENT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Generation counter that wakes every waiter when it changes
+class StateEvent {
+public:
+  StateEvent() = default;
+  StateEvent(const StateEvent &) = delete;
+  StateEvent &operator=(const StateEvent &) = delete;
+
+  void Notify();
+  uint64_t GetGeneration();
+  uint64_t Wait(uint64_t generation);
+  // Waits until the generation differs from the given one, returns the current generation
+  uint64_t WaitFor(uint64_t generation, std::chrono::milliseconds timeout);
+
+private:
+  uint64_t m_Generation{};
+  std::mutex m_Mutex{};
+  std::condition_variable m_Condition{};
+};
+
+#endif // PCBU_DESKTOP_STATEEVENT_H
@@ -0,0 +1,54 @@
+#include "ThreadPool.h"
+
+#include <spdlog/spdlog.h>
+
+ThreadPool::ThreadPool(size_t numThreads) {
+  m_Threads.reserve(numThreads);
+  for(size_t i = 0; i < numThreads; i++)
+    m_Threads.emplace_back(&ThreadPool::WorkerThread, this);
+}
+
+ThreadPool::~ThreadPool() {
+  Stop();
+}
+
+void ThreadPool::Post(std::function<void()> task) {
+  {
+    std::lock_guard lock(m_Mutex);
+    if(!m_IsRunning)
+      return;
+    m_Tasks.emplace_back(std::move(task));
+  }
+  m_Condition.notify_one();
+}
+
+void ThreadPool::Stop() {
+  {
+    std::lock_guard lock(m_Mutex);
+    m_IsRunning = false;
+    m_Tasks.clear();
+  }
+  m_Condition.notify_all();
+  for(auto &thread : m_Threads)
+    if(thread.joinable())
+      thread.join();
+}
+
+void ThreadPool::WorkerThread() {
+  while(true) {
+    std::function<void()> task{};
+    {
+      std::unique_lock lock(m_Mutex);
+      m_Condition.wait(lock, [this]() { return !m_IsRunning || !m_Tasks.empty(); });
+      if(!m_IsRunning)
+        return;
+      task = std::move(m_Tasks.front());
+      m_Tasks.pop_front();
+    }
+    try {
+      task();
+    } catch(const std::exception &ex) {
+      spdlog::error("Unhandled exception in worker thread: {}", ex.what());
+    }
+  }
+}
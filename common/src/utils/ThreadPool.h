@@ -0,0 +1,32 @@
+#ifndef PCBU_DESKTOP_THREADPOOL_H
+#define PCBU_DESKTOP_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t numThreads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void Post(std::function<void()> task);
+  // Discards queued tasks and waits for the running ones
+  void Stop();
+
+private:
+  void WorkerThread();
+
+  std::vector<std::thread> m_Threads{};
+  std::deque<std::function<void()>> m_Tasks{};
+  std::mutex m_Mutex{};
+  std::condition_variable m_Condition{};
+  bool m_IsRunning = true;
+};
+
+#endif // PCBU_DESKTOP_THREADPOOL_H
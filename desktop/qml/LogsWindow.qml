@@ -7,57 +7,132 @@ import PCBioUnlock
 ApplicationWindow {
     id: logsWindow
     width: 800
-    height: 600
+    height: 800
     title: QI18n.Get('logs')
+    LogListModel {
+        id: desktopLogModel
+    }
+    LogListModel {
+        id: moduleLogModel
+    }
+    LogListModel {
+        id: authdLogModel
+    }
+    Timer {
+        id: filterTimer
+        interval: 300
+        onTriggered: {
+            let minLevel = levelComboBoxModel.get(levelComboBox.currentIndex).val;
+            desktopLogModel.setFilter(minLevel, searchTextField.text);
+            moduleLogModel.setFilter(minLevel, searchTextField.text);
+            authdLogModel.setFilter(minLevel, searchTextField.text);
+        }
+    }
+    component LogView: ListView {
+        property bool followEnd: true
+        Layout.fillWidth: true
+        Layout.fillHeight: true
+        clip: true
+        reuseItems: true
+        ScrollBar.vertical: ScrollBar {}
+        delegate: TextEdit {
+            required property string logText
+            required property string logLevel
+            width: ListView.view.width
+            readOnly: true
+            selectByMouse: true
+            wrapMode: Text.WrapAnywhere
+            color: logLevel === 'error' || logLevel === 'critical' ? 'red' : logLevel === 'warning' ? 'orange' : palette.text
+            text: logText
+        }
+        onCountChanged: {
+            if(followEnd)
+                positionViewAtEnd();
+        }
+        onMovementEnded: {
+            followEnd = atYEnd;
+        }
+    }
     ColumnLayout {
         anchors.fill: parent
         anchors.margins: 25
+        RowLayout {
+            Layout.fillWidth: true
+            TextField {
+                id: searchTextField
+                Layout.fillWidth: true
+                placeholderText: QI18n.Get('logs_search')
+                onTextChanged: filterTimer.restart()
+            }
+            ComboBox {
+                id: levelComboBox
+                model: ListModel {
+                    id: levelComboBoxModel
+                    ListElement {
+                        text: ""
+                        val: ""
+                    }
+                    ListElement {
+                        text: "Debug"
+                        val: "debug"
+                    }
+                    ListElement {
+                        text: "Info"
+                        val: "info"
+                    }
+                    ListElement {
+                        text: "Warning"
+                        val: "warning"
+                    }
+                    ListElement {
+                        text: "Error"
+                        val: "error"
+                    }
+                }
+                textRole: 'text'
+                displayText: currentIndex === 0 ? QI18n.Get('logs_all_levels') : currentText
+                onActivated: filterTimer.restart()
+            }
+        }
         ColumnLayout {
-            Layout.preferredWidth: parent.width
-            Layout.preferredHeight: parent.height / 2
+            Layout.fillWidth: true
+            Layout.fillHeight: true
             Label {
                 text: '%1:'.arg(QI18n.Get('desktop_logs'))
             }
-            ScrollView {
-                Layout.fillWidth: true
-                Layout.fillHeight: true
-                id: desktopLogScrollView
-                TextArea {
-                    id: desktopLogTextArea
-                    readOnly: true
-                    wrapMode: Text.WordWrap
-                    text: QI18n.Get('loading')
-                }
+            LogView {
+                model: desktopLogModel
             }
         }
         ColumnLayout {
             Layout.topMargin: 25
-            Layout.preferredWidth: parent.width
-            Layout.preferredHeight: parent.height / 2
+            Layout.fillWidth: true
+            Layout.fillHeight: true
             Label {
                 text: '%1:'.arg(QI18n.Get('module_logs'))
             }
-            ScrollView {
-                Layout.fillWidth: true
-                Layout.fillHeight: true
-                id: moduleLogScrollView
-                TextArea {
-                    id: moduleLogTextArea
-                    readOnly: true
-                    wrapMode: Text.WordWrap
-                    text: QI18n.Get('loading')
-                }
+            LogView {
+                model: moduleLogModel
+            }
+        }
+        ColumnLayout {
+            // pcbu_authd serves the PAM module when it is installed
+            visible: Qt.platform.os !== 'windows'
+            Layout.topMargin: 25
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            Label {
+                text: '%1:'.arg(QI18n.Get('authd_logs'))
+            }
+            LogView {
+                model: authdLogModel
             }
         }
     }
     Component.onCompleted: {
-        LogsWindow.LoadLogs(logsWindow);
-    }
-
-    function setLogs(desktopLogs, moduleLogs) {
-        desktopLogTextArea.text = desktopLogs;
-        moduleLogTextArea.text = moduleLogs;
-        desktopLogTextArea.cursorPosition = desktopLogTextArea.length;
-        moduleLogTextArea.cursorPosition = moduleLogTextArea.length;
+        desktopLogModel.open('desktop');
+        moduleLogModel.open('module');
+        if(Qt.platform.os !== 'windows')
+            authdLogModel.open('authd');
     }
 }
@@ -81,7 +81,7 @@ void PAMHelper::AddToConfig(const std::string &configName, const std::string &en
       fileStr = fmt::format(PAM_CONFIG_GEN_SYSTEM, entry, PAM_CONFIG_GEN_ENTRY);
     else
       fileStr = fmt::format(PAM_CONFIG_GEN_COMMON, entry, PAM_CONFIG_GEN_ENTRY);
-    if(!Shell::WriteBytes(configPath, {fileStr.begin(), fileStr.end()}))
+    if(!Shell::WriteBytesAtomic(configPath, {fileStr.begin(), fileStr.end()}))
       throw std::runtime_error(I18n::Get("error_file_write", configPath.string()));
 
     if(!hasCommonAuth && !hasSystemAuth)
@@ -125,7 +125,7 @@ void PAMHelper::AddEntryToFile(const std::filesystem::path &filePath, const std:
       resultStr.append(line + '\n');
     }
   }
-  if(!Shell::WriteBytes(filePath, {resultStr.begin(), resultStr.end()}))
+  if(!Shell::WriteBytesAtomic(filePath, {resultStr.begin(), resultStr.end()}))
     throw std::runtime_error(I18n::Get("error_file_write", filePath.string()));
 }
 
@@ -148,7 +148,7 @@ void PAMHelper::RemoveEntryFromFile(const std::filesystem::path &filePath, const
       resultStr.append(line + '\n');
   }
 
-  if(!Shell::WriteBytes(filePath, {resultStr.begin(), resultStr.end()}))
+  if(!Shell::WriteBytesAtomic(filePath, {resultStr.begin(), resultStr.end()}))
     throw std::runtime_error(I18n::Get("error_file_write", filePath.string()));
 }
 
@@ -191,7 +191,7 @@ POLKIT_FOUND:
     fileStr = StringUtils::Replace(fileStr, "DeviceAllow=", "#DeviceAllow=");
     fileStr = StringUtils::Replace(fileStr, "DevicePolicy=strict", "#DevicePolicy=strict");
   }
-  if(!Shell::WriteBytes(servicePath.value(), {fileStr.begin(), fileStr.end()})) {
+  if(!Shell::WriteBytesAtomic(servicePath.value(), {fileStr.begin(), fileStr.end()})) {
     m_Logger(I18n::Get("error_file_write", servicePath.value().string()));
     return false;
   }
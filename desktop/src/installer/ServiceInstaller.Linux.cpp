@@ -6,6 +6,7 @@
 
 #define EXE_MODULE_DIR std::filesystem::path("/usr/local/sbin/")
 #define EXE_MODULE_FILE "pcbu_auth"
+#define EXE_DAEMON_FILE "pcbu_authd"
 
 #define PAM_MODULE_DIRS std::vector<std::filesystem::path>{"/lib/security/", "/lib64/security/"}
 #define PAM_MODULE_FILE "pam_pcbiounlock.so"
@@ -26,6 +27,14 @@
 #define CINNAMON_NAME "cinnamon"
 #define HYPRLAND_NAME "hyprlock"
 
+#define AUTH_GRACE_SECONDS 300
+
+// pcbu_authd is installed separately (natives/pcbu-authd/install.sh), its settings do nothing without it
+static bool IsDaemonEnabled() {
+  return std::filesystem::exists(EXE_MODULE_DIR / EXE_DAEMON_FILE) &&
+         Shell::RunUserCommand(fmt::format("systemctl is-enabled {}", EXE_DAEMON_FILE)).exitCode == 0;
+}
+
 ServiceInstaller::ServiceInstaller(const std::function<void(const std::string &)> &logCallback) {
   m_Logger = logCallback;
   m_PAMHelper = PAMHelper(m_Logger);
@@ -38,10 +47,16 @@ std::vector<ServiceSetting> ServiceInstaller::GetSettings() {
                         PAMHelper::HasConfigEntry("hyprlock", PAM_CONFIG_ENTRY);
   auto hasLoginManager = IsProgramInstalled(GDM_NAME) || IsProgramInstalled(SDDM_NAME) || IsProgramInstalled(KDE_NAME) ||
                          IsProgramInstalled(LIGHTDM_NAME) || IsProgramInstalled(CINNAMON_NAME) || IsProgramInstalled(HYPRLAND_NAME);
-  return {{"sudo", I18n::Get("service_setting_sudo"), PAMHelper::HasConfigEntry("sudo", PAM_CONFIG_ENTRY), IsProgramInstalled(SUDO_NAME)},
-          {"polkit", I18n::Get("service_setting_polkit"), PAMHelper::HasConfigEntry("polkit-1", PAM_CONFIG_ENTRY), IsProgramInstalled(POLKIT_NAME)},
-          {"login", I18n::Get("service_setting_login_manager"), isLoginEnabled, hasLoginManager},
-          {"pamSetPassword", I18n::Get("service_setting_pam_set_pw"), AppSettings::Get().unixSetPasswordPAM, false}};
+  auto settings = std::vector<ServiceSetting>{
+      {"sudo", I18n::Get("service_setting_sudo"), PAMHelper::HasConfigEntry("sudo", PAM_CONFIG_ENTRY), IsProgramInstalled(SUDO_NAME)},
+      {"polkit", I18n::Get("service_setting_polkit"), PAMHelper::HasConfigEntry("polkit-1", PAM_CONFIG_ENTRY), IsProgramInstalled(POLKIT_NAME)},
+      {"login", I18n::Get("service_setting_login_manager"), isLoginEnabled, hasLoginManager},
+      {"pamSetPassword", I18n::Get("service_setting_pam_set_pw"), AppSettings::Get()->unixSetPasswordPAM, false}};
+  if(IsDaemonEnabled()) {
+    settings.emplace_back("keepAliveLinks", I18n::Get("service_setting_keep_alive_links"), AppSettings::Get()->unixKeepAliveLinks, false);
+    settings.emplace_back("authGrace", I18n::Get("service_setting_auth_grace"), AppSettings::Get()->unixAuthGraceSeconds > 0, false);
+  }
+  return settings;
 }
 
 void ServiceInstaller::ApplySettings(const std::vector<ServiceSetting> &settings, bool useDefault) {
@@ -65,9 +80,17 @@ void ServiceInstaller::ApplySettings(const std::vector<ServiceSetting> &settings
       if(IsProgramInstalled(HYPRLAND_NAME))
         m_PAMHelper.SetConfigEntry("hyprlock", PAM_CONFIG_ENTRY, isEnabled);
     } else if(setting.id == "pamSetPassword") {
-      auto storage = AppSettings::Get();
+      auto storage = *AppSettings::Get();
       storage.unixSetPasswordPAM = isEnabled;
       AppSettings::Save(storage);
+    } else if(setting.id == "keepAliveLinks") {
+      auto storage = *AppSettings::Get();
+      storage.unixKeepAliveLinks = isEnabled;
+      AppSettings::Save(storage);
+    } else if(setting.id == "authGrace") {
+      auto storage = *AppSettings::Get();
+      storage.unixAuthGraceSeconds = isEnabled ? AUTH_GRACE_SECONDS : 0;
+      AppSettings::Save(storage);
     } else {
       spdlog::warn("Unknown service setting {}.", setting.id);
     }
@@ -108,18 +131,18 @@ void ServiceInstaller::Install() {
   auto settings = AppSettings::Get();
   if(IsProgramInstalled(UFW_NAME)) {
     m_Logger("Adding firewall rules (ufw)...");
-    result = Shell::RunCommand(fmt::format("ufw allow {}/udp", settings.pairingDiscoveryPort)).exitCode == 0 &&
-             Shell::RunCommand(fmt::format("ufw allow {}/tcp", settings.pairingServerPort)).exitCode == 0 &&
-             Shell::RunCommand(fmt::format("ufw allow {}/tcp", settings.unlockServerPort)).exitCode == 0;
+    result = Shell::RunCommand(fmt::format("ufw allow {}/udp", settings->pairingDiscoveryPort)).exitCode == 0 &&
+             Shell::RunCommand(fmt::format("ufw allow {}/tcp", settings->pairingServerPort)).exitCode == 0 &&
+             Shell::RunCommand(fmt::format("ufw allow {}/tcp", settings->unlockServerPort)).exitCode == 0;
     if(!result)
       m_Logger(I18n::Get("error_firewall_rule_add", "ufw"));
   }
   if(IsProgramInstalled(FIREWALLD_NAME)) {
     m_Logger("Adding firewall rules (firewalld)...");
     result =
-        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --add-port={}/udp --permanent", settings.pairingDiscoveryPort)).exitCode == 0 &&
-        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --add-port={}/tcp --permanent", settings.pairingServerPort)).exitCode == 0 &&
-        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --add-port={}/tcp --permanent", settings.unlockServerPort)).exitCode == 0 &&
+        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --add-port={}/udp --permanent", settings->pairingDiscoveryPort)).exitCode == 0 &&
+        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --add-port={}/tcp --permanent", settings->pairingServerPort)).exitCode == 0 &&
+        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --add-port={}/tcp --permanent", settings->unlockServerPort)).exitCode == 0 &&
         Shell::RunCommand("firewall-cmd --reload").exitCode == 0;
     if(!result)
       m_Logger(I18n::Get("error_firewall_rule_add", "firewalld"));
@@ -157,18 +180,18 @@ void ServiceInstaller::Uninstall() {
   auto settings = AppSettings::Get();
   if(IsProgramInstalled(UFW_NAME)) {
     m_Logger("Removing firewall rules (ufw)...");
-    result = Shell::RunCommand(fmt::format("ufw delete allow {}/udp", settings.pairingDiscoveryPort)).exitCode == 0 &&
-             Shell::RunCommand(fmt::format("ufw delete allow {}/tcp", settings.pairingServerPort)).exitCode == 0 &&
-             Shell::RunCommand(fmt::format("ufw delete allow {}/tcp", settings.unlockServerPort)).exitCode == 0;
+    result = Shell::RunCommand(fmt::format("ufw delete allow {}/udp", settings->pairingDiscoveryPort)).exitCode == 0 &&
+             Shell::RunCommand(fmt::format("ufw delete allow {}/tcp", settings->pairingServerPort)).exitCode == 0 &&
+             Shell::RunCommand(fmt::format("ufw delete allow {}/tcp", settings->unlockServerPort)).exitCode == 0;
     if(!result)
       m_Logger(I18n::Get("error_firewall_rule_remove", "ufw"));
   }
   if(IsProgramInstalled(FIREWALLD_NAME)) {
     m_Logger("Removing firewall rules (firewalld)...");
     result =
-        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --remove-port={}/udp --permanent", settings.pairingDiscoveryPort)).exitCode == 0 &&
-        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --remove-port={}/tcp --permanent", settings.pairingServerPort)).exitCode == 0 &&
-        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --remove-port={}/tcp --permanent", settings.unlockServerPort)).exitCode == 0 &&
+        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --remove-port={}/udp --permanent", settings->pairingDiscoveryPort)).exitCode == 0 &&
+        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --remove-port={}/tcp --permanent", settings->pairingServerPort)).exitCode == 0 &&
+        Shell::RunCommand(fmt::format("firewall-cmd --zone=public --remove-port={}/tcp --permanent", settings->unlockServerPort)).exitCode == 0 &&
         Shell::RunCommand("firewall-cmd --reload").exitCode == 0;
     if(!result)
       m_Logger(I18n::Get("error_firewall_rule_remove", "firewalld"));
@@ -37,24 +37,24 @@ std::vector<ServiceSetting> ServiceInstaller::GetSettings() {
            {"key_press", I18n::Get("unlock_behavior_key_press")},
            {"none", I18n::Get("unlock_behavior_none")},
        },
-       AppSettings::Get().winUnlockBehavior, "key_press_lock_only"},
-      {"hidePasswordField", I18n::Get("service_setting_hide_pw_field"), AppSettings::Get().winHidePasswordField, false},
-      {"forceCredProv", I18n::Get("service_setting_force_cred_prov"), AppSettings::Get().winForceDefaultCredProv, true},
+       AppSettings::Get()->winUnlockBehavior, "key_press_lock_only"},
+      {"hidePasswordField", I18n::Get("service_setting_hide_pw_field"), AppSettings::Get()->winHidePasswordField, false},
+      {"forceCredProv", I18n::Get("service_setting_force_cred_prov"), AppSettings::Get()->winForceDefaultCredProv, true},
   };
 }
 
 void ServiceInstaller::ApplySettings(const std::vector<ServiceSetting> &settings, bool useDefault) {
   for(auto setting : settings) {
     if(setting.id == "unlockBehavior") {
-      auto storage = AppSettings::Get();
+      auto storage = *AppSettings::Get();
       storage.winUnlockBehavior = useDefault ? setting.defaultValue : setting.selectedValue;
       AppSettings::Save(storage);
     } else if(setting.id == "hidePasswordField") {
-      auto storage = AppSettings::Get();
+      auto storage = *AppSettings::Get();
       storage.winHidePasswordField = useDefault ? setting.defaultVal : setting.enabled;
       AppSettings::Save(storage);
     } else if(setting.id == "forceCredProv") {
-      auto storage = AppSettings::Get();
+      auto storage = *AppSettings::Get();
       storage.winForceDefaultCredProv = useDefault ? setting.defaultVal : setting.enabled;
       AppSettings::Save(storage);
     } else {
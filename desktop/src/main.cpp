@@ -3,6 +3,7 @@
 #include <QQmlApplicationEngine>
 
 #include "storage/LoggingSystem.h"
+#include "storage/StorageWatcher.h"
 
 int main(int argc, char *argv[]) {
   qputenv("QT_QUICK_CONTROLS_STYLE", QByteArray("Material"));
@@ -27,7 +28,11 @@ int main(int argc, char *argv[]) {
       Qt::QueuedConnection);
   engine.load(url);
 
+  // Picks up changes of pcbu_auth or a second instance while the window is open
+  StorageWatcher storageWatcher{};
+  storageWatcher.Start();
   auto result = QGuiApplication::exec();
+  storageWatcher.Stop();
   LoggingSystem::Destroy();
   return result;
 }
@@ -22,7 +22,7 @@ bool MainWindow::IsPaired() {
 }
 
 QString MainWindow::GetInstalledVersion() {
-  auto installedVersion = AppSettings::Get().installedVersion;
+  auto installedVersion = AppSettings::Get()->installedVersion;
   if(installedVersion.empty())
     return QString::fromUtf8(I18n::Get("installed_version_none"));
   return QString::fromUtf8(installedVersion);
@@ -68,7 +68,7 @@ bool MainWindow::PerformStartupChecks(QObject *viewLoader, QObject *window) {
   }
 #endif
 #endif
-  const auto installedVersion = AppSettings::Get().installedVersion;
+  const auto installedVersion = AppSettings::Get()->installedVersion;
   if(ServiceInstaller::IsInstalled() && (AppInfo::CompareVersion(installedVersion, AppInfo::GetVersion()) == 1 || installedVersion.empty()))
     OnReinstallClicked(window);
   return true;
@@ -43,9 +43,9 @@ std::string PairingForm::BuildPairingPayload() {
   auto settings = AppSettings::Get();
   auto method = PairingMethodUtils::FromString(m_PairingData.pairingMethod.toStdString());
   if(m_PairingData.useLegacyPairing) {
-    return LegacyPairingQRData(NetworkHelper::GetSavedNetworkInterface().ipAddress, settings.pairingServerPort, method, m_EncKey).ToJson().dump();
+    return LegacyPairingQRData(NetworkHelper::GetSavedNetworkInterface().ipAddress, settings->pairingServerPort, method, m_EncKey).ToJson().dump();
   }
-  return PairingQRData(m_ServerId, settings.pairingDiscoveryPort, method, m_EncKey).ToJson().dump();
+  return PairingQRData(m_ServerId, settings->pairingDiscoveryPort, method, m_EncKey).ToJson().dump();
 }
 
 bool PairingForm::HasBluetooth() {
@@ -79,7 +79,7 @@ void SettingsForm::RemoveUDPDevices() {
 }
 
 void SettingsForm::Show(QObject *viewLoader) {
-  m_EditSettings = AppSettingsModel(AppSettings::Get());
+  m_EditSettings = AppSettingsModel(*AppSettings::Get());
   m_EditServiceSettings = ServiceInstaller().GetSettings();
   QMetaObject::invokeMethod(viewLoader, "setSource", Q_ARG(QUrl, QUrl("qrc:/ui/forms/SettingsForm.qml")));
 }
@@ -2,6 +2,8 @@
 
 UnlockTestWindow::~UnlockTestWindow() {
   m_IsRunning.store(false);
+  if(m_UnlockHandler)
+    m_UnlockHandler->Cancel();
   if(m_UnlockThread.joinable())
     m_UnlockThread.join();
 }
@@ -12,7 +14,7 @@ bool UnlockTestWindow::IsRunning() {
 
 void UnlockTestWindow::StartUnlock(QObject *window, const QString& deviceId) {
   auto device = PairedDevicesStorage::GetDeviceByID(deviceId.toStdString());
-  if(!device.has_value()) {
+  if(device == nullptr) {
     QMetaObject::invokeMethod(window, "close");
     return;
   }
@@ -27,7 +29,7 @@ void UnlockTestWindow::StartUnlock(QObject *window, const QString& deviceId) {
   m_IsRunning.store(true);
   m_UnlockThread = std::thread([this, window, device]() {
     QMetaObject::invokeMethod(window, "setUnlockButtonText", Q_ARG(QVariant, QString::fromUtf8(I18n::Get("cancel"))));
-    m_UnlockHandler->GetResult(device.value().userName, I18n::Get("unlock_test"), &m_IsRunning);
+    m_UnlockHandler->GetResult(device->userName, I18n::Get("unlock_test"));
     QMetaObject::invokeMethod(window, "setUnlockButtonText", Q_ARG(QVariant, QString::fromUtf8(I18n::Get("retry"))));
     m_IsRunning.store(false);
   });
@@ -35,6 +37,8 @@ void UnlockTestWindow::StartUnlock(QObject *window, const QString& deviceId) {
 
 void UnlockTestWindow::StopUnlock(QObject *window) {
   m_IsRunning.store(false);
+  if(m_UnlockHandler)
+    m_UnlockHandler->Cancel();
   if(m_UnlockThread.joinable())
     m_UnlockThread.join();
   QMetaObject::invokeMethod(window, "setUnlockMessage", Q_ARG(QVariant, QString::fromUtf8(I18n::Get("unlock_canceled"))));
@@ -3,6 +3,26 @@
 #include "storage/PairedDevicesStorage.h"
 
 DevicesTableModel::DevicesTableModel(QObject *parent) : QAbstractTableModel(parent) {
+  LoadDevices();
+  // Devices paired or removed by another process, called from the storage watcher thread
+  m_DevicesSubscription = PairedDevicesStorage::Subscribe([this](const std::vector<PairedDevicePtr> &) {
+    QMetaObject::invokeMethod(
+        this,
+        [this] {
+          beginResetModel();
+          m_TableData.clear();
+          LoadDevices();
+          endResetModel();
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+DevicesTableModel::~DevicesTableModel() {
+  PairedDevicesStorage::Unsubscribe(m_DevicesSubscription);
+}
+
+void DevicesTableModel::LoadDevices() {
   for(const auto &device : PairedDevicesStorage::GetDevices()) {
     auto pairingId = QString::fromUtf8(device.id);
     auto deviceName = QString::fromUtf8(device.deviceName);
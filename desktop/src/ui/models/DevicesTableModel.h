@@ -11,6 +11,7 @@ class DevicesTableModel : public QAbstractTableModel {
 
 public:
   explicit DevicesTableModel(QObject *parent = nullptr);
+  ~DevicesTableModel() override;
 
   Q_INVOKABLE QVector<QString> get(int rowIdx);
 
@@ -20,7 +21,10 @@ public:
   [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
 
 private:
+  void LoadDevices();
+
   QVector<QVector<QString>> m_TableData{};
+  int m_DevicesSubscription = -1;
 };
 
 #endif // PCBU_DESKTOP_DEVICESTABLEMODEL_H
@@ -0,0 +1,251 @@
+#include "LogListModel.h"
+
+#include <spdlog/spdlog.h>
+
+#include "storage/AppSettings.h"
+
+constexpr qint64 CHUNK_SIZE = 64 * 1024;
+constexpr int CACHE_ROWS = 256;
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(500);
+// spdlog level names, the index is the level
+constexpr std::string_view LOG_LEVELS[] = {"trace", "debug", "info", "warning", "error", "critical"};
+
+LogListModel::LogListModel(QObject *parent) : QAbstractListModel(parent) {}
+
+LogListModel::~LogListModel() {
+  StopWorker();
+}
+
+Q_INVOKABLE void LogListModel::open(const QString &logName) {
+  StopWorker();
+  // Lines of this process may still be queued by the async logger
+  spdlog::default_logger()->flush();
+  m_FilePath = QString::fromStdString((AppSettings::GetBaseDir() / fmt::format("{}.log", logName.toStdString())).string());
+  m_IsStopping = false;
+  m_WorkerThread = std::thread(&LogListModel::WorkerThread, this, m_FilePath);
+}
+
+Q_INVOKABLE void LogListModel::setFilter(const QString &minLevel, const QString &search) {
+  auto filter = LogFilter();
+  filter.minLevel = minLevel.isEmpty() ? -1 : GetLevel(QByteArray("[] [") + minLevel.toUtf8() + "]");
+  filter.search = search;
+  {
+    std::lock_guard lock(m_WorkerMutex);
+    m_Filter = filter;
+    m_IsRestarting = true;
+  }
+  m_WorkerCondition.notify_all();
+}
+
+int LogListModel::rowCount(const QModelIndex &parent) const {
+  if(parent.isValid())
+    return 0;
+  return (int)m_Rows.size();
+}
+
+QVariant LogListModel::data(const QModelIndex &index, int role) const {
+  if(!hasIndex(index.row(), index.column(), index.parent()))
+    return {};
+  auto row = index.row();
+  if(row < m_CacheFirstRow || row >= m_CacheFirstRow + m_CacheLines.size())
+    LoadRows(row);
+  const auto &text = m_CacheLines.at(row - m_CacheFirstRow);
+  if(role == LogTextRole)
+    return text;
+  if(role == LogLevelRole) {
+    auto level = GetLevel(text.left(40).toUtf8());
+    return level != -1 ? QString::fromUtf8(LOG_LEVELS[level].data(), (qsizetype)LOG_LEVELS[level].size()) : QString();
+  }
+  return {};
+}
+
+QHash<int, QByteArray> LogListModel::roleNames() const {
+  return {{LogTextRole, "logText"}, {LogLevelRole, "logLevel"}};
+}
+
+void LogListModel::StopWorker() {
+  {
+    std::lock_guard lock(m_WorkerMutex);
+    m_IsStopping = true;
+  }
+  m_WorkerCondition.notify_all();
+  if(m_WorkerThread.joinable())
+    m_WorkerThread.join();
+}
+
+void LogListModel::WorkerThread(const QString &filePath) {
+  std::unique_lock lock(m_WorkerMutex);
+  while(!m_IsStopping) {
+    // Starts over after a filter change or when the file was rotated
+    m_IsRestarting = false;
+    auto filter = m_Filter;
+    auto generation = ++m_Generation;
+    lock.unlock();
+    Post(generation, [this] {
+      beginResetModel();
+      m_Rows.clear();
+      m_CacheLines.clear();
+      m_CacheFirstRow = 0;
+      endResetModel();
+    });
+    IndexFile(filePath, filter, generation);
+    lock.lock();
+  }
+}
+
+void LogListModel::IndexFile(const QString &filePath, const LogFilter &filter, uint64_t generation) {
+  // Newest lines first, each chunk is shown as soon as it is indexed
+  qint64 linesEnd{};
+  QFile file(filePath);
+  if(file.open(QIODevice::ReadOnly)) {
+    linesEnd = FindLinesEnd(file, file.size());
+    auto position = linesEnd;
+    auto chunkSize = CHUNK_SIZE;
+    while(position > 0 && IsCurrent(generation)) {
+      auto start = std::max<qint64>(0, position - chunkSize);
+      if(!file.seek(start))
+        break;
+      auto data = file.read(position - start);
+      if(data.size() != position - start)
+        break;
+      qint64 firstLine{};
+      if(start > 0) {
+        // The first line continues in the previous chunk
+        auto newline = data.indexOf('\n');
+        if(newline == -1) {
+          chunkSize *= 2;
+          continue;
+        }
+        firstLine = newline + 1;
+      }
+      auto lines = SplitLines(data.mid(firstLine), start + firstLine, filter);
+      if(!lines.empty()) {
+        Post(generation, [this, lines = std::move(lines)] {
+          beginInsertRows({}, 0, (int)lines.size() - 1);
+          m_Rows.insert(m_Rows.begin(), lines.begin(), lines.end());
+          m_CacheFirstRow += (int)lines.size();
+          endInsertRows();
+        });
+      }
+      position = start + firstLine;
+      chunkSize = CHUNK_SIZE;
+    }
+    file.close();
+  }
+
+  // New lines are appended, a smaller file means it was rotated
+  while(true) {
+    {
+      std::unique_lock lock(m_WorkerMutex);
+      m_WorkerCondition.wait_for(lock, POLL_INTERVAL, [&] { return !IsCurrent(generation); });
+    }
+    if(!IsCurrent(generation))
+      return;
+    if(!file.open(QIODevice::ReadOnly))
+      continue;
+    auto size = file.size();
+    if(size < linesEnd)
+      return;
+    QByteArray data{};
+    if(size > linesEnd && file.seek(linesEnd))
+      data = file.read(size - linesEnd);
+    file.close();
+    auto lastNewline = data.lastIndexOf('\n');
+    if(lastNewline == -1)
+      continue;
+    auto lines = SplitLines(data.left(lastNewline + 1), linesEnd, filter);
+    linesEnd += lastNewline + 1;
+    if(!lines.empty()) {
+      Post(generation, [this, lines = std::move(lines)] {
+        beginInsertRows({}, (int)m_Rows.size(), (int)(m_Rows.size() + lines.size()) - 1);
+        m_Rows.insert(m_Rows.end(), lines.begin(), lines.end());
+        endInsertRows();
+      });
+    }
+  }
+}
+
+bool LogListModel::IsCurrent(uint64_t generation) const {
+  return !m_IsStopping && !m_IsRestarting && m_Generation == generation;
+}
+
+void LogListModel::Post(uint64_t generation, std::function<void()> func) {
+  // Results of an older generation are dropped, the model was reset since
+  QMetaObject::invokeMethod(
+      this,
+      [this, generation, func = std::move(func)] {
+        if(m_Generation == generation)
+          func();
+      },
+      Qt::QueuedConnection);
+}
+
+void LogListModel::LoadRows(int row) const {
+  m_CacheFirstRow = std::max(0, row - CACHE_ROWS / 2);
+  auto lastRow = std::min((int)m_Rows.size(), m_CacheFirstRow + CACHE_ROWS);
+  m_CacheLines.clear();
+  m_CacheLines.reserve(lastRow - m_CacheFirstRow);
+  // Opened for each batch, so the logger can still rotate the file on Windows
+  QFile file(m_FilePath);
+  auto isOpen = file.open(QIODevice::ReadOnly);
+  for(auto i = m_CacheFirstRow; i < lastRow; i++) {
+    const auto &line = m_Rows.at(i);
+    if(isOpen && file.seek(line.offset))
+      m_CacheLines.append(QString::fromUtf8(file.read(line.length)));
+    else
+      m_CacheLines.append({});
+  }
+}
+
+qint64 LogListModel::FindLinesEnd(QFile &file, qint64 size) {
+  // A line that is still being written is picked up once it is complete
+  for(auto end = size; end > 0;) {
+    auto start = std::max<qint64>(0, end - CHUNK_SIZE);
+    if(!file.seek(start))
+      return 0;
+    auto data = file.read(end - start);
+    if(auto newline = data.lastIndexOf('\n'); newline != -1)
+      return start + newline + 1;
+    end = start;
+  }
+  return 0;
+}
+
+std::vector<LogListModel::LogLine> LogListModel::SplitLines(const QByteArray &data, qint64 dataOffset, const LogFilter &filter) {
+  std::vector<LogLine> lines{};
+  qsizetype lineStart{};
+  while(lineStart < data.size()) {
+    auto lineEnd = data.indexOf('\n', lineStart);
+    if(lineEnd == -1)
+      lineEnd = data.size();
+    auto length = lineEnd - lineStart;
+    if(length > 0 && data.at(lineEnd - 1) == '\r')
+      length--;
+    auto line = QByteArrayView(data.constData() + lineStart, length);
+    // Lines without a level, e.g. continued messages, only show without a level filter
+    auto isMatch = filter.minLevel == -1 || GetLevel(line) >= filter.minLevel;
+    if(isMatch && !filter.search.isEmpty())
+      isMatch = QString::fromUtf8(line).contains(filter.search, Qt::CaseInsensitive);
+    if(isMatch)
+      lines.push_back({dataOffset + lineStart, length});
+    lineStart = lineEnd + 1;
+  }
+  return lines;
+}
+
+int LogListModel::GetLevel(QByteArrayView line) {
+  // [2024-01-01 12:00:00.000] [info] Message
+  auto levelStart = line.indexOf("] [");
+  if(levelStart == -1)
+    return -1;
+  levelStart += 3;
+  auto levelEnd = line.indexOf(']', levelStart);
+  if(levelEnd == -1)
+    return -1;
+  auto level = std::string_view(line.constData() + levelStart, levelEnd - levelStart);
+  for(size_t i = 0; i < std::size(LOG_LEVELS); i++) {
+    if(LOG_LEVELS[i] == level)
+      return (int)i;
+  }
+  return -1;
+}
@@ -0,0 +1,69 @@
+#ifndef PCBU_DESKTOP_LOGLISTMODEL_H
+#define PCBU_DESKTOP_LOGLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QFile>
+#include <QtQmlIntegration>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Lines of one log file. A worker thread indexes line offsets from the end of the file backwards, so the newest
+// lines show up right away, then follows the file as it grows. Only the rows the view shows are read from the file.
+class LogListModel : public QAbstractListModel {
+  Q_OBJECT
+  QML_ELEMENT
+  enum LogListRoles { LogTextRole = Qt::UserRole + 1, LogLevelRole };
+
+public:
+  explicit LogListModel(QObject *parent = nullptr);
+  ~LogListModel() override;
+
+  // Shows <logName>.log from the base directory
+  Q_INVOKABLE void open(const QString &logName);
+  // Shows lines of at least minLevel (e.g. "warning") that contain search, empty values show all lines
+  Q_INVOKABLE void setFilter(const QString &minLevel, const QString &search);
+
+  [[nodiscard]] int rowCount(const QModelIndex &parent) const override;
+  [[nodiscard]] QVariant data(const QModelIndex &index, int role) const override;
+  [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
+
+private:
+  struct LogLine {
+    qint64 offset{};
+    qint64 length{};
+  };
+  struct LogFilter {
+    int minLevel = -1;
+    QString search{};
+  };
+
+  void StopWorker();
+  void WorkerThread(const QString &filePath);
+  void IndexFile(const QString &filePath, const LogFilter &filter, uint64_t generation);
+  [[nodiscard]] bool IsCurrent(uint64_t generation) const;
+  void Post(uint64_t generation, std::function<void()> func);
+  void LoadRows(int row) const;
+
+  static qint64 FindLinesEnd(QFile &file, qint64 size);
+  static std::vector<LogLine> SplitLines(const QByteArray &data, qint64 dataOffset, const LogFilter &filter);
+  static int GetLevel(QByteArrayView line);
+
+  QString m_FilePath{};
+  std::deque<LogLine> m_Rows{};
+  mutable int m_CacheFirstRow{};
+  mutable QVector<QString> m_CacheLines{};
+
+  std::thread m_WorkerThread{};
+  std::mutex m_WorkerMutex{};
+  std::condition_variable m_WorkerCondition{};
+  LogFilter m_Filter{};
+  std::atomic<bool> m_IsStopping{};
+  std::atomic<bool> m_IsRestarting{};
+  std::atomic<uint64_t> m_Generation{};
+};
+
+#endif // PCBU_DESKTOP_LOGLISTMODEL_H
@@ -4,6 +4,8 @@
 #include <boost/process/v2/stdio.hpp>
 #include <spdlog/spdlog.h>
 
+#include "connection/daemon/AuthDaemonClient.h"
+
 #define PAM_SM_AUTH
 #include <security/pam_modules.h>
 
@@ -27,22 +29,20 @@ static int print_pam(struct pam_conv *conv, const std::string &message) {
   return PAM_SUCCESS;
 }
 
-int pam_sm_authenticate(pam_handle_t *pamh, int flags, int argc, const char **argv) {
-  const char *userName = nullptr;
-  const char *serviceName = nullptr;
-  struct pam_conv *conv = nullptr;
-  auto statusCode = pam_get_item(pamh, PAM_SERVICE, reinterpret_cast<const void **>(&serviceName));
-  if(statusCode == PAM_SUCCESS) {
-    statusCode = pam_get_user(pamh, (const char **)&userName, nullptr);
-    if(statusCode == PAM_SUCCESS) {
-      statusCode = pam_get_item(pamh, PAM_CONV, (const void **)&conv);
+static int get_pam_result(pam_handle_t *pamh, int exitCode, const std::string &password) {
+  if(exitCode == 0) {
+    if(!password.empty() && password[0] != '\0') {
+      pam_set_item(pamh, PAM_AUTHTOK, password.c_str());
+      return PAM_IGNORE;
     }
+    return PAM_SUCCESS;
   }
-  if(statusCode != PAM_SUCCESS) {
-    spdlog::error("Failed to get PAM user info.");
-    return PAM_IGNORE;
-  }
+  if(exitCode == 1)
+    return PAM_AUTH_ERR;
+  return PAM_IGNORE;
+}
 
+static int run_pcbu_auth(pam_handle_t *pamh, const char *userName, struct pam_conv *conv) {
   int pipeFd[2]{};
   bool hasPipe = false;
   if(!pipe(pipeFd)) {
@@ -98,23 +98,36 @@ int pam_sm_authenticate(pam_handle_t *pamh, int flags, int argc, const char **ar
       close(pipeFd[0]);
     }
 
-    auto result = proc.exit_code();
-    if(result == 0) {
-      if(!password.empty() && password[0] != '\0') {
-        pam_set_item(pamh, PAM_AUTHTOK, password.c_str());
-      } else {
-        pamResult = PAM_SUCCESS;
-      }
-    }
-    if(result == 1) {
-      pamResult = PAM_AUTH_ERR;
-    }
+    pamResult = get_pam_result(pamh, proc.exit_code(), password);
   } catch(const std::exception &ex) {
     spdlog::error("Installation is corrupt. {}", ex.what());
   }
   return pamResult;
 }
 
+int pam_sm_authenticate(pam_handle_t *pamh, int flags, int argc, const char **argv) {
+  const char *userName = nullptr;
+  const char *serviceName = nullptr;
+  struct pam_conv *conv = nullptr;
+  auto statusCode = pam_get_item(pamh, PAM_SERVICE, reinterpret_cast<const void **>(&serviceName));
+  if(statusCode == PAM_SUCCESS) {
+    statusCode = pam_get_user(pamh, (const char **)&userName, nullptr);
+    if(statusCode == PAM_SUCCESS) {
+      statusCode = pam_get_item(pamh, PAM_CONV, (const void **)&conv);
+    }
+  }
+  if(statusCode != PAM_SUCCESS) {
+    spdlog::error("Failed to get PAM user info.");
+    return PAM_IGNORE;
+  }
+
+  // Prefer the running daemon, pcbu_auth is started for every request
+  auto daemonResult = AuthDaemonClient::Authenticate(userName, [conv](const std::string &message) { print_pam(conv, message); });
+  if(daemonResult.has_value())
+    return get_pam_result(pamh, daemonResult->exitCode, daemonResult->password);
+  return run_pcbu_auth(pamh, userName, conv);
+}
+
 int pam_sm_setcred(pam_handle_t *pamh, int flags, int argc, const char **argv) {
   return PAM_SUCCESS;
 }
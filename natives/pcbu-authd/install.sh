@@ -0,0 +1,6 @@
+#!/bin/bash
+cd cmake-build-debug || exit
+cmake ..
+cd ..
+cmake --build ./cmake-build-debug --target all
+su -c "cp cmake-build-debug/pcbu_authd /usr/local/sbin/pcbu_authd && chmod 700 /usr/local/sbin/pcbu_authd && cp pcbu_authd.service /etc/systemd/system/ && systemctl daemon-reload && systemctl enable --now pcbu_authd"
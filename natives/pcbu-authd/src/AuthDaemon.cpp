@@ -0,0 +1,334 @@
+#include "AuthDaemon.h"
+
+#include <cstring>
+#include <pwd.h>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "connection/SocketDefs.h"
+#include "connection/daemon/AuthDaemonClient.h"
+#include "handler/UnlockHandler.h"
+#include "platform/PlatformHelper.h"
+#include "storage/AppSettings.h"
+#include "storage/PairedDevicesStorage.h"
+#include "utils/I18n.h"
+
+constexpr size_t NUM_WORKERS = 4;
+constexpr int LISTEN_BACKLOG = 16;
+constexpr auto REQUEST_TIMEOUT = std::chrono::seconds(5);
+constexpr auto WRITE_TIMEOUT = std::chrono::seconds(5);
+
+AuthDaemon::AuthDaemon() : m_Workers(NUM_WORKERS), m_SessionMonitor(m_GraceCache) {}
+
+AuthDaemon::~AuthDaemon() {
+  Stop();
+}
+
+bool AuthDaemon::Start() {
+  if(m_IsRunning)
+    return true;
+  if(!m_Notifier.Open() || !m_UnlockNotifier.Open()) {
+    spdlog::error("Failed to create notifier socket.");
+    m_Notifier.Close();
+    return false;
+  }
+
+  // Anyone may connect, requests are checked against the peer credentials
+  unlink(AUTHD_SOCKET_PATH);
+  struct sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, AUTHD_SOCKET_PATH, sizeof(address.sun_path) - 1);
+  m_ServerSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(m_ServerSocket == SOCKET_INVALID) {
+    spdlog::error("socket() failed. (Code={})", SOCKET_LAST_ERROR);
+    m_Notifier.Close();
+    m_UnlockNotifier.Close();
+    return false;
+  }
+  if(bind(m_ServerSocket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0 || chmod(AUTHD_SOCKET_PATH, 0666) != 0 ||
+     listen(m_ServerSocket, LISTEN_BACKLOG) != 0 || !SetSocketBlocking(m_ServerSocket, false)) {
+    spdlog::error("Failed to listen on {}. (Code={})", AUTHD_SOCKET_PATH, SOCKET_LAST_ERROR);
+    SOCKET_CLOSE(m_ServerSocket);
+    m_Notifier.Close();
+    m_UnlockNotifier.Close();
+    return false;
+  }
+
+  // Load language tables and settings once instead of on every request
+  I18n::Get("wait_server_phone_connect");
+  if(AppSettings::Get()->unixKeepAliveLinks)
+    m_KeepAliveLinks.Sync(PairedDevicesStorage::GetDevices());
+  WatchStorage();
+  if(!m_SessionMonitor.Start())
+    spdlog::warn("Grace windows are not ended by screen locks and logouts.");
+
+  m_IsRunning = true;
+  m_AcceptThread = std::thread(&AuthDaemon::AcceptThread, this);
+  spdlog::info("pcbu_authd listening on {}.", AUTHD_SOCKET_PATH);
+  return true;
+}
+
+void AuthDaemon::Stop() {
+  if(!m_IsRunning)
+    return;
+  m_IsRunning = false;
+  m_StorageWatcher.Stop();
+  AppSettings::Unsubscribe(m_SettingsSubscription);
+  PairedDevicesStorage::Unsubscribe(m_DevicesSubscription);
+  m_Notifier.Notify();
+  m_UnlockNotifier.Notify();
+  if(m_AcceptThread.joinable())
+    m_AcceptThread.join();
+  m_Workers.Stop();
+  m_KeepAliveLinks.Stop();
+  m_SessionMonitor.Stop();
+  m_GraceCache.Clear();
+  SOCKET_CLOSE(m_ServerSocket);
+  unlink(AUTHD_SOCKET_PATH);
+  m_Notifier.Close();
+  m_UnlockNotifier.Close();
+}
+
+void AuthDaemon::AcceptThread() {
+  struct pollfd pollFds[2]{};
+  pollFds[0].fd = m_Notifier.GetSocket();
+  pollFds[0].events = POLLIN;
+  pollFds[1].fd = m_ServerSocket;
+  pollFds[1].events = POLLIN;
+  while(m_IsRunning) {
+    if(SOCKET_POLL(pollFds, 2, -1) < 0) {
+      auto error = SOCKET_LAST_ERROR;
+      if(error == SOCKET_ERROR_INTERRUPTED)
+        continue;
+      spdlog::error("poll() failed. (Code={})", error);
+      break;
+    }
+    if(pollFds[0].revents != 0)
+      m_Notifier.Drain();
+    if(pollFds[1].revents == 0)
+      continue;
+
+    SOCKET clientSocket = accept(m_ServerSocket, nullptr, nullptr);
+    if(clientSocket == SOCKET_INVALID)
+      continue;
+    fcntl(clientSocket, F_SETFD, FD_CLOEXEC);
+    if(!SetSocketBlocking(clientSocket, false)) {
+      spdlog::error("Failed to set socket to non-blocking mode.");
+      SOCKET_CLOSE(clientSocket);
+      continue;
+    }
+    PeerInfo peer{};
+    if(!GetPeerInfo(clientSocket, peer)) {
+      SOCKET_CLOSE(clientSocket);
+      continue;
+    }
+
+    // One request per user, so nobody can keep all workers busy with requests that never finish
+    bool isPending{};
+    {
+      std::lock_guard peersLock(m_PeersMutex);
+      isPending = !m_PendingPeers.insert(peer.uid).second;
+    }
+    if(isPending) {
+      spdlog::warn("Rejected auth request, the peer has one pending. (PeerUID={})", peer.uid);
+      WriteResult(clientSocket, PacketAuthResult{-1});
+      SOCKET_CLOSE(clientSocket);
+      continue;
+    }
+    auto request = std::make_shared<PendingRequest>(this, clientSocket, peer);
+    m_Workers.Post([this, request] { HandleClient(request->clientSocket, request->peer); });
+  }
+}
+
+AuthDaemon::PendingRequest::~PendingRequest() {
+  SOCKET_CLOSE(clientSocket);
+  daemon->ReleasePeer(peer.uid);
+}
+
+void AuthDaemon::ReleasePeer(uid_t uid) {
+  std::lock_guard peersLock(m_PeersMutex);
+  m_PendingPeers.erase(uid);
+}
+
+void AuthDaemon::HandleClient(SOCKET clientSocket, const PeerInfo &peer) {
+  auto packet = ReadPacket(clientSocket, REQUEST_TIMEOUT);
+  auto request = packet.error == PacketError::NONE && packet.id == PACKET_ID_AUTH_REQUEST
+                     ? PacketAuthRequest::FromJson(std::string(packet.data.begin(), packet.data.end()))
+                     : std::nullopt;
+  auto result = PacketAuthResult{-1};
+  if(!request.has_value()) {
+    spdlog::error("Invalid auth request. (ID={0:X}, PacketError={1})", packet.id, static_cast<int>(packet.error));
+  } else if(!IsPeerAllowed(peer, request->userName)) {
+    spdlog::warn("Rejected auth request. (User={}, PeerUID={})", request->userName, peer.uid);
+  } else {
+    result = Authenticate(clientSocket, request->userName, peer);
+  }
+  WriteResult(clientSocket, result);
+}
+
+PacketAuthResult AuthDaemon::Authenticate(SOCKET clientSocket, const std::string &userName, const PeerInfo &peer) {
+  auto serviceName = GetServiceName(peer);
+  auto programName = serviceName.substr(0, serviceName.find(' '));
+  auto graceWindow = std::chrono::seconds(AppSettings::Get()->unixAuthGraceSeconds);
+  // Only requests of root processes (sudo, polkit) may reuse an unlock. Screen lockers run as the user,
+  // so their requests mean the screen was locked and end the grace window instead. Only the program
+  // counts, so "sudo ls" and "sudo make install" in the same terminal session share a grace window.
+  auto sessionId = getsid(peer.pid);
+  auto graceKey = AuthGraceCache::Key{userName, programName, sessionId};
+  auto loginSession = SessionMonitor::GetLoginSession(peer.pid);
+  // Without a session every such request would share one entry
+  auto useGrace = graceWindow.count() > 0 && peer.uid == 0 && sessionId >= 0 && !m_SessionMonitor.IsLocked(loginSession);
+  if(peer.uid != 0) {
+    m_GraceCache.InvalidateUser(userName);
+  } else if(auto password = useGrace ? m_GraceCache.Find(graceKey, graceWindow) : std::nullopt) {
+    spdlog::info("Reusing recent unlock. (User={}, Service={})", userName, programName);
+    auto result = PacketAuthResult{0};
+    if(AppSettings::Get()->unixSetPasswordPAM)
+      result.password = password.value();
+    return result;
+  }
+
+  // Unlock servers listen on fixed ports, so requests are handled one at a time. Others are answered
+  // right away, so the PAM module falls back to the next module instead of waiting for the phone.
+  std::unique_lock unlockLock(m_UnlockMutex, std::try_to_lock);
+  if(!unlockLock.owns_lock()) {
+    spdlog::info("Another unlock is in progress. (User={}, Service={})", userName, programName);
+    auto busyMsg = I18n::Get("error_unlock_busy");
+    WritePacket(clientSocket, PACKET_ID_AUTH_MESSAGE, {reinterpret_cast<const uint8_t *>(busyMsg.data()), busyMsg.size()}, WRITE_TIMEOUT);
+    return PacketAuthResult{-1};
+  }
+  // Catches changes the storage watcher has not reported yet, links are only changed between unlocks
+  SyncLinks();
+  auto keepAliveLinks = AppSettings::Get()->unixKeepAliveLinks;
+
+  std::mutex writeMutex{};
+  auto handler = UnlockHandler([clientSocket, &writeMutex](const std::string &message) {
+    std::lock_guard writeLock(writeMutex);
+    WritePacket(clientSocket, PACKET_ID_AUTH_MESSAGE, {reinterpret_cast<const uint8_t *>(message.data()), message.size()}, WRITE_TIMEOUT);
+  });
+  auto watchThread = std::thread([&] { WatchClient(clientSocket, handler); });
+  if(keepAliveLinks)
+    handler.SetKeepAliveLinks(&m_KeepAliveLinks);
+  auto unlockResult = handler.GetResult(userName, serviceName);
+  m_UnlockNotifier.Notify();
+  watchThread.join();
+  // A wakeup of Stop() may be dropped here, the next watcher checks m_IsRunning first
+  m_UnlockNotifier.Drain();
+
+  auto result = PacketAuthResult{-1};
+  if(unlockResult.state == UnlockState::SUCCESS) {
+    auto isLoginValid = userName == unlockResult.device.userName &&
+                        PlatformHelper::CheckLogin(userName, unlockResult.password).result == PlatformLoginResult::SUCCESS;
+    handler.GetTrace().Mark("login_checked");
+    if(isLoginValid) {
+      result.exitCode = 0;
+      if(useGrace)
+        m_GraceCache.Add(graceKey, unlockResult.password, loginSession);
+      if(AppSettings::Get()->unixSetPasswordPAM)
+        result.password = unlockResult.password;
+      return result;
+    }
+    auto errorMsg = I18n::Get("error_password");
+    WritePacket(clientSocket, PACKET_ID_AUTH_MESSAGE, {reinterpret_cast<const uint8_t *>(errorMsg.data()), errorMsg.size()}, WRITE_TIMEOUT);
+    result.exitCode = 1;
+  } else if(unlockResult.state == UnlockState::CANCELED) {
+    result.exitCode = 1;
+  }
+  return result;
+}
+
+void AuthDaemon::WatchStorage() {
+  // Callbacks run on the watcher thread, links are synced by a worker since an unlock may hold m_UnlockMutex
+  m_SettingsSubscription = AppSettings::Subscribe([this](const AppSettingsPtr &settings) {
+    if(settings->unixAuthGraceSeconds == 0)
+      m_GraceCache.Clear();
+    m_Workers.Post([this] {
+      std::lock_guard unlockLock(m_UnlockMutex);
+      SyncLinks();
+    });
+  });
+  m_DevicesSubscription = PairedDevicesStorage::Subscribe([this](const std::vector<PairedDevicePtr> &) {
+    // Recent unlocks may belong to a removed device or an outdated password
+    m_GraceCache.Clear();
+    m_Workers.Post([this] {
+      std::lock_guard unlockLock(m_UnlockMutex);
+      SyncLinks();
+    });
+  });
+  if(!m_StorageWatcher.Start())
+    spdlog::warn("Settings and devices are not reloaded automatically.");
+}
+
+void AuthDaemon::SyncLinks() {
+  auto keepAliveLinks = AppSettings::Get()->unixKeepAliveLinks;
+  m_KeepAliveLinks.Sync(keepAliveLinks ? PairedDevicesStorage::GetDevices() : std::vector<PairedDevice>{});
+}
+
+void AuthDaemon::WatchClient(SOCKET clientSocket, UnlockHandler &handler) {
+  // The client sends nothing after its request, so any event means it went away.
+  // The notifier wakes up the watcher when the unlock finished or the daemon stops.
+  struct pollfd pollFds[2]{};
+  pollFds[0].fd = m_UnlockNotifier.GetSocket();
+  pollFds[0].events = POLLIN;
+  pollFds[1].fd = clientSocket;
+  pollFds[1].events = POLLIN;
+  while(m_IsRunning) {
+    if(SOCKET_POLL(pollFds, 2, -1) < 0) {
+      auto error = SOCKET_LAST_ERROR;
+      if(error == SOCKET_ERROR_INTERRUPTED)
+        continue;
+      spdlog::error("poll() failed. (Code={})", error);
+      return;
+    }
+    if(pollFds[1].revents != 0)
+      break;
+    if(pollFds[0].revents != 0 && m_IsRunning)
+      return;
+  }
+  spdlog::info("Canceling auth request.");
+  handler.Cancel();
+}
+
+void AuthDaemon::WriteResult(SOCKET clientSocket, PacketAuthResult result) {
+  auto resultStr = result.ToJson().dump();
+  WritePacket(clientSocket, PACKET_ID_AUTH_RESULT, {reinterpret_cast<const uint8_t *>(resultStr.data()), resultStr.size()}, WRITE_TIMEOUT);
+}
+
+bool AuthDaemon::GetPeerInfo(SOCKET clientSocket, PeerInfo &peer) {
+#ifdef LINUX
+  struct ucred credentials{};
+  socklen_t length = sizeof(credentials);
+  if(getsockopt(clientSocket, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+    spdlog::error("getsockopt(SO_PEERCRED) failed. (Code={})", SOCKET_LAST_ERROR);
+    return false;
+  }
+  peer.uid = credentials.uid;
+  peer.pid = credentials.pid;
+#elif APPLE
+  gid_t gid{};
+  socklen_t length = sizeof(peer.pid);
+  if(getpeereid(clientSocket, &peer.uid, &gid) != 0 || getsockopt(clientSocket, SOL_LOCAL, LOCAL_PEERPID, &peer.pid, &length) != 0) {
+    spdlog::error("Failed to get peer credentials. (Code={})", SOCKET_LAST_ERROR);
+    return false;
+  }
+#endif
+  return true;
+}
+
+std::string AuthDaemon::GetServiceName(const PeerInfo &peer) {
+  auto commandLine = PlatformHelper::GetProcessCommandLine(peer.pid);
+  return commandLine.empty() ? fmt::format("PID {}", peer.pid) : commandLine;
+}
+
+bool AuthDaemon::IsPeerAllowed(const PeerInfo &peer, const std::string &userName) {
+  // Root (sudo, login managers) or the user itself (screen lockers)
+  if(peer.uid == 0)
+    return true;
+  struct passwd pwd{};
+  struct passwd *result{};
+  char buffer[4096]{};
+  if(getpwnam_r(userName.c_str(), &pwd, buffer, sizeof(buffer), &result) != 0 || result == nullptr)
+    return false;
+  return result->pw_uid == peer.uid;
+}
@@ -0,0 +1,74 @@
+#ifndef PCBU_DESKTOP_AUTHDAEMON_H
+#define PCBU_DESKTOP_AUTHDAEMON_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_set>
+
+#include "AuthGraceCache.h"
+#include "SessionMonitor.h"
+#include "connection/BaseConnection.h"
+#include "connection/Packets.h"
+#include "connection/SocketNotifier.h"
+#include "connection/unlock/links/KeepAliveLinkManager.h"
+#include "storage/StorageWatcher.h"
+#include "utils/ThreadPool.h"
+
+class UnlockHandler;
+
+// Serves unlock requests of the PAM module over a Unix socket, so they do not pay for starting pcbu_auth.
+class AuthDaemon : public BaseConnection {
+public:
+  AuthDaemon();
+  ~AuthDaemon() override;
+
+  bool Start();
+  void Stop();
+
+private:
+  struct PeerInfo {
+    uid_t uid{};
+    pid_t pid{};
+  };
+  // Closes the socket and frees the slot of the peer, also when a stopping pool discards the request
+  struct PendingRequest {
+    AuthDaemon *daemon{};
+    SOCKET clientSocket = SOCKET_INVALID;
+    PeerInfo peer{};
+    ~PendingRequest();
+  };
+
+  void AcceptThread();
+  void HandleClient(SOCKET clientSocket, const PeerInfo &peer);
+  void ReleasePeer(uid_t uid);
+  PacketAuthResult Authenticate(SOCKET clientSocket, const std::string &userName, const PeerInfo &peer);
+  void WatchClient(SOCKET clientSocket, UnlockHandler &handler);
+  void WatchStorage();
+  void SyncLinks(); // Requires m_UnlockMutex
+
+  static void WriteResult(SOCKET clientSocket, PacketAuthResult result);
+  static bool GetPeerInfo(SOCKET clientSocket, PeerInfo &peer);
+  static bool IsPeerAllowed(const PeerInfo &peer, const std::string &userName);
+  static std::string GetServiceName(const PeerInfo &peer);
+
+  SOCKET m_ServerSocket = SOCKET_INVALID;
+  SocketNotifier m_Notifier{};
+  SocketNotifier m_UnlockNotifier{}; // Wakes up WatchClient(), unlocks run one at a time
+  std::atomic<bool> m_IsRunning{};
+  std::thread m_AcceptThread{};
+  ThreadPool m_Workers;
+  std::mutex m_PeersMutex{};
+  std::unordered_set<uid_t> m_PendingPeers{};
+  std::mutex m_UnlockMutex{};
+  KeepAliveLinkManager m_KeepAliveLinks{};
+  AuthGraceCache m_GraceCache{};
+  SessionMonitor m_SessionMonitor;
+  StorageWatcher m_StorageWatcher{};
+  int m_SettingsSubscription = -1;
+  int m_DevicesSubscription = -1;
+};
+
+#endif // PCBU_DESKTOP_AUTHDAEMON_H
@@ -0,0 +1,92 @@
+#include "AuthGraceCache.h"
+
+#include <algorithm>
+#include <ctime>
+#include <spdlog/spdlog.h>
+
+// Time the clocks may drift apart without a suspend
+constexpr int64_t SUSPEND_TOLERANCE_NS = 2'000'000'000;
+
+AuthGraceCache::~AuthGraceCache() {
+  Clear();
+}
+
+std::optional<std::string> AuthGraceCache::Find(const Key &key, std::chrono::seconds window) {
+  std::lock_guard lock(m_Mutex);
+  auto it = m_Entries.find(key);
+  if(it == m_Entries.end())
+    return {};
+
+  int64_t awakeTime{}, bootTime{};
+  GetClocks(awakeTime, bootTime);
+  auto elapsed = bootTime - it->second.bootTime;
+  auto suspended = elapsed - (awakeTime - it->second.awakeTime);
+  window = std::min<std::chrono::seconds>(window, MAX_WINDOW);
+  if(elapsed > std::chrono::nanoseconds(window).count() || suspended > SUSPEND_TOLERANCE_NS) {
+    if(suspended > SUSPEND_TOLERANCE_NS)
+      spdlog::info("Grace window of {} ended by suspend.", key.userName);
+    Erase(it);
+    return {};
+  }
+  return it->second.password;
+}
+
+void AuthGraceCache::Add(const Key &key, const std::string &password, const std::string &loginSession) {
+  std::lock_guard lock(m_Mutex);
+  auto it = m_Entries.find(key);
+  if(it != m_Entries.end())
+    Erase(it);
+  auto entry = Entry();
+  GetClocks(entry.awakeTime, entry.bootTime);
+  entry.password = password;
+  entry.loginSession = loginSession;
+  m_Entries.emplace(key, std::move(entry));
+}
+
+void AuthGraceCache::InvalidateUser(const std::string &userName) {
+  std::lock_guard lock(m_Mutex);
+  for(auto it = m_Entries.begin(); it != m_Entries.end();) {
+    if(it->first.userName == userName)
+      it = Erase(it);
+    else
+      ++it;
+  }
+}
+
+void AuthGraceCache::InvalidateLoginSession(const std::string &loginSession) {
+  std::lock_guard lock(m_Mutex);
+  for(auto it = m_Entries.begin(); it != m_Entries.end();) {
+    if(!loginSession.empty() && it->second.loginSession == loginSession)
+      it = Erase(it);
+    else
+      ++it;
+  }
+}
+
+void AuthGraceCache::Clear() {
+  std::lock_guard lock(m_Mutex);
+  for(auto it = m_Entries.begin(); it != m_Entries.end();)
+    it = Erase(it);
+}
+
+std::map<AuthGraceCache::Key, AuthGraceCache::Entry>::iterator AuthGraceCache::Erase(std::map<Key, Entry>::iterator it) {
+  // Do not leave the password in freed memory
+  auto &password = it->second.password;
+  volatile auto *data = password.data();
+  for(size_t i = 0; i < password.size(); i++)
+    data[i] = '\0';
+  return m_Entries.erase(it);
+}
+
+void AuthGraceCache::GetClocks(int64_t &awakeTime, int64_t &bootTime) {
+  struct timespec awake{}, boot{};
+#ifdef APPLE
+  clock_gettime(CLOCK_UPTIME_RAW, &awake);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &boot);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &awake);
+  clock_gettime(CLOCK_BOOTTIME, &boot);
+#endif
+  awakeTime = awake.tv_sec * 1'000'000'000LL + awake.tv_nsec;
+  bootTime = boot.tv_sec * 1'000'000'000LL + boot.tv_nsec;
+}
@@ -0,0 +1,52 @@
+#ifndef PCBU_DESKTOP_AUTHGRACECACHE_H
+#define PCBU_DESKTOP_AUTHGRACECACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// Remembers successful unlocks for a short time, so a sudo right after another one does not ask the phone again.
+// Entries only live in memory of pcbu_authd. SessionMonitor ends them when logind reports a lock, suspend or logout.
+// Without logind, Find() still drops entries that outlived a suspend and the next request of a screen locker drops
+// the entries of its user.
+class AuthGraceCache {
+public:
+  struct Key {
+    std::string userName{};
+    std::string serviceName{};
+    int sessionId{};
+
+    auto operator<=>(const Key &) const = default;
+  };
+
+  ~AuthGraceCache();
+
+  // Returns the password of the unlock that created the entry if it is still valid
+  std::optional<std::string> Find(const Key &key, std::chrono::seconds window);
+  // loginSession is the logind session of the requesting process, empty if it has none
+  void Add(const Key &key, const std::string &password, const std::string &loginSession);
+  void InvalidateUser(const std::string &userName);
+  void InvalidateLoginSession(const std::string &loginSession);
+  void Clear();
+
+  static constexpr auto MAX_WINDOW = std::chrono::minutes(15);
+
+private:
+  struct Entry {
+    int64_t awakeTime{}; // Stops during suspend
+    int64_t bootTime{};  // Continues during suspend
+    std::string password{};
+    std::string loginSession{};
+  };
+
+  std::map<Key, Entry>::iterator Erase(std::map<Key, Entry>::iterator it);
+  static void GetClocks(int64_t &awakeTime, int64_t &bootTime);
+
+  std::map<Key, Entry> m_Entries{};
+  std::mutex m_Mutex{};
+};
+
+#endif // PCBU_DESKTOP_AUTHGRACECACHE_H
@@ -0,0 +1,206 @@
+#include "SessionMonitor.h"
+
+#include <spdlog/spdlog.h>
+
+#ifdef HAVE_LIBSYSTEMD
+#include <cstdlib>
+#include <ctime>
+#include <systemd/sd-bus.h>
+#include <systemd/sd-login.h>
+
+constexpr auto LOGIND_SERVICE = "org.freedesktop.login1";
+constexpr auto LOGIND_PATH = "/org/freedesktop/login1";
+constexpr auto LOGIND_SESSION_PATH = "/org/freedesktop/login1/session";
+constexpr auto LOGIND_MANAGER_INTERFACE = "org.freedesktop.login1.Manager";
+constexpr auto LOGIND_SESSION_INTERFACE = "org.freedesktop.login1.Session";
+#endif
+
+SessionMonitor::SessionMonitor(AuthGraceCache &graceCache) : m_GraceCache(graceCache) {}
+
+SessionMonitor::~SessionMonitor() {
+  Stop();
+}
+
+#ifdef HAVE_LIBSYSTEMD
+bool SessionMonitor::Start() {
+  if(m_IsRunning)
+    return true;
+  if(!m_StopNotifier.Open()) {
+    spdlog::error("Failed to create notifier socket.");
+    return false;
+  }
+  auto result = sd_bus_open_system(&m_Bus);
+  if(result >= 0)
+    result = sd_bus_match_signal(m_Bus, nullptr, LOGIND_SERVICE, nullptr, LOGIND_SESSION_INTERFACE, "Lock", &SessionMonitor::OnLock, this);
+  // Screen lockers report locking through LockedHint, Lock is only sent for "loginctl lock-session"
+  if(result >= 0)
+    result = sd_bus_add_match(m_Bus, nullptr,
+                              "type='signal',sender='org.freedesktop.login1',interface='org.freedesktop.DBus.Properties',"
+                              "member='PropertiesChanged',arg0='org.freedesktop.login1.Session'",
+                              &SessionMonitor::OnPropertiesChanged, this);
+  if(result >= 0)
+    result = sd_bus_match_signal(m_Bus, nullptr, LOGIND_SERVICE, LOGIND_PATH, LOGIND_MANAGER_INTERFACE, "PrepareForSleep",
+                                 &SessionMonitor::OnPrepareForSleep, this);
+  if(result >= 0)
+    result = sd_bus_match_signal(m_Bus, nullptr, LOGIND_SERVICE, LOGIND_PATH, LOGIND_MANAGER_INTERFACE, "SessionRemoved",
+                                 &SessionMonitor::OnSessionRemoved, this);
+  if(result < 0) {
+    spdlog::error("Failed to subscribe to logind. (Code={})", -result);
+    m_Bus = sd_bus_flush_close_unref(m_Bus);
+    m_StopNotifier.Close();
+    return false;
+  }
+  m_IsRunning = true;
+  m_MonitorThread = std::thread(&SessionMonitor::MonitorThread, this);
+  return true;
+}
+
+void SessionMonitor::Stop() {
+  if(!m_IsRunning)
+    return;
+  m_IsRunning = false;
+  m_StopNotifier.Notify();
+  if(m_MonitorThread.joinable())
+    m_MonitorThread.join();
+  m_StopNotifier.Close();
+  m_Bus = sd_bus_flush_close_unref(m_Bus);
+  std::lock_guard lock(m_LockedMutex);
+  m_LockedSessions.clear();
+}
+
+std::string SessionMonitor::GetLoginSession(pid_t pid) {
+  char *session{};
+  if(sd_pid_get_session(pid, &session) < 0)
+    return {};
+  auto result = std::string(session);
+  free(session);
+  return result;
+}
+
+void SessionMonitor::MonitorThread() {
+  while(m_IsRunning) {
+    auto result = sd_bus_process(m_Bus, nullptr);
+    if(result < 0) {
+      spdlog::error("Lost connection to logind. (Code={})", -result);
+      return;
+    }
+    if(result > 0)
+      continue;
+
+    // The bus only has a timeout while it is still connecting
+    uint64_t timeoutUs{};
+    int timeoutMs = -1;
+    if(sd_bus_get_timeout(m_Bus, &timeoutUs) > 0 && timeoutUs != UINT64_MAX) {
+      struct timespec now{};
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      auto nowUs = (uint64_t)now.tv_sec * 1'000'000 + now.tv_nsec / 1'000;
+      timeoutMs = timeoutUs > nowUs ? (int)((timeoutUs - nowUs + 999) / 1'000) : 0;
+    }
+    struct pollfd pollFds[2]{};
+    pollFds[0].fd = m_StopNotifier.GetSocket();
+    pollFds[0].events = POLLIN;
+    pollFds[1].fd = sd_bus_get_fd(m_Bus);
+    pollFds[1].events = (short)sd_bus_get_events(m_Bus);
+    if(SOCKET_POLL(pollFds, 2, timeoutMs) < 0) {
+      auto error = SOCKET_LAST_ERROR;
+      if(error == SOCKET_ERROR_INTERRUPTED)
+        continue;
+      spdlog::error("Session poll() failed. (Code={})", error);
+      return;
+    }
+    if(pollFds[0].revents != 0)
+      return;
+  }
+}
+
+int SessionMonitor::OnLock(sd_bus_message *message, void *userData, sd_bus_error *) {
+  auto monitor = static_cast<SessionMonitor *>(userData);
+  char *userName{};
+  auto sessionId = GetSessionId(message);
+  if(sessionId.empty() || sd_session_get_username(sessionId.c_str(), &userName) < 0)
+    return 0;
+  spdlog::info("Grace window of {} ended by screen lock.", userName);
+  monitor->m_GraceCache.InvalidateUser(userName);
+  free(userName);
+  return 0;
+}
+
+int SessionMonitor::OnPropertiesChanged(sd_bus_message *message, void *userData, sd_bus_error *) {
+  auto monitor = static_cast<SessionMonitor *>(userData);
+  auto sessionId = GetSessionId(message);
+  if(sessionId.empty() || sd_bus_message_skip(message, "s") < 0 || sd_bus_message_enter_container(message, 'a', "{sv}") < 0)
+    return 0;
+  while(sd_bus_message_enter_container(message, 'e', "sv") > 0) {
+    const char *name{};
+    if(sd_bus_message_read(message, "s", &name) < 0)
+      return 0;
+    if(std::string_view(name) != "LockedHint") {
+      if(sd_bus_message_skip(message, "v") < 0)
+        return 0;
+    } else {
+      int isLocked{};
+      if(sd_bus_message_read(message, "v", "b", &isLocked) < 0)
+        return 0;
+      {
+        std::lock_guard lock(monitor->m_LockedMutex);
+        if(isLocked)
+          monitor->m_LockedSessions.insert(sessionId);
+        else
+          monitor->m_LockedSessions.erase(sessionId);
+      }
+      if(isLocked)
+        OnLock(message, userData, nullptr);
+    }
+    if(sd_bus_message_exit_container(message) < 0)
+      return 0;
+  }
+  return 0;
+}
+
+int SessionMonitor::OnPrepareForSleep(sd_bus_message *message, void *userData, sd_bus_error *) {
+  auto monitor = static_cast<SessionMonitor *>(userData);
+  int isSleeping{};
+  if(sd_bus_message_read(message, "b", &isSleeping) < 0 || !isSleeping)
+    return 0;
+  spdlog::info("Grace windows ended by suspend.");
+  monitor->m_GraceCache.Clear();
+  return 0;
+}
+
+int SessionMonitor::OnSessionRemoved(sd_bus_message *message, void *userData, sd_bus_error *) {
+  auto monitor = static_cast<SessionMonitor *>(userData);
+  const char *sessionId{};
+  if(sd_bus_message_read(message, "s", &sessionId) < 0)
+    return 0;
+  monitor->m_GraceCache.InvalidateLoginSession(sessionId);
+  std::lock_guard lock(monitor->m_LockedMutex);
+  monitor->m_LockedSessions.erase(sessionId);
+  return 0;
+}
+
+std::string SessionMonitor::GetSessionId(sd_bus_message *message) {
+  // Session objects are named after their escaped ID, e.g. /org/freedesktop/login1/session/_32
+  char *sessionId{};
+  auto path = sd_bus_message_get_path(message);
+  if(path == nullptr || sd_bus_path_decode(path, LOGIND_SESSION_PATH, &sessionId) <= 0)
+    return {};
+  auto result = std::string(sessionId);
+  free(sessionId);
+  return result;
+}
+#else
+bool SessionMonitor::Start() {
+  return false;
+}
+
+void SessionMonitor::Stop() {}
+
+std::string SessionMonitor::GetLoginSession(pid_t) {
+  return {};
+}
+#endif
+
+bool SessionMonitor::IsLocked(const std::string &loginSession) {
+  std::lock_guard lock(m_LockedMutex);
+  return m_LockedSessions.contains(loginSession);
+}
@@ -0,0 +1,56 @@
+#ifndef PCBU_DESKTOP_SESSIONMONITOR_H
+#define PCBU_DESKTOP_SESSIONMONITOR_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_set>
+
+#include "AuthGraceCache.h"
+#include "connection/SocketNotifier.h"
+
+#ifdef HAVE_LIBSYSTEMD
+struct sd_bus;
+struct sd_bus_message;
+struct sd_bus_error;
+#endif
+
+// Ends grace windows on the lock, suspend and logout events of systemd-logind.
+// Without logind, e.g. on macOS, Start() fails and AuthGraceCache only ends windows by time and suspend detection.
+class SessionMonitor {
+public:
+  explicit SessionMonitor(AuthGraceCache &graceCache);
+  ~SessionMonitor();
+  SessionMonitor(const SessionMonitor &) = delete;
+  SessionMonitor &operator=(const SessionMonitor &) = delete;
+
+  bool Start();
+  void Stop();
+
+  // Whether logind reported the session as locked (LockedHint) since Start()
+  bool IsLocked(const std::string &loginSession);
+  // The logind session of the process, empty if it has none
+  static std::string GetLoginSession(pid_t pid);
+
+private:
+#ifdef HAVE_LIBSYSTEMD
+  void MonitorThread();
+  static int OnLock(sd_bus_message *message, void *userData, sd_bus_error *error);
+  static int OnPropertiesChanged(sd_bus_message *message, void *userData, sd_bus_error *error);
+  static int OnPrepareForSleep(sd_bus_message *message, void *userData, sd_bus_error *error);
+  static int OnSessionRemoved(sd_bus_message *message, void *userData, sd_bus_error *error);
+  static std::string GetSessionId(sd_bus_message *message);
+
+  sd_bus *m_Bus{};
+  std::thread m_MonitorThread{};
+  SocketNotifier m_StopNotifier{};
+  std::atomic<bool> m_IsRunning{};
+#endif
+  AuthGraceCache &m_GraceCache;
+  std::mutex m_LockedMutex{};
+  std::unordered_set<std::string> m_LockedSessions{};
+};
+
+#endif // PCBU_DESKTOP_SESSIONMONITOR_H
@@ -0,0 +1,34 @@
+#include <csignal>
+#include <unistd.h>
+
+#include "AuthDaemon.h"
+#include "storage/LoggingSystem.h"
+
+int main() {
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  if(geteuid() != 0) {
+    printf("pcbu_authd must run as root.\n");
+    return -1;
+  }
+
+  // Signals are handled by the main thread only, every other thread inherits the mask
+  sigset_t signals{};
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  LoggingSystem::Init("authd");
+  auto daemon = AuthDaemon();
+  if(!daemon.Start()) {
+    LoggingSystem::Destroy();
+    return -1;
+  }
+  int signal{};
+  sigwait(&signals, &signal);
+  spdlog::info("Stopping pcbu_authd... (Signal={})", signal);
+  daemon.Stop();
+  LoggingSystem::Destroy();
+  return 0;
+}
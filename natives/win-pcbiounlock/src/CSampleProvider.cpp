@@ -27,7 +27,7 @@ CSampleProvider::CSampleProvider()
     : _cRef(1), _rgCredProvFieldDescriptors(), _pCredProviderUserArray(nullptr), _pCredProvEvents(nullptr), _upAdviseContext(0),
       _fRecreateEnumeratedCredentials(true), _cpus() {
   DllAddRef();
-  LoggingSystem::Init("module");
+  LoggingSystem::Init("module", {.isShared = true});
 
   AddFieldDescriptor(SFI_TILEIMAGE, CPFT_TILE_IMAGE, "Image", CPFG_CREDENTIAL_PROVIDER_LOGO);
   AddFieldDescriptor(SFI_USERNAME, CPFT_SMALL_TEXT, "Username");
@@ -175,7 +175,7 @@ HRESULT CSampleProvider::GetCredentialCount(_Out_ DWORD *pdwCount, _Out_ DWORD *
   }
 
   int idx{};
-  bool forceDefaultProv = AppSettings::Get().winForceDefaultCredProv;
+  bool forceDefaultProv = AppSettings::Get()->winForceDefaultCredProv;
   for(const auto cred : _pCredentials) {
     if(cred->IsUnlockSuccess()) {
       *pdwDefault = idx;
@@ -226,7 +226,7 @@ HRESULT CUnlockCredential::GetFieldState(DWORD dwFieldID, _Out_ CREDENTIAL_PROVI
       unlockState = _unlockResult.state;
     }
     auto hideUsername = dwFieldID == SFI_USERNAME && _cpus != CPUS_CREDUI;
-    auto hidePasswordField = dwFieldID == SFI_PASSWORD && AppSettings::Get().winHidePasswordField;
+    auto hidePasswordField = dwFieldID == SFI_PASSWORD && AppSettings::Get()->winHidePasswordField;
     auto hideRetryButton = dwFieldID == SFI_RETRY_BUTTON && (unlockState == UnlockState::UNKNOWN || unlockState == UnlockState::SUCCESS);
     if(hideUsername || hidePasswordField || hideRetryButton)
     {
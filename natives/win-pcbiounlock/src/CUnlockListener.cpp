@@ -33,6 +33,11 @@ void CUnlockListener::Stop() {
     return;
   m_IsRunning = false;
   m_IgnoreWaitKeyPress = false;
+  {
+    std::lock_guard lock(m_HandlerMutex);
+    if(m_UnlockHandler)
+      m_UnlockHandler->Cancel();
+  }
   if(m_ListenThread.joinable())
     m_ListenThread.join();
 }
@@ -91,7 +96,7 @@ void CUnlockListener::ListenThread() {
     // Unlock behavior
     if(!m_IgnoreWaitKeyPress) {
       const bool isUnlock = m_ProviderUsage == CPUS_UNLOCK_WORKSTATION || (m_ProviderUsage == CPUS_LOGON && isUserLoggedOn);
-      if(storage.winUnlockBehavior == "key_press"  || (storage.winUnlockBehavior == "key_press_lock_only" && isUnlock)) {
+      if(storage->winUnlockBehavior == "key_press"  || (storage->winUnlockBehavior == "key_press_lock_only" && isUnlock)) {
         Sleep(500);
         m_Credential->UpdateMessage(I18n::Get("wait_key_press"));
         byte lastKeys[KEY_RANGE];
@@ -103,7 +108,7 @@ void CUnlockListener::ListenThread() {
             break;
           Sleep(10);
         }
-      } else if(storage.winUnlockBehavior == "foreground_always" || (storage.winUnlockBehavior == "foreground_lock_only" && isUnlock)) {
+      } else if(storage->winUnlockBehavior == "foreground_always" || (storage->winUnlockBehavior == "foreground_lock_only" && isUnlock)) {
         // HACK: Might not be 100% reliable
         DWORD currentProcessId = GetCurrentProcessId();
         while(m_IsRunning) {
@@ -123,7 +128,17 @@ void CUnlockListener::ListenThread() {
   // Unlock
   std::function<void(const std::string&)> printMessage = [this](const std::string &s) { m_Credential->UpdateMessage(s); };
   auto handler = UnlockHandler(printMessage);
-  const auto result = handler.GetResult(userDomainStr, "Windows-Login", &m_IsRunning);
+  {
+    std::lock_guard lock(m_HandlerMutex);
+    m_UnlockHandler = &handler;
+    if(!m_IsRunning)
+      handler.Cancel();
+  }
+  const auto result = handler.GetResult(userDomainStr, "Windows-Login");
+  {
+    std::lock_guard lock(m_HandlerMutex);
+    m_UnlockHandler = nullptr;
+  }
 
   m_HasResponse = true;
   m_Credential->SetUnlockData(result);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include <string>
 #include <thread>
 
@@ -8,6 +9,7 @@
 
 class CSampleProvider;
 class CUnlockCredential;
+class UnlockHandler;
 class CUnlockListener {
 public:
   CUnlockListener() = default;
@@ -25,6 +27,8 @@ private:
 
   std::thread m_ListenThread{};
   std::atomic<bool> m_IsRunning{};
+  UnlockHandler *m_UnlockHandler{};
+  std::mutex m_HandlerMutex{};
   bool m_HasResponse{};
   bool m_IgnoreWaitKeyPress{};
 